@@ -0,0 +1,271 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include "util/vec.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//===============================================================================//
+// INSTRUCTIONS
+//===============================================================================//
+
+/// @brief One instruction, 32 bits in one of two layouts (after Lua):
+///
+///     ABC   | C:8 | B:8 | A:8 | op:8 |
+///     ABx   |    Bx:16  | A:8 | op:8 |
+///
+/// `A` is almost always the register written. `sBx` is `Bx` read as a signed value
+/// with a bias of `BC_SBX_BIAS`, and `sC` is `C` read the same way with a bias of
+/// `BC_SC_BIAS`.
+typedef uint32_t Instruction;
+
+#define BC_REGISTER_MAX 255
+#define BC_BX_MAX 0xFFFF
+#define BC_SBX_BIAS 0x7FFF
+#define BC_SC_BIAS 0x7F
+
+#define INS_OP(i)  ((uint8_t)((i) & 0xFF))
+#define INS_A(i)   ((uint8_t)(((i) >> 8) & 0xFF))
+#define INS_B(i)   ((uint8_t)(((i) >> 16) & 0xFF))
+#define INS_C(i)   ((uint8_t)(((i) >> 24) & 0xFF))
+#define INS_BX(i)  ((uint16_t)((i) >> 16))
+#define INS_SBX(i) ((int32_t)INS_BX(i) - BC_SBX_BIAS)
+#define INS_SC(i)  ((int32_t)INS_C(i) - BC_SC_BIAS)
+
+#define MAKE_ABC(op, a, b, c) \
+    ((Instruction)(op) | ((Instruction)(a) << 8) | ((Instruction)(b) << 16) | ((Instruction)(c) << 24))
+#define MAKE_ABX(op, a, bx) \
+    ((Instruction)(op) | ((Instruction)(a) << 8) | ((Instruction)(bx) << 16))
+#define MAKE_ASBX(op, a, sbx) MAKE_ABX(op, a, (uint16_t)((sbx) + BC_SBX_BIAS))
+#define MAKE_ABSC(op, a, b, sc) MAKE_ABC(op, a, b, (uint8_t)((sc) + BC_SC_BIAS))
+
+/// @brief Which fields of an instruction mean something, for the disassembler.
+typedef enum _Ins_Format
+{
+    FORMAT_NONE,
+    FORMAT_A,
+    FORMAT_AB,
+    FORMAT_ABC,
+    FORMAT_ABX,
+    FORMAT_ASBX,
+    FORMAT_ABSC,
+} Ins_Format;
+
+/* which fields of an instruction name registers, `REG_WINDOW` means `A` is the
+   first of `C` consecutive registers */
+
+#define REG_A      (1 << 0)
+#define REG_B      (1 << 1)
+#define REG_C      (1 << 2)
+#define REG_WINDOW (1 << 3)
+
+/// Each opcode is listed as `X(name, str, format, regs)`, `R[n]` is register `n` of
+/// the running function and `K[n]` its constant `n`. Registers hold raw 64-bit
+/// values with no type attached, the compiler picks the instruction for the type
+/// it knows the operands have.
+///
+/// - `MOVE A B`:        `R[A] = R[B]`
+/// - `LOADI A sBx`:     `R[A] = sBx` as an integer
+/// - `LOADK A Bx`:      `R[A] = K[Bx]`
+/// - `ADD_I64 A B C`:   `R[A] = R[B] + R[C]` on integers, likewise `SUB`, `MUL`, `DIV`, `MOD`
+/// - `NEG_I64 A B`:     `R[A] = -R[B]` on integers
+/// - `ADDI A B sC`:     `R[A] = R[B] + sC` on integers
+/// - `INCR A`:          `R[A] = R[A] + 1` on integers
+/// - `ADD_F64 A B C`:   `R[A] = R[B] + R[C]` on floats, and so on as for integers
+/// - `CALLB A B C`:     calls native `B` on the `C` registers from `R[A]`
+/// - `HALT`:            stops the program
+///
+/// Every instruction reads its operands before it writes `R[A]`, so `A` may be one
+/// of them.
+#define OPCODE_LIST \
+    X(BC_MOVE,    "MOVE",    FORMAT_AB,   REG_A | REG_B)         \
+    X(BC_LOADI,   "LOADI",   FORMAT_ASBX, REG_A)                 \
+    X(BC_LOADK,   "LOADK",   FORMAT_ABX,  REG_A)                 \
+    X(BC_ADD_I64, "ADD_I64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_SUB_I64, "SUB_I64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_MUL_I64, "MUL_I64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_DIV_I64, "DIV_I64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_MOD_I64, "MOD_I64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_NEG_I64, "NEG_I64", FORMAT_AB,   REG_A | REG_B)         \
+    X(BC_ADDI,    "ADDI",    FORMAT_ABSC, REG_A | REG_B)         \
+    X(BC_INCR,    "INCR",    FORMAT_A,    REG_A)                 \
+    X(BC_ADD_F64, "ADD_F64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_SUB_F64, "SUB_F64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_MUL_F64, "MUL_F64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_DIV_F64, "DIV_F64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_MOD_F64, "MOD_F64", FORMAT_ABC,  REG_A | REG_B | REG_C) \
+    X(BC_NEG_F64, "NEG_F64", FORMAT_AB,   REG_A | REG_B)         \
+    X(BC_CALLB,   "CALLB",   FORMAT_ABC,  REG_WINDOW)            \
+    X(BC_HALT,    "HALT",    FORMAT_NONE, 0)
+
+typedef enum _Opcode
+{
+    #define X(name, str, format, regs) name,
+    OPCODE_LIST
+    #undef X
+    BC_OPCODE_COUNT,
+} Opcode;
+
+/// @brief The functions `CALLB` can call, one for every builtin and every type of
+/// argument it takes, listed as `X(name, str)`.
+#define NATIVE_LIST \
+    X(NATIVE_PRINT_I64, "print_i64") \
+    X(NATIVE_PRINT_F64, "print_f64")
+
+typedef enum _Native
+{
+    #define X(name, str) name,
+    NATIVE_LIST
+    #undef X
+    NATIVE_COUNT,
+} Native;
+
+//===============================================================================//
+// VALUES
+//===============================================================================//
+
+typedef enum _Value_Kind
+{
+    VALUE_INT,
+    VALUE_FLOAT,
+} Value_Kind;
+
+/// @brief The contents of a register, which type it is is up to the instruction.
+typedef union _Slot
+{
+    int64_t i;
+    double f;
+} Slot;
+
+/// @brief A constant, which keeps its type so the pool can be checked and printed.
+typedef struct _Value
+{
+    uint8_t kind;
+    Slot as;
+} Value;
+
+#define INT_VALUE(v)   ((Value) {.kind = VALUE_INT, .as.i = (v)})
+#define FLOAT_VALUE(v) ((Value) {.kind = VALUE_FLOAT, .as.f = (v)})
+
+VEC_DEFINE(Vec_Instruction, Instruction)
+VEC_DEFINE(Vec_Value, Value)
+VEC_DEFINE(Vec_Code_Pos, uint32_t)
+
+//===============================================================================//
+// FUNCTIONS
+//===============================================================================//
+
+/// @brief A compiled function. `positions` runs parallel to `code` and holds the
+/// source offset each instruction came from, `register_count` is how many
+/// registers a call of the function needs.
+typedef struct _Function
+{
+    Vec_Instruction code;
+    Vec_Code_Pos positions;
+    Vec_Value constants;
+    Intern_Id name;
+    File_Id file;
+    uint32_t register_count;
+} Function;
+
+/// @brief Creates an empty function whose arrays are allocated out of an arena.
+/// @param arena the arena, `NULL` to use the heap.
+/// @param name the name of the function.
+/// @param file the file the function comes from.
+Function Function_New(Arena *arena, Intern_Id name, File_Id file);
+
+/// @brief Appends an instruction.
+/// @param self the function.
+/// @param ins the instruction.
+/// @param pos the source offset it came from.
+/// @return `false` if the function could not grow.
+bool Function_Emit(Function *self, Instruction ins, uint32_t pos);
+
+/// @brief Adds a constant, reusing an equal one already in the pool.
+/// @param self the function.
+/// @param value the constant.
+/// @param index where to write the index of the constant.
+/// @return `false` if the pool is full or could not grow.
+bool Function_Constant(Function *self, Value value, uint32_t *index);
+
+/// @brief Frees a function's arrays, nothing to do when they live in an arena.
+void Function_Free(Function *self);
+
+/// @brief Checks a function is safe to run without checking anything while it runs:
+/// every opcode exists, every register is inside the function's window, every
+/// constant and native exists and the code ends in `HALT`.
+/// @return `false` if the function must not be run.
+bool Function_Verify(const Function *self);
+
+/// @brief Returns the name of an opcode, `"???"` for anything that is not one.
+const char *Opcode_Name(uint8_t op);
+
+/// @brief Returns the name of a native, `"???"` for anything that is not one.
+const char *Native_Name(uint8_t native);
+
+/// @brief Returns the operand format of an opcode.
+Ins_Format Opcode_Format(uint8_t op);
+
+/// @brief Returns which fields of an opcode name registers, see `REG_A` and friends.
+uint8_t Opcode_Registers(uint8_t op);
+
+/// @brief Prints one instruction without a trailing newline.
+/// @param self the function the instruction belongs to, for its constants.
+/// @param ins the instruction.
+/// @param out where to print.
+void Print_Instruction(const Function *self, Instruction ins, FILE *out);
+
+/// @brief Prints a function as a listing, one instruction a line.
+/// @param self the function.
+/// @param lines the line index of the function's file, `NULL` to print offsets.
+/// @param out where to print.
+void Disassemble(const Function *self, const Line_Index *lines, FILE *out);
+
+//===============================================================================//
+// LOWERED CODE
+//===============================================================================//
+
+/// @brief An instruction before register allocation. Register fields hold virtual
+/// registers, of which there can be any number, and every other field holds its
+/// value as is (`sBx` and `sC` without the bias).
+typedef struct _Lowered_Ins
+{
+    uint8_t op;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+} Lowered_Ins;
+
+/// @brief Virtual registers `base` to `base + count - 1`, which have to end up in
+/// consecutive registers, such as the arguments of a call.
+typedef struct _Reg_Window
+{
+    uint32_t base;
+    uint32_t count;
+} Reg_Window;
+
+VEC_DEFINE(Vec_Lowered_Ins, Lowered_Ins)
+VEC_DEFINE(Vec_Reg_Window, Reg_Window)
+
+/// @brief The code of a function as the emitter lowers it, `positions` runs parallel
+/// to `code` like it does in `Function`.
+typedef struct _Lowered
+{
+    Vec_Lowered_Ins code;
+    Vec_Code_Pos positions;
+    Vec_Reg_Window windows;
+    uint32_t vreg_count;
+} Lowered;
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Bytecode(Test_Info *info);
+
+#endif // BYTECODE_H
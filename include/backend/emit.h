@@ -0,0 +1,42 @@
+#ifndef EMIT_H
+#define EMIT_H
+#include "backend/bytecode.h"
+#include "frontend/ast.h"
+#include "frontend/check.h"
+#include "frontend/resolve.h"
+#include "util/arena.h"
+#include "util/errors.h"
+#include "util/tests.h"
+#include <stdbool.h>
+
+//===============================================================================//
+// EMITTER
+//===============================================================================//
+
+typedef struct _Emitted
+{
+    Function fn;
+    bool valid;
+} Emitted;
+
+/// @brief Lowers a resolved and checked AST to the bytecode of one function, the
+/// top level statements in order followed by `HALT`. Every local and temporary
+/// gets a virtual register, and after `Optimize_Peephole` has fused what it can,
+/// `Allocate_Registers` maps them onto as few registers as it can. Arithmetic is emitted as the instruction for the type the
+/// checker gave it, so the VM never looks at what a register holds.
+/// @param ast the AST.
+/// @param resolved what the names in the AST resolved to.
+/// @param checked the types of the nodes in the AST.
+/// @param arena the arena the function and error messages are allocated in.
+/// @param errors where running out of registers or constants is reported.
+/// @return the function, and `false` if it could not be lowered.
+Emitted Emit_Function(AST *ast, const Resolved *resolved, const Checked *checked, Arena *arena,
+                      Vec_Error *errors);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Emitter(Test_Info *info);
+
+#endif // EMIT_H
@@ -0,0 +1,74 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+#include "backend/bytecode.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/source.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IMAGE_EXTENSION ".suduc"
+#define IMAGE_VERSION 1
+
+//===============================================================================//
+// BYTECODE IMAGES
+//===============================================================================//
+
+/* compiled functions saved to a file that runs without its source. The code,
+   positions, constants and line table are laid out in the file the way they are
+   laid out in memory, so a loaded image is the mapped file plus a `Function` for
+   each function pointing into it, and names interned again */
+
+/// @brief A loaded image. The functions' arrays and `lines` point into the mapped
+/// file, they belong to the image and go when it is freed, and the image must stay
+/// where it was loaded. The first function is the one to run.
+typedef struct _Image
+{
+    Mapped_File file;
+    Arena arena;
+    Function *functions;
+    uint32_t function_count;
+    const char *source_path;
+    Line_Index lines;
+} Image;
+
+/// @brief Returns the path of the image for a source file, `foo.sudu` becomes
+/// `foo.suduc` and anything else gets the extension added.
+/// @param arena the arena the path is allocated in.
+/// @param path the path of the source file.
+/// @return the path, `NULL` if it could not be allocated.
+const char *Image_Path(Arena *arena, const char *path);
+
+/// @brief Returns whether a path names an image rather than a source file.
+bool Is_Image_Path(const char *path);
+
+/// @brief Saves compiled functions to an image, replacing whatever was there by
+/// renaming a new file over it, so a run that has the old image mapped keeps it.
+/// @param path the path of the image.
+/// @param functions the functions, the first one being the one to run.
+/// @param count how many functions there are.
+/// @param source_path the path of the source they were compiled from.
+/// @param lines the line index of that source, for runtime errors.
+/// @return `false` if the file could not be written.
+bool Image_Write(const char *path, const Function *functions, uint32_t count,
+                 const char *source_path, const Line_Index *lines);
+
+/// @brief Maps an image and sets up its functions. Only the layout of the file is
+/// checked here, the code is verified by `VM_Run` like any other code.
+/// @param path the path of the image.
+/// @param out where to write the image.
+/// @return `false` if there is no such file, or it is not an image of this version,
+/// has no functions or is damaged.
+bool Image_Load(const char *path, Image *out);
+
+/// @brief Unmaps an image and frees what was allocated for it.
+void Image_Free(Image *self);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Image(Test_Info *info);
+
+#endif // IMAGE_H
@@ -0,0 +1,35 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+#include "backend/bytecode.h"
+#include "util/tests.h"
+#include <stddef.h>
+
+//===============================================================================//
+// PEEPHOLE OPTIMIZATION
+//===============================================================================//
+
+/// @brief Rewrites short runs of lowered code into fewer instructions, so fewer of
+/// them are dispatched. It runs before register allocation, where a temporary is
+/// still a virtual register of its own and whether it is read anywhere else is a
+/// matter of counting:
+///
+/// - `LOADI t k` feeding nothing but an integer `ADD` or `SUB` becomes an `ADDI`
+///   of `k`, when `k` fits in `sC`
+/// - `ADDI x x 1` becomes `INCR x`
+/// - a value computed into a register that is read only by the `MOVE` right after
+///   it is computed into the `MOVE`'s destination instead
+///
+/// The code is straight-line for now, once there are jumps a rewrite must not
+/// reach across the start of a block.
+/// @param lowered the lowered code, rewritten in place.
+/// @return how many instructions were removed or fused, 0 if memory ran out, in
+/// which case the code is left as it was.
+size_t Optimize_Peephole(Lowered *lowered);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Peephole(Test_Info *info);
+
+#endif // PEEPHOLE_H
@@ -0,0 +1,34 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+#include "backend/bytecode.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+//===============================================================================//
+// REGISTER ALLOCATION
+//===============================================================================//
+
+/// @brief Assigns registers to the virtual registers of lowered code with linear
+/// scan and encodes the result into a function. A virtual register is live from
+/// the first instruction that names it to the last, and a register is reused as
+/// soon as what it held is dead, so the function gets the smallest window the scan
+/// can find. Moves that end up between the same register are dropped.
+///
+/// The code is straight-line for now, which is what makes first-to-last a live
+/// range. Once there are jumps the ranges of values live around a loop have to be
+/// stretched over the whole loop.
+/// @param lowered the lowered code.
+/// @param out the function to encode into, its constants are already in place.
+/// @param overflow_at where to write the index of the instruction at which more
+/// registers than the VM has were live, when that is why it failed.
+/// @return `false` if the code needs too many registers or memory ran out.
+bool Allocate_Registers(const Lowered *lowered, Function *out, uint32_t *overflow_at);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Register_Allocator(Test_Info *info);
+
+#endif // REGALLOC_H
@@ -1,22 +1,31 @@
 #ifndef AST_H
 #define AST_H
 
+#include "util/arena.h"
 #include "util/common.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include "util/vec.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #define INIT_NODE_MAP_CAPACITY 256
+#define INIT_NODE_EXTRA_CAPACITY 64
 #define INIT_ROOT_NODE_CAPACITY 64
 
-typedef size_t Node_Idx;
+/// @brief Index of a node in the AST. Index 0 is always the root, and since the root
+/// is never anybody's child it doubles as "no node" in child fields.
+typedef uint32_t Node_Idx;
+
+#define NODE_NONE ((Node_Idx)0)
 
 //===============================================================================//
 // AST NODE HELPER ENUMS
 //===============================================================================//
 
 /// @brief Enum constants for the different types of nodes in the AST,
-/// corresponding with what is stored in the Ast_Node union type.
+/// corresponding with how the node's `Node_Data` is laid out.
 typedef enum _Node_Kind
 {
     NODE_ROOT = 0,
@@ -29,12 +38,50 @@ typedef enum _Node_Kind
     NODE_BINARY,
     NODE_VARIABLE,
     NODE_ASSIGNMENT,
+    NODE_UNARY,
+    NODE_KIND_COUNT,
 } Node_Kind;
 
 //===============================================================================//
-// NODE SUBTYPE STRUCTS
+// NODE STORAGE
+//===============================================================================//
+
+/// @brief The fixed-size payload of every node, what the three words mean depends on
+/// the kind of the node:
+///
+/// - `NODE_INTEGER`, `NODE_FLOAT`: the low and high halves of the value's bits in `a`, `b`
+/// - `NODE_SYMBOL`: the `Intern_Id` in `a`
+/// - `NODE_GROUPING`: the inner node in `a`
+/// - `NODE_LIST`: the first index into the extra pool in `a`, the count in `b`
+/// - `NODE_CALL`: the callee in `a`, the argument list node in `b`
+/// - `NODE_BINARY`, `NODE_ASSIGNMENT`: the `Operator` in `a`, the operands in `b`, `c`
+/// - `NODE_VARIABLE`: the symbol in `a`, the initializer in `b`, the mutability in `c`
+/// - `NODE_UNARY`: the `Operator` in `a`, the operand in `b`
+typedef struct _Node_Data
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+} Node_Data;
+
+/// @brief A span without its file, every node of an AST comes from the same file.
+typedef struct _Node_Span
+{
+    uint32_t pos;
+    uint32_t len;
+} Node_Span;
+
+VEC_DEFINE(Vec_Node_Kind, uint8_t)
+VEC_DEFINE(Vec_Node_Data, Node_Data)
+VEC_DEFINE(Vec_Node_Span, Node_Span)
+VEC_DEFINE(Vec_Node_Idx, Node_Idx)
+
+//===============================================================================//
+// NODE VIEWS
 //===============================================================================//
 
+/* decoded forms of a node's data, see the `AST_Get_*` functions */
+
 typedef struct _Node_Variable
 {
     Node_Idx symbol;
@@ -49,6 +96,12 @@ typedef struct _Node_Binary
     Node_Idx rhs;
 } Node_Binary;
 
+typedef struct _Node_Unary
+{
+    Operator op;
+    Node_Idx operand;
+} Node_Unary;
+
 typedef struct _Node_Assignment
 {
     Operator op;
@@ -62,96 +115,181 @@ typedef struct _Node_Call
     Node_Idx args;
 } Node_Call;
 
-/// @brief A dynamically resizeable array of Node indices that can be
-/// created as a node itself and used to represent things like call args,
-/// procedure parameters, class members, etc.
+/// @brief The children of a list node, a window into the AST's extra pool. It is
+/// invalidated by anything that adds to the pool.
 typedef struct _Node_List
 {
-    Node_Idx *nodes;
-    size_t count;
-    size_t capacity;
+    const Node_Idx *nodes;
+    uint32_t count;
 } Node_List;
 
-/// @brief Push a node index to the node list.
-/// @param self the node list.
-/// @param node the node index.
-void Node_List_Add(Node_List *self, Node_Idx node);
-
 //===============================================================================//
-// AST NODES
+// ABSTRACT SYNTAX TREE
 //===============================================================================//
 
-/// @brief The encompassing Ast_Node type for all AST nodes, variation comes in the form of
-/// the type member and the union type member.
-typedef struct _Node
+/// @brief Contains the relevant information for the abstract syntax tree. Nodes are
+/// stored as parallel arrays indexed by `Node_Idx`: a kind byte, a 12-byte payload
+/// and a 32-bit span, so a node takes 21 bytes. Children of variable length live
+/// in one shared `extra` pool, and the top level nodes in `items`. When `arena` is
+/// set every array is allocated out of it.
+typedef struct
 {
-    Node_Kind type;
-    Span span;
-    union {
-        Node_List root;
-        Node_Variable variable;
-        Node_Binary binary;
-        Node_Assignment assignment;
-        Node_Call call;
-        Node_List list;
-        char *symbol_name;
-        float float_value;
-        int32_t int_value;
-        Node_Idx inner_node;
-    } data;
-} Node;
-
-/// @brief Pushes a node to the node map and returns it's ID/index.
-/// @param nodes the node map.
-/// @param node the node instance itself.
-/// @return the index of the node in the map.
-Node_Idx Node_Insert(List *map, Node node);
-
-/// @brief Simple prints a node using a recursive method..
-/// @param nodes the node map.
-/// @param id the index of the node in the map.
+    Vec_Node_Kind kinds;
+    Vec_Node_Data data;
+    Vec_Node_Span spans;
+    Vec_Node_Idx extra;
+    Vec_Node_Idx items;
+    File_Id file;
+    Arena *arena;
+} AST;
+
+/// @brief Initializes an empty AST with nothing but the root node allocated.
+/// @param file the file every node of the tree comes from.
+/// @return blank AST.
+AST AST_Init(File_Id file);
+
+/// @brief Initializes an empty AST that allocates everything out of an arena, so the
+/// whole tree is released with the arena instead of array by array.
+/// @param arena the arena, `NULL` to use the heap like `AST_Init`.
+/// @param file the file every node of the tree comes from.
+/// @return blank AST.
+AST AST_Init_In(Arena *arena, File_Id file);
+
+/// @brief Pushes a node index to the root node of the AST.
+/// @param self the AST.
+/// @param node_idx index of the node.
+/// @return `false` if the root could not grow.
+bool AST_Insert(AST *self, Node_Idx node_idx);
+
+/// @brief Frees the AST. For an arena-backed AST there is nothing to do, the
+/// memory goes when the arena is reset or freed.
+/// @param self the AST.
+void AST_Free(AST *self);
+
+/// @brief Returns how many nodes the AST holds, the root included.
+size_t AST_Count(const AST *self);
+
+//===============================================================================//
+// NODE FUNCTIONS
+//===============================================================================//
+
+/// @brief Pushes a node to the AST and returns it's ID/index.
+/// @param self the AST.
+/// @param kind the kind of node.
+/// @param span the span of source code the node covers.
+/// @param data the node's payload.
+/// @return the index of the node, `NODE_NONE` if the AST could not grow.
+Node_Idx Node_Insert(AST *self, Node_Kind kind, Span const span, Node_Data data);
+
+/// @brief Prints a node and everything under it, `NODE_NONE` prints the whole tree.
+/// @param self the AST.
+/// @param id the index of the node.
 /// @param i number of spaces worth of indentation.
-void Node_Print(List *map, Node_Idx id, int i);
+void Node_Print(AST *self, Node_Idx id, int i);
 
-/// @brief Frees a node, if neccesary. Really only needed.
-/// for nodes that own dynamically allocated memory, this does not
-/// free the actual node itself.
-/// @param self the node.
-void Node_Free(Node *self);
+Node_Kind AST_Get_Kind(const AST *self, Node_Idx id);
+Span AST_Get_Span(const AST *self, Node_Idx id);
+int64_t AST_Get_Integer(const AST *self, Node_Idx id);
+double AST_Get_Float(const AST *self, Node_Idx id);
+Intern_Id AST_Get_Symbol(const AST *self, Node_Idx id);
+Node_Idx AST_Get_Inner(const AST *self, Node_Idx id);
+Node_List AST_Get_List(const AST *self, Node_Idx id);
+Node_Call AST_Get_Call(const AST *self, Node_Idx id);
+Node_Binary AST_Get_Binary(const AST *self, Node_Idx id);
+Node_Unary AST_Get_Unary(const AST *self, Node_Idx id);
+Node_Assignment AST_Get_Assignment(const AST *self, Node_Idx id);
+Node_Variable AST_Get_Variable(const AST *self, Node_Idx id);
 
 //===============================================================================//
-// NODE BUILDER HELPER FUNCTIONS
+// NODE REWRITING
 //===============================================================================//
 
-Node_Idx Make_Node_Integer(List *map, Span const span, int32_t value);
-Node_Idx Make_Node_Float(List *map, Span const span, float value);
-Node_Idx Make_Node_Grouping(List *map, Span const span, Node_Idx inner);
-Node_Idx Make_Node_Symbol(List *map, Span const span, const char *src);
-Node_Idx Make_Node_Binary(List *map, Span const span, Node_Idx lhs, Node_Idx rhs, Operator op);
-Node_Idx Make_Node_Assignment(List *map, Span const span, Node_Idx sym, Node_Idx val, Operator op);
-Node_Idx Make_Node_Variable(List *map, Span const span, Node_Idx sym, Node_Idx initializer, bool mut);
-Node_Idx Make_Node_Call(List *map, Span const span, Node_Idx sym, Node_Idx args);
-Node_Idx Make_Node_List(List *map, Span const start_span, size_t capacity);
+/* passes rewrite nodes in place, so whatever points at a node sees the new one */
+
+/// @brief Turns a node into an integer literal, keeping its span.
+void AST_Set_Integer(AST *self, Node_Idx id, int64_t value);
+
+/// @brief Turns a node into a float literal, keeping its span.
+void AST_Set_Float(AST *self, Node_Idx id, double value);
+
+/// @brief Turns a node into a grouping around another node, keeping its span. This
+/// is how a pass drops an operation but keeps an operand, the operand stays where
+/// it is so anything recorded against its index still holds.
+void AST_Set_Grouping(AST *self, Node_Idx id, Node_Idx inner);
 
 //===============================================================================//
-// ABSTRACT SYNTAX TREE
+// TRAVERSAL
 //===============================================================================//
 
-/// @brief Contains the relevant information for the abstract syntax tree, including the
-/// node map for the nodes to be stored contiguously in memory, along with the root node.
-typedef struct
+/// @brief What a visitor wants the walk to do after visiting a node. `WALK_SKIP`
+/// from a pre-order visit skips the node's children (and its post-order visit).
+typedef enum _Walk_Action
 {
-    Node *root_node;
-    List node_map;
-} AST;
+    WALK_CONTINUE,
+    WALK_SKIP,
+    WALK_STOP,
+} Walk_Action;
 
-/// @brief Initializes an empty AST with nothing but the root node allocated.
-/// @return blank AST.
-AST AST_Init();
+/// @brief Called for a node during a walk.
+/// @param ast the AST being walked.
+/// @param id the node.
+/// @param depth how far below the node the walk started at it is.
+/// @param ctx the visitor's context.
+typedef Walk_Action (*Visit_Fn)(AST *ast, Node_Idx id, uint32_t depth, void *ctx);
 
-/// @brief Pushes a node index to the root node of the AST.
+/// @brief Callbacks for `AST_Walk`, either of them may be `NULL`.
+typedef struct _AST_Visitor
+{
+    Visit_Fn pre;
+    Visit_Fn post;
+    void *ctx;
+} AST_Visitor;
+
+/// @brief Walks a node and everything under it depth-first, children in source
+/// order. The walk keeps its own work stack instead of recursing, so it is not
+/// limited by the depth of the tree. Walking `NODE_NONE` walks the whole tree.
 /// @param self the AST.
-/// @param node_idx index of the node.
-void AST_Insert(AST *self, Node_Idx node_idx);
+/// @param start the node to start from.
+/// @param visitor the callbacks.
+/// @return `false` if a visitor stopped the walk or the stack could not grow.
+bool AST_Walk(AST *self, Node_Idx start, AST_Visitor const *visitor);
+
+/// @brief Returns the direct children of a node that are not `NODE_NONE`, in order.
+/// @param self the AST.
+/// @param id the node.
+/// @param fixed storage for the children of fixed-arity nodes.
+/// @param count where to write how many children there are.
+/// @return pointer to the children, either `fixed` or a window into the AST.
+const Node_Idx *AST_Children(const AST *self, Node_Idx id, Node_Idx fixed[3], uint32_t *count);
+
+//===============================================================================//
+// NODE BUILDER HELPER FUNCTIONS
+//===============================================================================//
+
+Node_Idx Make_Node_Integer(AST *ast, Span const span, int64_t value);
+Node_Idx Make_Node_Float(AST *ast, Span const span, double value);
+Node_Idx Make_Node_Grouping(AST *ast, Span const span, Node_Idx inner);
+Node_Idx Make_Node_Symbol(AST *ast, Span const span, Intern_Id name);
+Node_Idx Make_Node_Binary(AST *ast, Span const span, Node_Idx lhs, Node_Idx rhs, Operator op);
+Node_Idx Make_Node_Unary(AST *ast, Span const span, Node_Idx operand, Operator op);
+Node_Idx Make_Node_Assignment(AST *ast, Span const span, Node_Idx sym, Node_Idx val, Operator op);
+Node_Idx Make_Node_Variable(AST *ast, Span const span, Node_Idx sym, Node_Idx initializer, bool mut);
+Node_Idx Make_Node_Call(AST *ast, Span const span, Node_Idx sym, Node_Idx args);
+
+/// @brief Makes a list node, the children are copied into the extra pool in one go,
+/// so a builder collects them (on a scratch stack, say) before making the list.
+/// @param ast the AST.
+/// @param span the span of the whole list.
+/// @param nodes the children, may be `NULL` when `count` is 0.
+/// @param count how many children there are.
+/// @return the index of the list node, `NODE_NONE` if the AST could not grow.
+Node_Idx Make_Node_List(AST *ast, Span const span, const Node_Idx *nodes, uint32_t count);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_AST(Test_Info *info);
+void Test_AST_Walk(Test_Info *info);
 
 #endif // AST_H
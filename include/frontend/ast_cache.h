@@ -0,0 +1,58 @@
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+#include "frontend/ast.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AST_CACHE_EXTENSION ".astc"
+#define AST_CACHE_VERSION 2
+
+//===============================================================================//
+// AST CACHE
+//===============================================================================//
+
+/* a parsed tree saved next to its source, so an unchanged file is neither lexed
+   nor parsed again. The file holds the node arrays as they are in memory, at fixed
+   offsets and with no pointers, plus the names the tree's symbols refer to */
+
+/// @brief Hashes source code to key its cache file (64-bit FNV-1a).
+/// @param src the source code.
+/// @param len the length of the source code.
+/// @return the hash.
+uint64_t Hash_Source(const char *src, size_t len);
+
+/// @brief Returns the path of the cache file for a source file.
+/// @param arena the arena the path is allocated in.
+/// @param path the path of the source file.
+/// @return the path, `NULL` if it could not be allocated.
+const char *AST_Cache_Path(Arena *arena, const char *path);
+
+/// @brief Saves an AST to a cache file, replacing whatever was there by renaming a
+/// new file over it, so a job that has the old file mapped keeps it.
+/// @param ast the AST, as it came out of the parser.
+/// @param path the path of the cache file.
+/// @param hash the hash of the source the AST was parsed from.
+/// @return `false` if the file could not be written.
+bool AST_Cache_Write(const AST *ast, const char *path, uint64_t hash);
+
+/// @brief Loads an AST from a cache file. The file is mapped and its arrays copied
+/// straight into the arena, symbols are interned again as they are read.
+/// @param path the path of the cache file.
+/// @param hash the hash of the source the AST should have been parsed from.
+/// @param arena the arena the AST is allocated in, must not be `NULL`.
+/// @param file the file the nodes are said to come from.
+/// @param out where to write the AST.
+/// @return `false` on a miss: no file, a stale or foreign one, or one that is damaged.
+bool AST_Cache_Read(const char *path, uint64_t hash, Arena *arena, File_Id file, AST *out);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_AST_Cache(Test_Info *info);
+
+#endif // AST_CACHE_H
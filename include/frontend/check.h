@@ -0,0 +1,41 @@
+#ifndef CHECK_H
+#define CHECK_H
+#include "frontend/ast.h"
+#include "frontend/resolve.h"
+#include "frontend/types.h"
+#include "util/arena.h"
+#include "util/errors.h"
+#include "util/tests.h"
+#include <stdbool.h>
+
+//===============================================================================//
+// TYPE CHECKER
+//===============================================================================//
+
+/// @brief The result of checking an AST. `types` has the type of every node, and
+/// `locals` the type of every local slot. Statements have type `void`, and
+/// anything that did not check has `TYPE_NONE`.
+typedef struct _Checked
+{
+    Type_Id *types;
+    Type_Id *locals;
+    bool valid;
+} Checked;
+
+/// @brief Checks the types of a resolved AST in one pass over the nodes, children
+/// before parents. A local takes the type of its initializer, and arithmetic needs
+/// both operands to be the same numeric type, there are no implicit conversions.
+/// @param ast the AST.
+/// @param resolved what the names in the AST resolved to.
+/// @param arena the arena the types and error messages are allocated in.
+/// @param errors where mismatches are reported.
+/// @return the types, and `false` if anything was reported.
+Checked Check_Types(AST *ast, const Resolved *resolved, Arena *arena, Vec_Error *errors);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Checker(Test_Info *info);
+
+#endif // CHECK_H
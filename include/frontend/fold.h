@@ -0,0 +1,39 @@
+#ifndef FOLD_H
+#define FOLD_H
+#include "frontend/ast.h"
+#include "util/arena.h"
+#include "util/errors.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+//===============================================================================//
+// CONSTANT FOLDING
+//===============================================================================//
+
+typedef struct _Folded
+{
+    size_t folded;
+    bool valid;
+} Folded;
+
+/// @brief Folds arithmetic on int and float literals and applies the identities that
+/// are safe for integers (`x + 0`, `x - 0`, `x * 1`, `x / 1`, and `x * 0` when `x`
+/// has no side effects and cannot divide by zero). Nodes are rewritten in place, so the tree keeps its shape
+/// and spans. Mixed int and float operands are left alone for the type checker,
+/// and no identity is applied to floats since `x + 0.0` is not `x` for `-0.0`.
+/// The identities trust an integer literal to mean integer arithmetic, so the pass
+/// runs on a tree the type checker has accepted.
+/// @param ast the AST to fold.
+/// @param arena the arena error messages are allocated in.
+/// @param errors where overflow and division by zero are reported.
+/// @return how many nodes were rewritten, and `false` if an error was reported.
+Folded Fold_Constants(AST *ast, Arena *arena, Vec_Error *errors);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Fold(Test_Info *info);
+
+#endif // FOLD_H
@@ -1,25 +1,143 @@
 #ifndef LEXER_H
 #define LEXER_H
 #define INIT_TOKEN_CAPACITY 512
+#define LEXER_LOOKAHEAD 8
+#define INIT_LITERAL_CAPACITY 64
 #include "util/common.h"
+#include "util/errors.h"
 #include "util/tests.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+//===============================================================================//
+// TOKEN STORE
+//===============================================================================//
+
+_Static_assert(TOK_EOF <= UINT8_MAX, "token kinds must fit in a byte for the token store");
+
+/// @brief The packed offset+len of a stored token.
+typedef struct _Token_Span
+{
+    uint32_t pos;
+    uint32_t len;
+} Token_Span;
+
+/// @brief The decoded value of one numeric literal in a token store.
+typedef struct _Token_Literal
+{
+    uint32_t token;
+    Token_Value value;
+} Token_Literal;
+
+/// @brief A materialized token stream stored as parallel arrays, 9 bytes a token
+/// instead of a full `Token`. Line and column are not stored at all, they are looked
+/// up from the line index only when a token is actually expanded. Decoded numeric
+/// literals live in a side array, sorted by token index.
+typedef struct _Token_Store
+{
+    uint8_t *kinds;
+    Token_Span *spans;
+    size_t count;
+    size_t capacity;
+    Token_Literal *literals;
+    size_t literal_count;
+    size_t literal_capacity;
+    File_Id file;
+    Line_Index lines;
+} Token_Store;
+
+/// @brief Appends a token to the store, its line and column are dropped.
+/// @param self the token store.
+/// @param token the token.
+/// @return `false` if the store could not grow.
+bool Token_Store_Add(Token_Store *self, Token const *token);
+
+/// @brief Returns the decoded value of the `n`th token.
+/// @param self the token store.
+/// @param n the index of the token.
+/// @return the value, zeroed if the token is not a numeric literal.
+Token_Value Token_Store_Value(const Token_Store *self, size_t n);
+
+/// @brief Expands the `n`th token back into a full `Token`, including line and column.
+/// @param self the token store.
+/// @param n the index of the token, must be in bounds.
+/// @return the token.
+Token Token_Store_Get(const Token_Store *self, size_t n);
+
+/// @brief Free the token store and its line index.
+/// @param self the token store.
+void Token_Store_Free(Token_Store *self);
+
+//===============================================================================//
+// LEXER
+//===============================================================================//
 
 typedef struct _Tokens
 {
-    List tokens;
+    Token_Store tokens;
     bool valid;
 } Tokens;
 
-/// @brief Tokenizes the source input and produces a stream of tokens.
-/// @param src source code as a string.
+/// @brief The lexer state, tokens are pulled from it one at a time with `Lexer_Next`
+/// and looked ahead at through a fixed-size ring buffer with `Lexer_Peek`, so a
+/// consumer only ever holds `LEXER_LOOKAHEAD` tokens in memory.
+typedef struct _Lexer
+{
+    Vec_Error *errs;
+    const char *src;
+    size_t len;
+    File_Id file;
+    size_t pos;
+    size_t x;
+    size_t y;
+    Token ahead[LEXER_LOOKAHEAD];
+    size_t ahead_head;
+    size_t ahead_count;
+    Token eof;
+    bool done;
+    bool lost_errors;
+} Lexer;
+
+/// @brief Creates a lexer over the source, nothing is lexed until a token is pulled.
+/// @param src source code, it does not need to be nul-terminated.
+/// @param len the length of the source code.
+/// @param file the file the source belongs to, stamped on every span.
+/// @param errors a pointer to the errors buffer.
+/// @return the lexer.
+Lexer Lexer_Init(const char *src, size_t len, File_Id file, Vec_Error *errors);
+
+/// @brief Pulls the next token from the stream. After the end of the source this
+/// keeps returning the `TOK_EOF` token.
+/// @param self the lexer.
+/// @return the next token.
+Token Lexer_Next(Lexer *self);
+
+/// @brief Looks ahead in the stream without consuming anything.
+/// @param self the lexer.
+/// @param n how far to look, 0 is the token the next `Lexer_Next` returns. Must be
+/// less than `LEXER_LOOKAHEAD`.
+/// @return the token `n` places ahead.
+Token Lexer_Peek(Lexer *self, size_t n);
+
+/// @brief Tokenizes the source input and produces a stream of tokens. This is a
+/// convenience wrapper that pulls the whole stream from a `Lexer` into a token store.
+/// @param src source code, it does not need to be nul-terminated.
+/// @param len the length of the source code.
+/// @param file the file the source belongs to, stamped on every span.
 /// @param errors a pointer to the errors buffer.
-/// @return struct containing a `List<Token>` and a `bool` for success/failure.
-Tokens Tokenize(const char *src, List *errors);
+/// @return struct containing a `Token_Store` and a `bool` for success/failure.
+Tokens Tokenize(const char *src, size_t len, File_Id file, Vec_Error *errors);
 
 /* Tests */
 void Test_Lexer(Test_Info *info);
 void Test_Literals(Test_Info *info);
 void Test_Lexer_Other(Test_Info *info);
+void Test_Lexer_Scan_Levels(Test_Info *info);
+void Test_Lexer_Operators(Test_Info *info);
+void Test_Lexer_Keywords(Test_Info *info);
+void Test_Lexer_Stream(Test_Info *info);
+void Test_Lexer_Lines(Test_Info *info);
+void Test_Token_Store(Test_Info *info);
+void Test_Lexer_Numbers(Test_Info *info);
 
 #endif // LEXER_H
@@ -0,0 +1,63 @@
+#ifndef PARSER_H
+#define PARSER_H
+#include "frontend/ast.h"
+#include "frontend/lexer.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define INIT_PARSER_SCRATCH_CAPACITY 64
+#define PARSER_MAX_DEPTH 256
+
+//===============================================================================//
+// PARSER
+//===============================================================================//
+
+typedef struct _Parsed
+{
+    AST ast;
+    bool valid;
+} Parsed;
+
+/// @brief The parser state. Tokens are pulled one at a time from the lexer, so the
+/// source is read in a single pass with no token buffer and no backtracking.
+/// Children of list nodes are collected on `scratch` until the list is complete.
+/// `lines` is only built once a message has to name a line.
+typedef struct _Parser
+{
+    Lexer lexer;
+    AST *ast;
+    Vec_Error *errs;
+    Arena *arena;
+    Vec_Node_Idx scratch;
+    Line_Index lines;
+    Token current;
+    Token previous;
+    size_t depth;
+    size_t parens;
+    bool panic;
+    bool failed;
+} Parser;
+
+/// @brief Parses a whole source file into an AST. Statements are separated by
+/// newlines, after an error the parser skips to the next line and carries on, so
+/// one run reports at most one error per statement.
+/// @param src source code, it does not need to be nul-terminated.
+/// @param len the length of the source code.
+/// @param file the file the source belongs to.
+/// @param arena the arena the AST and error messages are allocated in, must not be `NULL`.
+/// @param errors a pointer to the errors buffer, lexing errors land there too.
+/// @return struct containing the `AST` and a `bool` that is `false` if anything went wrong.
+Parsed Parse(const char *src, size_t len, File_Id file, Arena *arena, Vec_Error *errors);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Parser(Test_Info *info);
+void Test_Parser_Recovery(Test_Info *info);
+
+#endif // PARSER_H
@@ -0,0 +1,126 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+#include "frontend/ast.h"
+#include "util/arena.h"
+#include "util/errors.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include "util/vec.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INIT_SCOPE_CAPACITY 16
+#define INIT_SCOPE_CHAIN_CAPACITY 8
+
+/// @brief Marks a node that did not resolve to anything.
+#define SLOT_NONE UINT32_MAX
+
+/// @brief The name a declaration can use to throw its value away, it is never bound.
+#define DISCARD_NAME "_"
+
+//===============================================================================//
+// BUILTINS
+//===============================================================================//
+
+/// @brief The functions every program can call without declaring them. A call
+/// resolves to the `Builtin` it calls.
+/// X(name, str)
+#define BUILTIN_LIST \
+    X(BUILTIN_PRINT, "print")
+
+typedef enum _Builtin
+{
+    #define X(name, str) name,
+    BUILTIN_LIST
+    #undef X
+    BUILTIN_COUNT,
+} Builtin;
+
+//===============================================================================//
+// SCOPES
+//===============================================================================//
+
+/// @brief What a name is bound to in a scope.
+typedef struct _Binding
+{
+    Intern_Id name;
+    uint32_t slot;
+    Node_Idx decl;
+    bool mutability;
+} Binding;
+
+/// @brief One scope's bindings, an open-addressed table keyed by `Intern_Id` that
+/// is never more than half full, an empty slot has a `name` of `INTERN_NONE`.
+typedef struct _Scope
+{
+    Binding *table;
+    uint32_t capacity;
+    uint32_t count;
+} Scope;
+
+VEC_DEFINE(Vec_Scope, Scope)
+
+/// @brief The scopes enclosing the code being resolved, innermost last. Every
+/// table is allocated out of `arena`.
+typedef struct _Scope_Chain
+{
+    Vec_Scope scopes;
+    Arena *arena;
+} Scope_Chain;
+
+/// @brief Creates an empty chain, push a scope before declaring anything.
+/// @param arena the arena the tables are allocated in, must not be `NULL`.
+Scope_Chain Scope_Chain_New(Arena *arena);
+
+/// @brief Opens a new innermost scope.
+/// @return `false` if the chain could not grow.
+bool Scope_Push(Scope_Chain *self);
+
+/// @brief Closes the innermost scope, its bindings go with it.
+void Scope_Pop(Scope_Chain *self);
+
+/// @brief Binds a name in the innermost scope, replacing a binding it already had.
+/// @return `false` if the scope could not grow.
+bool Scope_Declare(Scope_Chain *self, Binding binding);
+
+/// @brief Finds a name in the innermost scope only.
+/// @return the binding, `NULL` if the name is not bound there.
+Binding *Scope_Find_Local(Scope_Chain *self, Intern_Id name);
+
+/// @brief Finds a name in the innermost scope that binds it.
+/// @return the binding, `NULL` if no scope binds the name.
+Binding *Scope_Lookup(Scope_Chain *self, Intern_Id name);
+
+//===============================================================================//
+// RESOLVER
+//===============================================================================//
+
+/// @brief The result of resolving an AST. `slots` has an entry per node: the local
+/// slot for variables, assignments and the symbols that refer to a local, the
+/// `Builtin` for calls, `SLOT_NONE` for everything else.
+typedef struct _Resolved
+{
+    uint32_t *slots;
+    uint32_t local_count;
+    bool valid;
+} Resolved;
+
+/// @brief Binds every name in an AST to the declaration it refers to. Each
+/// declaration gets a slot of its own, numbered in source order, and assigning to
+/// a `let` is reported here as well as names that are not declared or declared
+/// twice in the same scope.
+/// @param ast the AST.
+/// @param arena the arena the slots and error messages are allocated in.
+/// @param errors where problems are reported.
+/// @return the slots, and `false` if anything was reported.
+Resolved Resolve(AST *ast, Arena *arena, Vec_Error *errors);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Scope_Chain(Test_Info *info);
+void Test_Resolver(Test_Info *info);
+
+#endif // RESOLVE_H
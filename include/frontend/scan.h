@@ -0,0 +1,55 @@
+#ifndef SCAN_H
+#define SCAN_H
+#include "util/tests.h"
+#include <stddef.h>
+
+//===============================================================================//
+// SCANNER DISPATCH
+//===============================================================================//
+
+/// @brief The instruction set the scanners are currently dispatching to. Picked at
+/// runtime the first time a scanner is called, the scalar level is always available.
+typedef enum _Scan_Level
+{
+    SCAN_SCALAR = 0,
+    SCAN_SSE2,
+    SCAN_AVX2,
+} Scan_Level;
+
+/// @brief Returns the best level supported by this CPU.
+Scan_Level Scan_Best_Level(void);
+
+/// @brief Returns the level the scanners are currently using.
+Scan_Level Scan_Get_Level(void);
+
+/// @brief Forces the scanners onto a level, clamped to what the CPU supports.
+/// Mostly useful for testing the vector paths against the scalar one.
+/// @param level the desired level.
+void Scan_Set_Level(Scan_Level level);
+
+//===============================================================================//
+// SCANNERS
+//===============================================================================//
+
+// Every scanner takes the source, the offset to start at and the length of the
+// source, and returns the offset of the first byte that ends the run (or `len`).
+
+/// @brief Skips a run of ' ', '\t' and '\r'.
+size_t Scan_Whitespace(const char *src, size_t pos, size_t len);
+
+/// @brief Skips a run of identifier characters, [A-Za-z0-9_].
+size_t Scan_Symbol(const char *src, size_t pos, size_t len);
+
+/// @brief Skips a run of digits and digit separators, [0-9_].
+size_t Scan_Digits(const char *src, size_t pos, size_t len);
+
+/// @brief Skips to the next '\n', used for single-line comment bodies.
+size_t Scan_Line(const char *src, size_t pos, size_t len);
+
+/// @brief Skips to the next '#', used for multi-line comment bodies.
+size_t Scan_Pound(const char *src, size_t pos, size_t len);
+
+/* Tests */
+void Test_Scan(Test_Info *info);
+
+#endif // SCAN_H
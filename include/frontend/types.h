@@ -0,0 +1,86 @@
+#ifndef TYPES_H
+#define TYPES_H
+#include "util/arena.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INIT_TYPE_CAPACITY 64
+
+//===============================================================================//
+// TYPE TABLE
+//===============================================================================//
+
+/// @brief Identifies one type in the global type table. Every type is built once
+/// and shared after that, so two types are the same exactly when their ids are.
+typedef uint32_t Type_Id;
+
+/* the primitives have fixed ids. `TYPE_NONE` is what an expression that already
+   failed to check gets, so one mistake is not reported again by everything around it */
+
+#define TYPE_NONE  ((Type_Id)0)
+#define TYPE_VOID  ((Type_Id)1)
+#define TYPE_INT   ((Type_Id)2)
+#define TYPE_FLOAT ((Type_Id)3)
+#define TYPE_BOOL  ((Type_Id)4)
+
+typedef enum _Type_Kind
+{
+    TYPE_KIND_NONE = 0,
+    TYPE_KIND_VOID,
+    TYPE_KIND_INT,
+    TYPE_KIND_FLOAT,
+    TYPE_KIND_BOOL,
+    TYPE_KIND_FUNCTION,
+    TYPE_KIND_ARRAY,
+} Type_Kind;
+
+/// @brief Returns the type of functions taking `params` and returning `ret`.
+/// @param ret the return type.
+/// @param params the parameter types, may be `NULL` when `count` is 0.
+/// @param count how many parameters there are.
+/// @return the type, `TYPE_NONE` if the table could not grow.
+Type_Id Type_Function(Type_Id ret, const Type_Id *params, uint32_t count);
+
+/// @brief Returns the type of arrays of `element`.
+/// @return the type, `TYPE_NONE` if the table could not grow.
+Type_Id Type_Array(Type_Id element);
+
+/// @brief Returns what kind of type a type is, `TYPE_KIND_NONE` for an unknown id.
+Type_Kind Type_Get_Kind(Type_Id id);
+
+/// @brief Returns the element type of an array type, `TYPE_NONE` for anything else.
+Type_Id Type_Element(Type_Id id);
+
+/// @brief Returns the return type of a function type, `TYPE_NONE` for anything else.
+Type_Id Type_Return(Type_Id id);
+
+/// @brief Returns the parameter types of a function type.
+/// @param id the function type.
+/// @param count where to write how many there are, 0 for anything but a function.
+/// @return the parameters, valid until the next type is added.
+const Type_Id *Type_Params(Type_Id id, uint32_t *count);
+
+/// @brief Returns whether values of a type can be used in arithmetic.
+bool Type_Is_Numeric(Type_Id id);
+
+/// @brief Spells a type the way it is shown in diagnostics, e.g. `fn(int, [float]) -> void`.
+/// @param arena the arena the string is allocated in.
+/// @param id the type.
+/// @return the nul-terminated name, `"?"` if it could not be allocated.
+const char *Type_Name(Arena *arena, Type_Id id);
+
+/// @brief Returns how many distinct types exist, the primitives included.
+size_t Type_Count(void);
+
+/// @brief Frees the whole table, every id but the primitives becomes invalid.
+void Types_Free(void);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Types(Test_Info *info);
+
+#endif // TYPES_H
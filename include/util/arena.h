@@ -0,0 +1,89 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include "util/tests.h"
+#include <stddef.h>
+
+#define ARENA_DEFAULT_PAGE_SIZE (64 * 1024)
+
+//===============================================================================//
+// ARENA ALLOCATOR
+//===============================================================================//
+
+/// @brief A page of arena memory, allocations are bumped out of `data`.
+typedef struct _Arena_Page
+{
+    struct _Arena_Page *next;
+    size_t used;
+    size_t size;
+    _Alignas(max_align_t) unsigned char data[];
+} Arena_Page;
+
+/// @brief A bump allocator for memory that all dies at once, like everything built
+/// for one compilation unit. Nothing is freed individually, the whole arena is
+/// rolled back with `Arena_Reset` or released with `Arena_Free`. Pages are kept
+/// around after a reset and reused by later allocations.
+typedef struct _Arena
+{
+    Arena_Page *first;
+    Arena_Page *current;
+    size_t page_size;
+} Arena;
+
+/// @brief A position in an arena to roll back to. The zeroed mark is the very
+/// start of the arena.
+typedef struct _Arena_Mark
+{
+    Arena_Page *page;
+    size_t used;
+} Arena_Mark;
+
+/// @brief Creates an empty arena, no memory is allocated until the first allocation.
+/// @param page_size the size of each page, 0 for `ARENA_DEFAULT_PAGE_SIZE`.
+/// @return the arena.
+Arena Arena_New(size_t page_size);
+
+/// @brief Allocates memory aligned for any type.
+/// @param self the arena.
+/// @param size how many bytes to allocate.
+/// @return the memory, `NULL` if a new page could not be allocated.
+void *Arena_Alloc(Arena *self, size_t size);
+
+/// @brief Grows an allocation. When it is the most recent allocation and its page
+/// has room it is extended in place, otherwise it is copied to a new allocation.
+/// @param self the arena.
+/// @param ptr the allocation, may be `NULL` to allocate fresh memory.
+/// @param old_size the size it was allocated with.
+/// @param new_size the size it needs to be.
+/// @return the grown allocation, `NULL` if memory ran out (`ptr` is left as it was).
+void *Arena_Grow(Arena *self, void *ptr, size_t old_size, size_t new_size);
+
+/// @brief Copies a string into the arena and nul-terminates it, used for lexemes
+/// and formatted messages that should live as long as the compilation unit.
+/// @param self the arena.
+/// @param str the string, does not need to be nul-terminated.
+/// @param len the length of the string.
+/// @return the copy, `NULL` if memory ran out.
+char *Arena_String(Arena *self, const char *str, size_t len);
+
+/// @brief Returns the current position of the arena.
+/// @param self the arena.
+/// @return the mark.
+Arena_Mark Arena_Get_Mark(const Arena *self);
+
+/// @brief Rolls the arena back, everything allocated after the mark is released at
+/// once while the pages are kept for reuse.
+/// @param self the arena.
+/// @param mark a mark taken from this arena.
+void Arena_Reset(Arena *self, Arena_Mark mark);
+
+/// @brief Frees every page of the arena.
+/// @param self the arena.
+void Arena_Free(Arena *self);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Arena(Test_Info *info);
+
+#endif // ARENA_H
@@ -1,56 +1,26 @@
 #ifndef COMMON_H
 #define COMMON_H
+#include "util/arena.h"
+#include "util/vec.h"
 #include "util/tests.h"
 #include <stddef.h>
 #include <stdbool.h>
-
-//===============================================================================//
-// DYNAMIC ARRAY IMPLEMENTATION
-//===============================================================================//
-
-#define LIST_GROWTH_FACTOR 2
-#define CHECK_LIST_COMPATIBILITY(list, type) ((list)->size == sizeof(type))
-
-typedef struct _List
-{
-    void *data;
-    size_t size;
-    size_t count;
-    size_t capacity;
-} List;
-
-/// @brief Creates a new empty list allocated to the initial capacity.
-/// @param size size of the items being stored in this list.
-/// @param init_capacity how big to make the array upon allocation.
-/// @return An empty list.
-List List_New(size_t size, size_t init_capacity);
-
-/// @brief Returns a pointer to the item at `n` position in the list.
-/// @param self the list itself.
-/// @param n the index of the desired item.
-/// @return the pointer to the item, will be `NULL` if out of bounds.
-void *List_Get(List *self, size_t n);
-
-/// @brief Push something to the list.
-/// @param self the list itself.
-/// @param element the item to add, deep copy into
-/// the array, free'd at the end of scope.
-void List_Add(List *self, void* element);
-
-/// @brief Free the list and everything in it. Be sure to free any dynamically allocated
-/// sub-array members before calling this.
-/// @param self the list to free.
-void List_Free(List *self);
+#include <stdint.h>
 
 //===============================================================================//
 // SPAN & LEXEME FUNCTIONS
 //===============================================================================//
 
-/// @brief Holds an offset+len style position for pointing to source code.
+/// @brief Identifies one source file of a compilation, see `Source_Manager`.
+typedef uint32_t File_Id;
+
+/// @brief Holds an offset+len style position for pointing to source code, along
+/// with the file that source code belongs to.
 typedef struct _Span
 {
     size_t pos;
     size_t len;
+    File_Id file;
 } Span;
 
 /// @brief Dynamically allocate and return a lexeme from the given offset+len.
@@ -60,6 +30,14 @@ typedef struct _Span
 /// @return dynamically allocated `char*`.
 char *Get_Lexeme(const char *src, size_t pos, size_t len);
 
+/// @brief Copy a lexeme from the given offset+len into an arena.
+/// @param arena the arena the lexeme lives in.
+/// @param src the source code the span points to.
+/// @param pos the offset into the source code.
+/// @param len how much of the source code to copy.
+/// @return the lexeme, `NULL` if the arena ran out of memory.
+char *Get_Lexeme_In(Arena *arena, const char *src, size_t pos, size_t len);
+
 /// @brief Compares whether or not two lexemes are the same
 /// @param src the source code the span points to
 /// @param span the offset+len to compare
@@ -71,82 +49,140 @@ bool Cmp_Lexeme(const char *src, const Span *span, const char *lit);
 /// @param str lexeme to alter.
 void Remove_Underbars(char *str);
 
+//===============================================================================//
+// LINE INDEX
+//===============================================================================//
+
+/// @brief The offset of the first character of every line in one source file. Built
+/// once per file, then offsets are turned into line/column with a binary search
+/// instead of rescanning the source.
+typedef struct _Line_Index
+{
+    uint32_t *starts;
+    size_t count;
+    size_t capacity;
+    size_t source_len;
+} Line_Index;
+
+/// @brief Builds the line index for a source.
+/// @param src the source code.
+/// @param len the length of the source code.
+/// @return the index, with a `count` of 0 if allocation failed.
+Line_Index Line_Index_Build(const char *src, size_t len);
+
+/// @brief Finds the line and column of an offset into the source.
+/// @param self the line index.
+/// @param pos the offset into the source.
+/// @param x where to write the column, 1-based.
+/// @param y where to write the line, 1-based.
+void Line_Index_Locate(const Line_Index *self, size_t pos, size_t *x, size_t *y);
+
+/// @brief Free the line index.
+/// @param self the line index.
+void Line_Index_Free(Line_Index *self);
+
 //===============================================================================//
 // TOKENS
 //===============================================================================//
 
+/// Each token is listed as `X(kind, name, spelling)`, where `spelling` is the exact
+/// text of fixed tokens (operators, punctuation and keywords) and `NULL` for everything
+/// else. The lexer builds its operator state machine and its keyword hash table straight
+/// from the spellings, so adding an operator or keyword only means adding its entry here.
 #define TOKEN_LIST \
-    X(TOK_ILLEGAL,            "ILLEGAL") \
-    X(TOK_OPEN_PAREN,         "OPEN_PAREN") \
-    X(TOK_CLOSE_PAREN,        "CLOSE_PAREN") \
-    X(TOK_OPEN_BRACE,         "OPEN_BRACE") \
-    X(TOK_CLOSE_BRACE,        "CLOSE_BRACE") \
-    X(TOK_OPEN_BRACKET,       "OPEN_BRACKET") \
-    X(TOK_CLOSE_BRACKET,      "CLOSE_BRACKET") \
-    X(TOK_NEWLINE,            "NEWLINE") \
-    X(TOK_PLUS,               "PLUS") \
-    X(TOK_MINUS,              "MINUS") \
-    X(TOK_STAR,               "STAR") \
-    X(TOK_SLASH,              "SLASH") \
-    X(TOK_PLUS_PLUS,          "PLUS_PLUS") \
-    X(TOK_MINUS_MINUS,        "MINUS_MINUS") \
-    X(TOK_STAR_STAR,          "STAR_STAR") \
-    X(TOK_PLUS_EQUALS,        "PLUS_EQUALS") \
-    X(TOK_MINUS_EQUALS,       "MINUS_EQUALS") \
-    X(TOK_STAR_EQUALS,        "STAR_EQUALS") \
-    X(TOK_STAR_STAR_EQUALS,   "STAR_STAR_EQUALS") \
-    X(TOK_SLASH_SLASH,        "SLASH_SLASH") \
-    X(TOK_SLASH_EQUALS,       "SLASH_EQUALS") \
-    X(TOK_SLASH_SLASH_EQUALS, "SLASH_SLASH_EQUALS") \
-    X(TOK_PERCENT,            "PERCENT") \
-    X(TOK_BANG,               "BANG") \
-    X(TOK_BANG_EQUALS,        "BANG_EQUALS") \
-    X(TOK_EQUALS,             "EQUALS") \
-    X(TOK_EQUALS_EQUALS,      "EQUALS_EQUALS") \
-    X(TOK_LESS,               "LESS") \
-    X(TOK_LESS_EQUALS,        "LESS_EQUALS") \
-    X(TOK_GREATER,            "GREATER") \
-    X(TOK_GREATER_EQUALS,     "GREATER_EQUALS") \
-    X(TOK_PIPE,               "PIPE") \
-    X(TOK_PIPE_PIPE,          "PIPE_PIPE") \
-    X(TOK_AMPSAND,            "AMPSAND") \
-    X(TOK_AMPSAND_AMPSAND,    "AMPSAND_AMPSAND") \
-    X(TOK_COLON,              "COLON") \
-    X(TOK_SEMICOLON,          "SEMICOLON") \
-    X(TOK_DOT,                "DOT") \
-    X(TOK_QUESTION,           "QUESTION") \
-    X(TOK_COMMA,              "COMMA") \
-    X(TOK_ARROW,              "ARROW") \
-    X(TOK_FAT_ARROW,          "FAT_ARROW") \
-    X(TOK_SYMBOL_LITERAL,     "SYMBOL_LITERAL") \
-    X(TOK_INTEGER_LITERAL,    "INTEGER_LITERAL") \
-    X(TOK_STRING_LITERAL,     "STRING_LITERAL") \
-    X(TOK_FLOAT_LITERAL,      "FLOAT_LITERAL") \
-    X(TOK_POUND_BANG,         "POUND_BANG") \
-    X(TOK_FUNC,               "FUNC") \
-    X(TOK_LET,                "LET") \
-    X(TOK_VAR,                "VAR") \
-    X(TOK_EOF,                "EOF")
+    X(TOK_ILLEGAL,              "ILLEGAL",            NULL) \
+    X(TOK_OPEN_PAREN,           "OPEN_PAREN",         "(") \
+    X(TOK_CLOSE_PAREN,          "CLOSE_PAREN",        ")") \
+    X(TOK_OPEN_BRACE,           "OPEN_BRACE",         "{") \
+    X(TOK_CLOSE_BRACE,          "CLOSE_BRACE",        "}") \
+    X(TOK_OPEN_BRACKET,         "OPEN_BRACKET",       "[") \
+    X(TOK_CLOSE_BRACKET,        "CLOSE_BRACKET",      "]") \
+    X(TOK_NEWLINE,              "NEWLINE",            NULL) \
+    X(TOK_PLUS,                 "PLUS",               "+") \
+    X(TOK_MINUS,                "MINUS",              "-") \
+    X(TOK_STAR,                 "STAR",               "*") \
+    X(TOK_SLASH,                "SLASH",              "/") \
+    X(TOK_PLUS_PLUS,            "PLUS_PLUS",          "++") \
+    X(TOK_MINUS_MINUS,          "MINUS_MINUS",        "--") \
+    X(TOK_STAR_STAR,            "STAR_STAR",          "**") \
+    X(TOK_PLUS_EQUALS,          "PLUS_EQUALS",        "+=") \
+    X(TOK_MINUS_EQUALS,         "MINUS_EQUALS",       "-=") \
+    X(TOK_STAR_EQUALS,          "STAR_EQUALS",        "*=") \
+    X(TOK_STAR_STAR_EQUALS,     "STAR_STAR_EQUALS",   "**=") \
+    X(TOK_SLASH_SLASH,          "SLASH_SLASH",        "//") \
+    X(TOK_SLASH_EQUALS,         "SLASH_EQUALS",       "/=") \
+    X(TOK_SLASH_SLASH_EQUALS,   "SLASH_SLASH_EQUALS", "//=") \
+    X(TOK_PERCENT,              "PERCENT",            "%") \
+    X(TOK_BANG,                 "BANG",               "!") \
+    X(TOK_BANG_EQUALS,          "BANG_EQUALS",        "!=") \
+    X(TOK_EQUALS,               "EQUALS",             "=") \
+    X(TOK_EQUALS_EQUALS,        "EQUALS_EQUALS",      "==") \
+    X(TOK_LESS,                 "LESS",               "<") \
+    X(TOK_LESS_EQUALS,          "LESS_EQUALS",        "<=") \
+    X(TOK_GREATER,              "GREATER",            ">") \
+    X(TOK_GREATER_EQUALS,       "GREATER_EQUALS",     ">=") \
+    X(TOK_PIPE,                 "PIPE",               "|") \
+    X(TOK_PIPE_PIPE,            "PIPE_PIPE",          "||") \
+    X(TOK_AMPSAND,              "AMPSAND",            "&") \
+    X(TOK_AMPSAND_AMPSAND,      "AMPSAND_AMPSAND",    "&&") \
+    X(TOK_COLON,                "COLON",              ":") \
+    X(TOK_SEMICOLON,            "SEMICOLON",          ";") \
+    X(TOK_DOT,                  "DOT",                ".") \
+    X(TOK_QUESTION,             "QUESTION",           "?") \
+    X(TOK_COMMA,                "COMMA",              ",") \
+    X(TOK_ARROW,                "ARROW",              "->") \
+    X(TOK_FAT_ARROW,            "FAT_ARROW",          "=>") \
+    X(TOK_SYMBOL_LITERAL,       "SYMBOL_LITERAL",     NULL) \
+    X(TOK_INTEGER_LITERAL,      "INTEGER_LITERAL",    NULL) \
+    X(TOK_STRING_LITERAL,       "STRING_LITERAL",     NULL) \
+    X(TOK_FLOAT_LITERAL,        "FLOAT_LITERAL",      NULL) \
+    X(TOK_POUND_BANG,           "POUND_BANG",         "#!") \
+    X(TOK_FUNC,                 "FUNC",               "func") \
+    X(TOK_LET,                  "LET",                "let") \
+    X(TOK_VAR,                  "VAR",                "var") \
+    X(TOK_MUT,                  "MUT",                "mut") \
+    X(TOK_PROC,                 "PROC",               "proc") \
+    X(TOK_END,                  "END",                "end") \
+    X(TOK_RETURN,               "RETURN",             "return") \
+    X(TOK_EOF,                  "EOF",                NULL)
 
 typedef enum _Token_Kind
 {
-    #define X(name, str) name,
+    #define X(name, str, spelling) name,
     TOKEN_LIST
     #undef X
 } Token_Kind;
 
 static const char *TOKEN_KIND_NAMES[] = {
-    #define X(name, str) [name] = str,
+    #define X(name, str, spelling) [name] = str,
     TOKEN_LIST
-    #undef x
+    #undef X
+};
+
+enum
+{
+    #define X(name, str, spelling) + 1
+    TOKEN_KIND_COUNT = 0 TOKEN_LIST,
+    #undef X
 };
 
+/// @brief Maps a `Token_Kind` to its fixed spelling, `NULL` if it has none.
+extern const char *const TOKEN_SPELLINGS[TOKEN_KIND_COUNT];
+
+/// @brief The value of a numeric literal, decoded by the lexer.
+typedef union _Token_Value
+{
+    int64_t int_value;
+    double float_value;
+} Token_Value;
+
 typedef struct _Token
 {
     Token_Kind kind;
     Span span;
     size_t x;
     size_t y;
+    Token_Value value;
 } Token;
 
 /// @brief Prints a token, including all of it's span information
@@ -160,36 +196,56 @@ void Print_Token(const char *src, Token const *self);
 #define OP_FLAG_UNARY  (1 << 1)
 #define OP_FLAG_ASSIGN (1 << 2)
 
+#define OP_ASSOC_LEFT  0
+#define OP_ASSOC_RIGHT 1
+
+/// Each operator is listed as `X(name, token, str, flag, power, assoc)`. `power` is
+/// the binding power of its infix form, higher binds tighter, and `assoc` says which
+/// way a chain of operators of the same power groups. The parser builds its
+/// precedence tables straight from this list. Prefix operators all bind at
+/// `OP_PREFIX_POWER`, tighter than any infix operator.
 #define OPERATOR_LIST \
-    X(OP_ADD,        TOK_PLUS,        "ADD",        OP_FLAG_BINARY) \
-    X(OP_SUB,        TOK_MINUS,       "SUBTRACT",   OP_FLAG_BINARY  | OP_FLAG_UNARY) \
-    X(OP_MUL,        TOK_STAR,        "MULTIPLY",   OP_FLAG_BINARY) \
-    X(OP_DIV,        TOK_SLASH,       "DIVIDE",     OP_FLAG_BINARY) \
-    X(OP_MOD,        TOK_PERCENT,     "MODULO",     OP_FLAG_BINARY) \
-    X(OP_ASSIGN,     TOK_EQUALS,      "ASSIGN",     OP_FLAG_ASSIGN) \
-    X(OP_ADD_ASSIGN, TOK_PLUS_EQUALS, "ADD-ASSIGN", OP_FLAG_ASSIGN) 
+    X(OP_ADD,        TOK_PLUS,         "ADD",        OP_FLAG_BINARY,                  20, OP_ASSOC_LEFT) \
+    X(OP_SUB,        TOK_MINUS,        "SUBTRACT",   OP_FLAG_BINARY  | OP_FLAG_UNARY, 20, OP_ASSOC_LEFT) \
+    X(OP_MUL,        TOK_STAR,         "MULTIPLY",   OP_FLAG_BINARY,                  30, OP_ASSOC_LEFT) \
+    X(OP_DIV,        TOK_SLASH,        "DIVIDE",     OP_FLAG_BINARY,                  30, OP_ASSOC_LEFT) \
+    X(OP_MOD,        TOK_PERCENT,      "MODULO",     OP_FLAG_BINARY,                  30, OP_ASSOC_LEFT) \
+    X(OP_ASSIGN,     TOK_EQUALS,       "ASSIGN",     OP_FLAG_ASSIGN,                  10, OP_ASSOC_RIGHT) \
+    X(OP_ADD_ASSIGN, TOK_PLUS_EQUALS,  "ADD-ASSIGN", OP_FLAG_ASSIGN,                  10, OP_ASSOC_RIGHT) \
+    X(OP_SUB_ASSIGN, TOK_MINUS_EQUALS, "SUB-ASSIGN", OP_FLAG_ASSIGN,                  10, OP_ASSOC_RIGHT) \
+    X(OP_MUL_ASSIGN, TOK_STAR_EQUALS,  "MUL-ASSIGN", OP_FLAG_ASSIGN,                  10, OP_ASSOC_RIGHT) \
+    X(OP_DIV_ASSIGN, TOK_SLASH_EQUALS, "DIV-ASSIGN", OP_FLAG_ASSIGN,                  10, OP_ASSOC_RIGHT)
+
+#define OP_PREFIX_POWER 40
 
 typedef enum _Operator
 {
-    #define X(name, token, str, flag) name,
+    #define X(name, token, str, flag, power, assoc) name,
     OPERATOR_LIST
     #undef X
 } Operator;
 
 /// @brief Returns the `Operator` pertaining to this token kind that is a binary operator.
-inline int Get_Binary_Operator(Token_Kind kind);
+int Get_Binary_Operator(Token_Kind kind);
 
 /// @brief Returns the `Operator` pertaining to this token kind that is a unary operator.
-inline int Get_Unary_Operator(Token_Kind kind);
+int Get_Unary_Operator(Token_Kind kind);
 
 /// @brief Returns the `Operator` pertaining to this token kind that is an assignment operator.
-inline int Get_Assign_Operator(Token_Kind kind);
+int Get_Assign_Operator(Token_Kind kind);
 
 /// @brief Maps an `Operator` to a `const char*`.
 static const char *OPERATOR_NAMES[] = {
-    #define X(name, token, str, flag) [name] = str,
+    #define X(name, token, str, flag, power, assoc) [name] = str,
     OPERATOR_LIST
     #undef X
 };
 
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Vec(Test_Info *info);
+void Test_Line_Index(Test_Info *info);
+
 #endif // COMMON_H
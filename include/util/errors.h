@@ -2,6 +2,8 @@
 #define ERRORS_H
 #include "util/tests.h"
 #include "util/common.h"
+#include "util/source.h"
+#include <stdarg.h>
 #include <stddef.h>
 
 //===============================================================================//
@@ -28,8 +30,6 @@ typedef struct _Error_Invalid_Return
     size_t def_x;
     size_t def_y;
     const char *def_type;
-    const char *def_path;
-    const char *def_src;
 } Error_Invalid_Return;
 
 //===============================================================================//
@@ -46,6 +46,13 @@ typedef enum _Error_Type
     ERR_EXPECTED_EXPRESSION,
     ERR_INVALID_LITERAL,
     ERR_INVALID_RETURN,
+    ERR_INTEGER_OVERFLOW,
+    ERR_DIVISION_BY_ZERO,
+    ERR_UNDECLARED_NAME,
+    ERR_DUPLICATE_NAME,
+    ERR_IMMUTABLE,
+    ERR_TYPE_MISMATCH,
+    ERR_COMPILER_LIMIT,
 } Error_Type;
 
 static const char* ERROR_TYPE_NAMES[] = {
@@ -55,8 +62,17 @@ static const char* ERROR_TYPE_NAMES[] = {
     "expected expression",
     "invalid literal",
     "invalid return type",
+    "integer overflow",
+    "division by zero",
+    "undeclared name",
+    "duplicate declaration",
+    "immutable binding",
+    "type mismatch",
+    "compiler limit",
 };
 
+/// @brief A diagnostic. `x` and `y` may be left 0 by passes that only know the
+/// span, they are then looked up from the span when the error is printed.
 typedef struct _Error
 {
     Error_Type type;
@@ -70,6 +86,8 @@ typedef struct _Error
     size_t msg_len;
 } Error;
 
+VEC_DEFINE(Vec_Error, Error)
+
 /// @brief Creates a fully allocated error from the information provided.
 /// @param type the type of error.
 /// @param x the column.
@@ -79,15 +97,34 @@ typedef struct _Error
 /// @return error instance.
 Error Make_Error(Error_Type type, size_t x, size_t y, Span const span, const char *msg);
 
+/// @brief Formats an error message into an arena, so messages that mention names or
+/// values live as long as the compilation unit without being freed one by one.
+/// @param arena the arena the message lives in.
+/// @param len where to write the length of the message, may be `NULL`.
+/// @param fmt the `printf` style format.
+/// @return the message, a fixed fallback message if the arena ran out of memory.
+const char *Error_Format(Arena *arena, size_t *len, const char *fmt, ...);
+
+/// @brief `Error_Format` taking a `va_list`, for helpers that forward their arguments.
+const char *Error_VFormat(Arena *arena, size_t *len, const char *fmt, va_list args);
+
 /// @brief Appends the `Error_Invalid_Return` subtype struct to the error. Will
 /// early return of the `self` parameter is not of type `ERR_INVALID_RETURN`.
 /// @param self the error instance.
 /// @param data the invalid return data to append.
 void Append_Invalid_Return(Error *self, Error_Invalid_Return data);
 
-void Print_Error(const char *src, const char *path, Error const *self);
+/// @brief Prints an error along with the line of source it points to, the source
+/// is looked up by the file of the error's span.
+/// @param sources the sources of the compilation.
+/// @param self the error.
+void Print_Error(Source_Manager *sources, Error const *self);
 void Free_Error(Error *self);
-void Report_Errors(List *errors, const char *src, const char *path);
+
+/// @brief Prints every error in the list.
+/// @param errors the errors.
+/// @param sources the sources of the compilation.
+void Report_Errors(Vec_Error *errors, Source_Manager *sources);
 
 //===============================================================================//
 // TESTS
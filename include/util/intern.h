@@ -0,0 +1,45 @@
+#ifndef INTERN_H
+#define INTERN_H
+#include "util/tests.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define INIT_INTERN_CAPACITY 256
+#define INTERN_PAGE_SIZE (16 * 1024)
+
+//===============================================================================//
+// STRING INTERNING
+//===============================================================================//
+
+/// @brief Identifies one distinct string in the global intern table. Two strings are
+/// equal exactly when their ids are, and an id stays valid until `Intern_Free`.
+typedef uint32_t Intern_Id;
+
+/// @brief Never handed out for a real string, use it for "no name".
+#define INTERN_NONE ((Intern_Id)0)
+
+/// @brief Interns a string, copying it into the table the first time it is seen.
+/// @param str the string, does not need to be nul-terminated.
+/// @param len the length of the string.
+/// @return the id of the string, `INTERN_NONE` if the table could not grow.
+Intern_Id Intern(const char *str, size_t len);
+
+/// @brief Returns the string behind an id. The pointer is stable and nul-terminated.
+/// @param id the id.
+/// @param len where to write the length of the string, may be `NULL`.
+/// @return the string, `NULL` for `INTERN_NONE` or an unknown id.
+const char *Intern_Lookup(Intern_Id id, size_t *len);
+
+/// @brief Returns how many distinct strings are interned.
+size_t Intern_Count(void);
+
+/// @brief Frees the whole table, every id handed out so far becomes invalid.
+void Intern_Free(void);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Intern(Test_Info *info);
+
+#endif // INTERN_H
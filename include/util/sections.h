@@ -0,0 +1,62 @@
+#ifndef SECTIONS_H
+#define SECTIONS_H
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define SECTION_ALIGN 8
+
+//===============================================================================//
+// SECTIONED FILES
+//===============================================================================//
+
+/* what the AST cache and bytecode images have in common: a header followed by
+   arrays that are mapped and used in place, each starting on an 8-byte boundary,
+   written to a file that readers may have mapped while it is being replaced */
+
+/// @brief Works out where each section of a file starts, the writer and the reader
+/// of a file both go through here so they cannot disagree.
+/// @param header_size the size of the header the first section comes after.
+/// @param sizes the size in bytes of each section.
+/// @param count how many sections there are.
+/// @param offsets where to write the offset of each section.
+/// @return the size of the whole file, the last section padded out like the others.
+size_t Layout_Sections(size_t header_size, const size_t *sizes, size_t count, size_t *offsets);
+
+/// @brief A file being written under a temporary name next to the one it replaces,
+/// so whoever has the old file mapped keeps the old pages and whoever opens it
+/// sees either the old file or the new one, never a half-written one.
+typedef struct _File_Replacement
+{
+    FILE *file;
+    const char *path;
+    char *temp;
+} File_Replacement;
+
+/// @brief Creates the temporary file that will replace `path`.
+/// @param path the path of the file to replace, it need not exist yet.
+/// @param out where to write the replacement.
+/// @return `false` if the temporary file could not be created.
+bool Replacement_Open(const char *path, File_Replacement *out);
+
+/// @brief Writes bytes at an offset in a replacement, anything skipped over is
+/// left as zeroes.
+/// @return `false` if the write failed.
+bool Replacement_Write(File_Replacement *self, size_t offset, const void *data, size_t len);
+
+/// @brief Pads the file out to its full size and renames it over the file it
+/// replaces, or throws it away if the writes failed.
+/// @param self the replacement, closed either way.
+/// @param size the size of the whole file, from `Layout_Sections`.
+/// @param ok whether every write went through.
+/// @return `false` if the file was not replaced, the old one is left as it was.
+bool Replacement_Close(File_Replacement *self, size_t size, bool ok);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Sections(Test_Info *info);
+
+#endif // SECTIONS_H
@@ -0,0 +1,99 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+#include "util/common.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define INIT_SOURCE_CAPACITY 8
+
+//===============================================================================//
+// MAPPED FILES
+//===============================================================================//
+
+/// @brief A read-only view of a whole file. Where the platform allows it the file
+/// is memory-mapped and nothing is copied, otherwise it is read into the heap.
+typedef struct _Mapped_File
+{
+    const char *data;
+    size_t len;
+    bool mapped;
+} Mapped_File;
+
+/// @brief Maps a file read-only.
+/// @param path the path of the file.
+/// @param out where to write the view.
+/// @return `false` if the file could not be opened or read.
+bool Map_File(const char *path, Mapped_File *out);
+
+/// @brief Releases a view created by `Map_File`.
+/// @param self the view.
+void Unmap_File(Mapped_File *self);
+
+//===============================================================================//
+// SOURCE MANAGER
+//===============================================================================//
+
+/// @brief One input to the compiler. `src` is NOT nul-terminated when the file is
+/// mapped, always go by `len`.
+typedef struct _Source_File
+{
+    const char *path;
+    const char *src;
+    size_t len;
+    Mapped_File file;
+    Line_Index lines;
+} Source_File;
+
+/// @brief Owns every source in a compilation. Each source is identified by the
+/// `File_Id` it is given when added, which is what `Span::file` refers to.
+typedef struct _Source_Manager
+{
+    Source_File *files;
+    size_t count;
+    size_t capacity;
+} Source_Manager;
+
+/// @brief Creates an empty source manager.
+/// @return the source manager, with a `capacity` of 0 if allocation failed.
+Source_Manager Source_Manager_New(void);
+
+/// @brief Maps a file and adds it to the manager.
+/// @param self the source manager.
+/// @param path the path of the file, must outlive the manager.
+/// @param id where to write the id of the new source.
+/// @return `false` if the file could not be loaded.
+bool Source_Load(Source_Manager *self, const char *path, File_Id *id);
+
+/// @brief Adds a source that already lives in memory, it is not copied.
+/// @param self the source manager.
+/// @param path the path shown for the source in diagnostics.
+/// @param src the source code, must outlive the manager.
+/// @param len the length of the source code.
+/// @param id where to write the id of the new source.
+/// @return `false` if the manager could not grow.
+bool Source_Add_Buffer(Source_Manager *self, const char *path, const char *src, size_t len, File_Id *id);
+
+/// @brief Returns the source with the given id.
+/// @param self the source manager.
+/// @param id the id of the source.
+/// @return the source, `NULL` if there is none with that id.
+const Source_File *Source_Get(const Source_Manager *self, File_Id id);
+
+/// @brief Returns the line index of a source, building it the first time it is asked for.
+/// @param self the source manager.
+/// @param id the id of the source.
+/// @return the line index, `NULL` if there is no source with that id.
+const Line_Index *Source_Lines(Source_Manager *self, File_Id id);
+
+/// @brief Unmaps every source and frees the manager.
+/// @param self the source manager.
+void Source_Manager_Free(Source_Manager *self);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_Source_Manager(Test_Info *info);
+
+#endif // SOURCE_H
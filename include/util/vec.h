@@ -0,0 +1,119 @@
+#ifndef VEC_H
+#define VEC_H
+#include "util/arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VEC_GROWTH_FACTOR 2
+#define VEC_MIN_CAPACITY 4
+
+//===============================================================================//
+// TYPED DYNAMIC ARRAYS
+//===============================================================================//
+
+/// @brief Defines a dynamic array of `T` named `Name` along with its functions, all
+/// prefixed with `Name`. The element size is known at compile time, so pushes and
+/// gets are plain typed stores and loads. A zeroed vec is a valid empty vec. When
+/// `arena` is set the storage comes out of the arena and `Name_Free` leaves it alone.
+///
+/// - `Name Name_New(size_t init_capacity)`
+/// - `Name Name_New_In(Arena *arena, size_t init_capacity)`
+/// - `bool Name_Reserve(Name *self, size_t additional)`
+/// - `bool Name_Push(Name *self, T value)`
+/// - `bool Name_Extend(Name *self, const T *items, size_t n)`
+/// - `T   *Name_Get(Name *self, size_t n)`, `NULL` when out of bounds
+/// - `bool Name_Pop(Name *self, T *out)`, `out` may be `NULL`
+/// - `void Name_Truncate(Name *self, size_t count)`
+/// - `void Name_Free(Name *self)`
+///
+/// Every function that can grow the vec returns `false` if the memory could not be
+/// allocated, in which case the vec is left untouched.
+#define VEC_DEFINE(Name, T)                                                             \
+    typedef struct _##Name                                                              \
+    {                                                                                   \
+        T *data;                                                                        \
+        size_t count;                                                                   \
+        size_t capacity;                                                                \
+        Arena *arena;                                                                   \
+    } Name;                                                                             \
+                                                                                        \
+    static inline bool Name##_Reserve(Name *self, size_t additional)                    \
+    {                                                                                   \
+        if (additional > SIZE_MAX / sizeof(T) - self->count) return false;              \
+        size_t needed = self->count + additional;                                       \
+        if (needed <= self->capacity) return true;                                      \
+                                                                                        \
+        size_t new_capacity = (self->capacity != 0) ? self->capacity : VEC_MIN_CAPACITY; \
+        while (new_capacity < needed)                                                   \
+            new_capacity = (new_capacity > SIZE_MAX / sizeof(T) / VEC_GROWTH_FACTOR)    \
+                         ? needed                                                       \
+                         : new_capacity * VEC_GROWTH_FACTOR;                            \
+                                                                                        \
+        T *new_data = (self->arena)                                                     \
+                    ? Arena_Grow(self->arena, self->data,                               \
+                                 self->capacity * sizeof(T), new_capacity * sizeof(T))  \
+                    : realloc(self->data, new_capacity * sizeof(T));                    \
+        if (!new_data) return false;                                                    \
+                                                                                        \
+        self->data = new_data;                                                          \
+        self->capacity = new_capacity;                                                  \
+        return true;                                                                    \
+    }                                                                                   \
+                                                                                        \
+    static inline Name Name##_New_In(Arena *arena, size_t init_capacity)                \
+    {                                                                                   \
+        Name self = (Name) {.arena = arena};                                            \
+        Name##_Reserve(&self, init_capacity);                                           \
+        return self;                                                                    \
+    }                                                                                   \
+                                                                                        \
+    static inline Name Name##_New(size_t init_capacity)                                 \
+    {                                                                                   \
+        return Name##_New_In(NULL, init_capacity);                                      \
+    }                                                                                   \
+                                                                                        \
+    static inline bool Name##_Push(Name *self, T value)                                 \
+    {                                                                                   \
+        if (self->count >= self->capacity && !Name##_Reserve(self, 1))                  \
+            return false;                                                               \
+        self->data[self->count++] = value;                                              \
+        return true;                                                                    \
+    }                                                                                   \
+                                                                                        \
+    static inline bool Name##_Extend(Name *self, const T *items, size_t n)              \
+    {                                                                                   \
+        if (n == 0) return true;                                                        \
+        if (!Name##_Reserve(self, n)) return false;                                     \
+        memcpy(self->data + self->count, items, n * sizeof(T));                         \
+        self->count += n;                                                               \
+        return true;                                                                    \
+    }                                                                                   \
+                                                                                        \
+    static inline T *Name##_Get(Name *self, size_t n)                                   \
+    {                                                                                   \
+        return (n < self->count) ? &self->data[n] : NULL;                               \
+    }                                                                                   \
+                                                                                        \
+    static inline bool Name##_Pop(Name *self, T *out)                                   \
+    {                                                                                   \
+        if (self->count == 0) return false;                                             \
+        self->count--;                                                                  \
+        if (out) *out = self->data[self->count];                                        \
+        return true;                                                                    \
+    }                                                                                   \
+                                                                                        \
+    static inline void Name##_Truncate(Name *self, size_t count)                        \
+    {                                                                                   \
+        if (count < self->count) self->count = count;                                   \
+    }                                                                                   \
+                                                                                        \
+    static inline void Name##_Free(Name *self)                                          \
+    {                                                                                   \
+        if (!self->arena) free(self->data);                                             \
+        *self = (Name) {0};                                                             \
+    }
+
+#endif // VEC_H
@@ -0,0 +1,71 @@
+#ifndef VM_H
+#define VM_H
+#include "backend/bytecode.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//===============================================================================//
+// DISPATCH
+//===============================================================================//
+
+/* the interpreter jumps straight from one instruction's handler to the next with
+   computed gotos where the compiler has them (GCC and Clang), and falls back on a
+   `switch` in a loop everywhere else. Define SUDU_SWITCH_DISPATCH to force the
+   fallback, the build has an option for it */
+
+#if defined(__GNUC__) && !defined(SUDU_SWITCH_DISPATCH)
+#define VM_THREADED_DISPATCH 1
+#else
+#define VM_THREADED_DISPATCH 0
+#endif
+
+//===============================================================================//
+// VIRTUAL MACHINE
+//===============================================================================//
+
+typedef enum _Run_Status
+{
+    RUN_OK,
+    RUN_INVALID_CODE,
+    RUN_OUT_OF_MEMORY,
+    RUN_DIVISION_BY_ZERO,
+} Run_Status;
+
+/// @brief The interpreter. Registers are bare 64-bit slots, the instruction says
+/// how to read them. The register file is kept between runs and only grows,
+/// `error_pc` is the instruction a failed run stopped at.
+typedef struct _VM
+{
+    Slot *registers;
+    size_t capacity;
+    FILE *out;
+    uint32_t error_pc;
+} VM;
+
+/// @brief Creates an interpreter.
+/// @param out where `print` writes to.
+VM VM_New(FILE *out);
+
+/// @brief Runs a function until it halts. The function is verified first, after
+/// which the dispatch loop trusts every operand.
+/// @param self the interpreter.
+/// @param fn the function.
+/// @return `RUN_OK`, or why the run stopped.
+Run_Status VM_Run(VM *self, const Function *fn);
+
+/// @brief Returns a message for a failed run.
+const char *Run_Status_Message(Run_Status status);
+
+/// @brief Frees the register file.
+void VM_Free(VM *self);
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_VM(Test_Info *info);
+
+#endif // VM_H
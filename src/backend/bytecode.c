@@ -0,0 +1,243 @@
+#include "backend/bytecode.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INIT_FUNCTION_CODE_CAPACITY 64
+#define INIT_FUNCTION_CONSTANT_CAPACITY 16
+
+static const char *OPCODE_NAMES[] = {
+    #define X(name, str, format, regs) [name] = str,
+    OPCODE_LIST
+    #undef X
+};
+
+static const uint8_t OPCODE_FORMATS[] = {
+    #define X(name, str, format, regs) [name] = format,
+    OPCODE_LIST
+    #undef X
+};
+
+static const char *NATIVE_NAMES[] = {
+    #define X(name, str) [name] = str,
+    NATIVE_LIST
+    #undef X
+};
+
+static const uint8_t OPCODE_REGISTERS[] = {
+    #define X(name, str, format, regs) [name] = regs,
+    OPCODE_LIST
+    #undef X
+};
+
+//-------------------------------------------------------------------------------//
+// functions
+//-------------------------------------------------------------------------------//
+
+Function Function_New(Arena *arena, Intern_Id name, File_Id file)
+{
+    return (Function) {
+        .code = Vec_Instruction_New_In(arena, INIT_FUNCTION_CODE_CAPACITY),
+        .positions = Vec_Code_Pos_New_In(arena, INIT_FUNCTION_CODE_CAPACITY),
+        .constants = Vec_Value_New_In(arena, INIT_FUNCTION_CONSTANT_CAPACITY),
+        .name = name,
+        .file = file,
+    };
+}
+
+bool Function_Emit(Function *self, Instruction ins, uint32_t pos)
+{
+    if (!Vec_Code_Pos_Reserve(&self->positions, 1)) return false;
+    if (!Vec_Instruction_Push(&self->code, ins)) return false;
+    Vec_Code_Pos_Push(&self->positions, pos);
+    return true;
+}
+
+/* constants are compared bit for bit, so 0.0 and -0.0 stay apart */
+static bool same_value(Value a, Value b)
+{
+    return a.kind == b.kind && memcmp(&a.as, &b.as, sizeof(a.as)) == 0;
+}
+
+bool Function_Constant(Function *self, Value value, uint32_t *index)
+{
+    for (size_t i = 0; i < self->constants.count; i++)
+    {
+        if (!same_value(self->constants.data[i], value)) continue;
+        *index = (uint32_t)i;
+        return true;
+    }
+
+    if (self->constants.count > BC_BX_MAX) return false;
+    if (!Vec_Value_Push(&self->constants, value)) return false;
+    *index = (uint32_t)(self->constants.count - 1);
+    return true;
+}
+
+void Function_Free(Function *self)
+{
+    Vec_Instruction_Free(&self->code);
+    Vec_Code_Pos_Free(&self->positions);
+    Vec_Value_Free(&self->constants);
+}
+
+bool Function_Verify(const Function *self)
+{
+    size_t count = self->code.count;
+    if (count == 0 || self->positions.count != count) return false;
+    if (INS_OP(self->code.data[count - 1]) != BC_HALT) return false;
+    if (self->register_count > BC_REGISTER_MAX + 1) return false;
+
+    for (size_t i = 0; i < self->constants.count; i++)
+        if (self->constants.data[i].kind > VALUE_FLOAT) return false;
+
+    uint32_t regs = self->register_count;
+    for (size_t i = 0; i < count; i++)
+    {
+        Instruction ins = self->code.data[i];
+        uint8_t op = INS_OP(ins);
+        if (op >= BC_OPCODE_COUNT) return false;
+
+        uint8_t used = OPCODE_REGISTERS[op];
+        if ((used & REG_A) && INS_A(ins) >= regs) return false;
+        if ((used & REG_B) && INS_B(ins) >= regs) return false;
+        if ((used & REG_C) && INS_C(ins) >= regs) return false;
+        if ((used & REG_WINDOW) && (uint32_t)INS_A(ins) + INS_C(ins) > regs) return false;
+
+        if (op == BC_LOADK && INS_BX(ins) >= self->constants.count) return false;
+        if (op == BC_CALLB && INS_B(ins) >= NATIVE_COUNT) return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------//
+// disassembly
+//-------------------------------------------------------------------------------//
+
+const char *Opcode_Name(uint8_t op)
+{
+    return (op < BC_OPCODE_COUNT) ? OPCODE_NAMES[op] : "???";
+}
+
+const char *Native_Name(uint8_t native)
+{
+    return (native < NATIVE_COUNT) ? NATIVE_NAMES[native] : "???";
+}
+
+Ins_Format Opcode_Format(uint8_t op)
+{
+    return (op < BC_OPCODE_COUNT) ? (Ins_Format)OPCODE_FORMATS[op] : FORMAT_NONE;
+}
+
+uint8_t Opcode_Registers(uint8_t op)
+{
+    return (op < BC_OPCODE_COUNT) ? OPCODE_REGISTERS[op] : 0;
+}
+
+static void print_value(Value value, FILE *out)
+{
+    switch (value.kind)
+    {
+    case VALUE_INT: fprintf(out, "%" PRId64, value.as.i); break;
+    case VALUE_FLOAT: fprintf(out, "%g", value.as.f); break;
+    default: fprintf(out, "?"); break;
+    }
+}
+
+void Print_Instruction(const Function *self, Instruction ins, FILE *out)
+{
+    uint8_t op = INS_OP(ins);
+    fprintf(out, "%-8s", Opcode_Name(op));
+    if (op >= BC_OPCODE_COUNT) return;
+
+    switch (OPCODE_FORMATS[op])
+    {
+    case FORMAT_A: fprintf(out, "%u", INS_A(ins)); break;
+    case FORMAT_AB: fprintf(out, "%u %u", INS_A(ins), INS_B(ins)); break;
+    case FORMAT_ABC:
+    {
+        fprintf(out, "%u %u %u", INS_A(ins), INS_B(ins), INS_C(ins));
+        if (op == BC_CALLB) fprintf(out, "\t; %s", Native_Name(INS_B(ins)));
+        break;
+    }
+    case FORMAT_ASBX: fprintf(out, "%u %" PRId32, INS_A(ins), INS_SBX(ins)); break;
+    case FORMAT_ABSC: fprintf(out, "%u %u %" PRId32, INS_A(ins), INS_B(ins), INS_SC(ins)); break;
+    case FORMAT_ABX:
+    {
+        fprintf(out, "%u %u", INS_A(ins), INS_BX(ins));
+        if (op == BC_LOADK && INS_BX(ins) < self->constants.count)
+        {
+            fprintf(out, "\t; ");
+            print_value(self->constants.data[INS_BX(ins)], out);
+        }
+        break;
+    }
+    default: break;
+    }
+}
+
+void Disassemble(const Function *self, const Line_Index *lines, FILE *out)
+{
+    size_t name_len = 0;
+    const char *name = Intern_Lookup(self->name, &name_len);
+    fprintf(out, "function <%.*s> (%zu instructions, %u registers, %zu constants)\n",
+        (int)name_len, name ? name : "?", self->code.count,
+        (unsigned)self->register_count, self->constants.count);
+
+    for (size_t i = 0; i < self->code.count; i++)
+    {
+        size_t x = 0, y = self->positions.data[i];
+        if (lines) Line_Index_Locate(lines, self->positions.data[i], &x, &y);
+        fprintf(out, "  %04zu  [%4zu]  ", i, y);
+        Print_Instruction(self, self->code.data[i], out);
+        fputc('\n', out);
+    }
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Bytecode(Test_Info *info)
+{
+    Instruction abc = MAKE_ABC(BC_ADD_I64, 1, 2, 255);
+    Instruction abx = MAKE_ABX(BC_LOADK, 7, BC_BX_MAX);
+    Instruction neg = MAKE_ASBX(BC_LOADI, 3, -BC_SBX_BIAS);
+    Instruction pos = MAKE_ASBX(BC_LOADI, 3, BC_SBX_BIAS);
+    Instruction imm = MAKE_ABSC(BC_ADDI, 4, 5, -BC_SC_BIAS);
+    bool ok = INS_OP(abc) == BC_ADD_I64 && INS_A(abc) == 1 && INS_B(abc) == 2 && INS_C(abc) == 255
+           && INS_OP(abx) == BC_LOADK && INS_A(abx) == 7 && INS_BX(abx) == BC_BX_MAX
+           && INS_SBX(neg) == -BC_SBX_BIAS && INS_SBX(pos) == BC_SBX_BIAS
+           && INS_A(imm) == 4 && INS_B(imm) == 5 && INS_SC(imm) == -BC_SC_BIAS;
+
+    /* equal constants share a slot, -0.0 is not 0.0 */
+    Function fn = Function_New(NULL, Intern("main", 4), 0);
+    uint32_t a, b, c, d;
+    ok = ok && Function_Constant(&fn, FLOAT_VALUE(2.5), &a)
+            && Function_Constant(&fn, INT_VALUE(100000), &b)
+            && Function_Constant(&fn, FLOAT_VALUE(2.5), &c)
+            && Function_Constant(&fn, FLOAT_VALUE(-0.0), &d)
+            && a == 0 && b == 1 && c == 0 && d == 2 && fn.constants.count == 3;
+
+    ok = ok && Function_Emit(&fn, MAKE_ABX(BC_LOADK, 0, b), 0)
+            && Function_Emit(&fn, MAKE_ASBX(BC_LOADI, 1, -1), 4)
+            && Function_Emit(&fn, MAKE_ABC(BC_ADD_I64, 0, 0, 1), 8)
+            && Function_Emit(&fn, MAKE_ABC(BC_HALT, 0, 0, 0), 8)
+            && fn.code.count == 4 && fn.positions.count == 4;
+    fn.register_count = 2;
+    Disassemble(&fn, NULL, stdout);
+
+    Function_Free(&fn);
+    if (!Assert(ok, info, "instructions did not encode as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
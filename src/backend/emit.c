@@ -0,0 +1,369 @@
+#include "backend/emit.h"
+#include "backend/bytecode.h"
+#include "backend/peephole.h"
+#include "backend/regalloc.h"
+#include "frontend/ast.h"
+#include "frontend/check.h"
+#include "frontend/parser.h"
+#include "frontend/resolve.h"
+#include "frontend/types.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//===============================================================================//
+// EMITTER STATE
+//===============================================================================//
+
+/* every arithmetic operator, compound assignments included, to its instruction
+   for integers and for floats */
+
+static const uint8_t INT_OPCODES[] = {
+    [OP_ADD] = BC_ADD_I64, [OP_SUB] = BC_SUB_I64, [OP_MUL] = BC_MUL_I64,
+    [OP_DIV] = BC_DIV_I64, [OP_MOD] = BC_MOD_I64,
+    [OP_ADD_ASSIGN] = BC_ADD_I64, [OP_SUB_ASSIGN] = BC_SUB_I64,
+    [OP_MUL_ASSIGN] = BC_MUL_I64, [OP_DIV_ASSIGN] = BC_DIV_I64,
+};
+
+static const uint8_t FLOAT_OPCODES[] = {
+    [OP_ADD] = BC_ADD_F64, [OP_SUB] = BC_SUB_F64, [OP_MUL] = BC_MUL_F64,
+    [OP_DIV] = BC_DIV_F64, [OP_MOD] = BC_MOD_F64,
+    [OP_ADD_ASSIGN] = BC_ADD_F64, [OP_SUB_ASSIGN] = BC_SUB_F64,
+    [OP_MUL_ASSIGN] = BC_MUL_F64, [OP_DIV_ASSIGN] = BC_DIV_F64,
+};
+
+/// @brief State of lowering one function. Every value gets a virtual register of
+/// its own, local slot `n` being virtual register `n`, and the register allocator
+/// decides later which of them can share.
+typedef struct _emitter
+{
+    AST *ast;
+    const Resolved *resolved;
+    const Checked *checked;
+    Arena *arena;
+    Vec_Error *errs;
+    Function fn;
+    Lowered low;
+    bool failed;
+} emitter;
+
+/// @brief Reports that the function outgrew the instruction format, only once.
+static void limit_error(emitter *e, Node_Idx id, const char *message)
+{
+    if (e->failed) return;
+    e->failed = true;
+
+    Error err = (Error) {
+        .type = ERR_COMPILER_LIMIT,
+        .span = AST_Get_Span(e->ast, id),
+    };
+    err.message = Error_Format(e->arena, &err.msg_len, "%s", message);
+    Vec_Error_Push(e->errs, err);
+}
+
+static void emit(emitter *e, Node_Idx id, uint8_t op, uint32_t a, uint32_t b, uint32_t c)
+{
+    if (e->failed) return;
+    Lowered_Ins ins = (Lowered_Ins) {.op = op, .a = a, .b = b, .c = c};
+    if (!Vec_Code_Pos_Reserve(&e->low.positions, 1) || !Vec_Lowered_Ins_Push(&e->low.code, ins))
+    {
+        e->failed = true;
+        return;
+    }
+    Vec_Code_Pos_Push(&e->low.positions, (uint32_t)AST_Get_Span(e->ast, id).pos);
+}
+
+static uint32_t new_vreg(emitter *e)
+{
+    return e->low.vreg_count++;
+}
+
+static bool is_float(emitter *e, Node_Idx id)
+{
+    return e->checked->types[id] == TYPE_FLOAT;
+}
+
+/// @brief Returns the instruction for an arithmetic operator on the type of `id`.
+static uint8_t arith_opcode(emitter *e, Node_Idx id, Operator op)
+{
+    return is_float(e, id) ? FLOAT_OPCODES[op] : INT_OPCODES[op];
+}
+
+//===============================================================================//
+// LOWERING
+//===============================================================================//
+
+static void emit_expr(emitter *e, Node_Idx id, uint32_t dest);
+
+/// @brief Returns the register holding a value. A local is used where it is,
+/// anything else is computed into a new temporary.
+static uint32_t emit_operand(emitter *e, Node_Idx id)
+{
+    while (AST_Get_Kind(e->ast, id) == NODE_GROUPING)
+        id = AST_Get_Inner(e->ast, id);
+
+    uint32_t slot = e->resolved->slots[id];
+    if (AST_Get_Kind(e->ast, id) == NODE_SYMBOL && slot != SLOT_NONE)
+        return slot;
+
+    uint32_t reg = new_vreg(e);
+    emit_expr(e, id, reg);
+    return reg;
+}
+
+static Walk_Action find_assignment(AST *ast, Node_Idx id, uint32_t depth, void *ctx)
+{
+    (void)depth;
+    (void)ctx;
+    return (AST_Get_Kind(ast, id) == NODE_ASSIGNMENT) ? WALK_STOP : WALK_CONTINUE;
+}
+
+/// @brief Returns whether computing a node can assign to a local, a walk that
+/// could not finish counts as yes.
+static bool has_assignment(emitter *e, Node_Idx id)
+{
+    AST_Visitor visitor = (AST_Visitor) {.pre = find_assignment};
+    return !AST_Walk(e->ast, id, &visitor);
+}
+
+/// @brief Like `emit_operand`, for an operand that is read after `later` has been
+/// computed. A local is copied first when `later` could assign to it, so the
+/// operand keeps the value it had when it was evaluated, left to right.
+static uint32_t emit_operand_before(emitter *e, Node_Idx id, Node_Idx later)
+{
+    uint32_t reg = emit_operand(e, id);
+    if (reg >= e->resolved->local_count || !has_assignment(e, later))
+        return reg;
+
+    uint32_t copy = new_vreg(e);
+    emit(e, id, BC_MOVE, copy, reg, 0);
+    return copy;
+}
+
+static void emit_constant(emitter *e, Node_Idx id, uint32_t dest, Value value)
+{
+    uint32_t index;
+    if (!Function_Constant(&e->fn, value, &index))
+    {
+        limit_error(e, id, "This function has more constants than the VM can address.");
+        return;
+    }
+    emit(e, id, BC_LOADK, dest, index, 0);
+}
+
+static void emit_integer(emitter *e, Node_Idx id, uint32_t dest)
+{
+    int64_t value = AST_Get_Integer(e->ast, id);
+    if (value >= -BC_SBX_BIAS && value <= BC_SBX_BIAS)
+        emit(e, id, BC_LOADI, dest, (uint32_t)(int32_t)value, 0);
+    else
+        emit_constant(e, id, dest, INT_VALUE(value));
+}
+
+/// @brief Lowers an assignment, the value goes straight into the local's register.
+/// A compound assignment reads the local before computing the value.
+/// @return the register of the local.
+static uint32_t emit_assignment(emitter *e, Node_Idx id)
+{
+    Node_Assignment assign = AST_Get_Assignment(e->ast, id);
+    uint32_t target = e->resolved->slots[id];
+
+    if (assign.op == OP_ASSIGN)
+    {
+        emit_expr(e, assign.val, target);
+        return target;
+    }
+
+    uint32_t current = target;
+    if (has_assignment(e, assign.val))
+    {
+        current = new_vreg(e);
+        emit(e, id, BC_MOVE, current, target, 0);
+    }
+    uint32_t value = emit_operand(e, assign.val);
+    emit(e, id, arith_opcode(e, id, assign.op), target, current, value);
+    return target;
+}
+
+/// @brief Lowers a call, the arguments are put in a window of registers. The
+/// checker has made sure `print`, the only builtin, has a single argument, whose
+/// type picks the native.
+static void emit_call(emitter *e, Node_Idx id)
+{
+    Node_List args = AST_Get_List(e->ast, AST_Get_Call(e->ast, id).args);
+    Native native = (args.count > 0 && is_float(e, args.nodes[0])) ? NATIVE_PRINT_F64 : NATIVE_PRINT_I64;
+    Reg_Window window = (Reg_Window) {.base = e->low.vreg_count, .count = args.count};
+    e->low.vreg_count += args.count;
+    if (args.count > 0 && !Vec_Reg_Window_Push(&e->low.windows, window))
+    {
+        e->failed = true;
+        return;
+    }
+
+    /* the list is a window into the AST, read it again after every argument */
+    for (uint32_t i = 0; i < args.count; i++)
+        emit_expr(e, AST_Get_List(e->ast, AST_Get_Call(e->ast, id).args).nodes[i], window.base + i);
+
+    emit(e, id, BC_CALLB, window.base, native, args.count);
+}
+
+/// @brief Lowers an expression so its value ends up in `dest`. Operands are all
+/// computed before `dest` is written, so `dest` may be one of them.
+static void emit_expr(emitter *e, Node_Idx id, uint32_t dest)
+{
+    if (e->failed) return;
+    AST *ast = e->ast;
+
+    switch (AST_Get_Kind(ast, id))
+    {
+    case NODE_INTEGER: emit_integer(e, id, dest); break;
+    case NODE_FLOAT: emit_constant(e, id, dest, FLOAT_VALUE(AST_Get_Float(ast, id))); break;
+    case NODE_SYMBOL:
+    {
+        uint32_t slot = e->resolved->slots[id];
+        if (slot != dest) emit(e, id, BC_MOVE, dest, slot, 0);
+        break;
+    }
+    case NODE_GROUPING: emit_expr(e, AST_Get_Inner(ast, id), dest); break;
+    case NODE_UNARY:
+    {
+        uint32_t operand = emit_operand(e, AST_Get_Unary(ast, id).operand);
+        emit(e, id, is_float(e, id) ? BC_NEG_F64 : BC_NEG_I64, dest, operand, 0);
+        break;
+    }
+    case NODE_BINARY:
+    {
+        Node_Binary bin = AST_Get_Binary(ast, id);
+        uint32_t lhs = emit_operand_before(e, bin.lhs, bin.rhs);
+        uint32_t rhs = emit_operand(e, bin.rhs);
+        emit(e, id, arith_opcode(e, id, bin.op), dest, lhs, rhs);
+        break;
+    }
+    case NODE_ASSIGNMENT:
+    {
+        uint32_t target = emit_assignment(e, id);
+        if (target != dest) emit(e, id, BC_MOVE, dest, target, 0);
+        break;
+    }
+    case NODE_CALL: emit_call(e, id); break;
+    default: break;
+    }
+}
+
+static void emit_statement(emitter *e, Node_Idx id)
+{
+    switch (AST_Get_Kind(e->ast, id))
+    {
+    case NODE_VARIABLE:
+    {
+        /* a discarded value is still computed, for whatever it does on the way */
+        uint32_t slot = e->resolved->slots[id];
+        Node_Idx init = AST_Get_Variable(e->ast, id).initializer;
+        emit_expr(e, init, (slot != SLOT_NONE) ? slot : new_vreg(e));
+        break;
+    }
+    case NODE_ASSIGNMENT: emit_assignment(e, id); break;
+    case NODE_CALL: emit_call(e, id); break;
+    default: emit_expr(e, id, new_vreg(e)); break;
+    }
+}
+
+Emitted Emit_Function(AST *ast, const Resolved *resolved, const Checked *checked, Arena *arena,
+                      Vec_Error *errors)
+{
+    emitter e = (emitter) {
+        .ast = ast,
+        .resolved = resolved,
+        .checked = checked,
+        .arena = arena,
+        .errs = errors,
+        .fn = Function_New(arena, Intern("main", 4), ast->file),
+        .low = (Lowered) {
+            .code = Vec_Lowered_Ins_New_In(arena, AST_Count(ast)),
+            .positions = Vec_Code_Pos_New_In(arena, AST_Count(ast)),
+            .windows = Vec_Reg_Window_New_In(arena, 0),
+            .vreg_count = resolved->local_count,
+        },
+    };
+
+    for (size_t i = 0; !e.failed && i < ast->items.count; i++)
+        emit_statement(&e, ast->items.data[i]);
+    emit(&e, NODE_NONE, BC_HALT, 0, 0, 0);
+    if (e.failed) return (Emitted) {.fn = e.fn};
+
+    Optimize_Peephole(&e.low);
+    uint32_t overflow_at;
+    if (!Allocate_Registers(&e.low, &e.fn, &overflow_at))
+    {
+        /* find the statement the overflow happened in to point at it */
+        Node_Idx at = NODE_NONE;
+        for (size_t i = 0; i < ast->items.count; i++)
+            if (overflow_at < e.low.positions.count
+                && AST_Get_Span(ast, ast->items.data[i]).pos <= e.low.positions.data[overflow_at])
+                at = ast->items.data[i];
+        limit_error(&e, at, "This function needs more registers than the VM has.");
+    }
+
+    return (Emitted) {.fn = e.fn, .valid = !e.failed};
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Emitter(Test_Info *info)
+{
+    const char *src = "var i = 0\n"
+                      "i = i + 1\n"
+                      "print(i)\n"
+                      "let big = 100000\n"
+                      "let _ = -(i * 2) + big\n"
+                      "print(1.5 * 2.0)\n";
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+    Resolved resolved = Resolve(&parsed.ast, &arena, &errors);
+    Checked checked = Check_Types(&parsed.ast, &resolved, &arena, &errors);
+    Emitted emitted = Emit_Function(&parsed.ast, &resolved, &checked, &arena, &errors);
+    Disassemble(&emitted.fn, NULL, stdout);
+
+    /* `i` is dead after `i * 2`, so its register is reused right away */
+    Instruction expected[] = {
+        MAKE_ASBX(BC_LOADI, 0, 0),
+        MAKE_ABC(BC_INCR, 0, 0, 0),
+        MAKE_ABC(BC_MOVE, 1, 0, 0),
+        MAKE_ABC(BC_CALLB, 1, NATIVE_PRINT_I64, 1),
+        MAKE_ABX(BC_LOADK, 1, 0),
+        MAKE_ASBX(BC_LOADI, 2, 2),
+        MAKE_ABC(BC_MUL_I64, 0, 0, 2),
+        MAKE_ABC(BC_NEG_I64, 0, 0, 0),
+        MAKE_ABC(BC_ADD_I64, 0, 0, 1),
+        MAKE_ABX(BC_LOADK, 0, 1),
+        MAKE_ABX(BC_LOADK, 1, 2),
+        MAKE_ABC(BC_MUL_F64, 0, 0, 1),
+        MAKE_ABC(BC_CALLB, 0, NATIVE_PRINT_F64, 1),
+        MAKE_ABC(BC_HALT, 0, 0, 0),
+    };
+    size_t count = sizeof(expected) / sizeof(expected[0]);
+
+    Function *fn = &emitted.fn;
+    bool ok = parsed.valid && resolved.valid && checked.valid && emitted.valid
+           && fn->code.count == count && fn->register_count == 3
+           && memcmp(fn->code.data, expected, sizeof(expected)) == 0
+           && fn->constants.count == 3 && fn->constants.data[0].as.i == 100000
+           && fn->positions.data[1] == 14;
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "emitted code was not what was expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
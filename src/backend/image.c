@@ -0,0 +1,413 @@
+#include "backend/image.h"
+#include "backend/bytecode.h"
+#include "backend/emit.h"
+#include "frontend/check.h"
+#include "frontend/parser.h"
+#include "frontend/resolve.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/intern.h"
+#include "util/sections.h"
+#include "util/source.h"
+#include "util/tests.h"
+#include "vm/vm.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//===============================================================================//
+// FILE LAYOUT
+//===============================================================================//
+
+/* an image is the header followed by these sections, each starting on an 8-byte
+   boundary so the mapped arrays can be used in place:
+
+     functions  function_count image_function
+     code       code_count Instruction, every function's code back to back
+     positions  code_count uint32_t, parallel to the code
+     constants  constant_count Value, every function's pool back to back
+     lines      line_count uint32_t, the line starts of the source
+     lengths    string_count uint32_t
+     strings    string_bytes bytes, every string followed by a nul
+
+   names are indices into the strings, since an `Intern_Id` only means something
+   to the process that handed it out. Like the AST cache everything is in the
+   host's byte order and layout, an image from a machine that differs fails the
+   magic */
+
+#define IMAGE_MAGIC 0x43445553u /* "SUDC" */
+
+_Static_assert(sizeof(Value) == 16, "constants are mapped straight out of an image");
+
+typedef struct _image_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t function_count;
+    uint32_t code_count;
+    uint32_t constant_count;
+    uint32_t line_count;
+    uint32_t source_len;
+    uint32_t source_path;
+    uint32_t string_count;
+    uint32_t string_bytes;
+} image_header;
+
+/// @brief Where one function's arrays are in the shared sections.
+typedef struct _image_function
+{
+    uint32_t name;
+    uint32_t register_count;
+    uint32_t code_start;
+    uint32_t code_count;
+    uint32_t constant_start;
+    uint32_t constant_count;
+} image_function;
+
+typedef enum _image_section
+{
+    SECTION_FUNCTIONS,
+    SECTION_CODE,
+    SECTION_POSITIONS,
+    SECTION_CONSTANTS,
+    SECTION_LINES,
+    SECTION_LENGTHS,
+    SECTION_STRINGS,
+    SECTION_COUNT,
+} image_section;
+
+/// @brief Works out where each section starts.
+/// @return the size of the whole file.
+static size_t layout(const image_header *h, size_t offsets[SECTION_COUNT])
+{
+    size_t sizes[SECTION_COUNT] = {
+        [SECTION_FUNCTIONS] = (size_t)h->function_count * sizeof(image_function),
+        [SECTION_CODE] = (size_t)h->code_count * sizeof(Instruction),
+        [SECTION_POSITIONS] = (size_t)h->code_count * sizeof(uint32_t),
+        [SECTION_CONSTANTS] = (size_t)h->constant_count * sizeof(Value),
+        [SECTION_LINES] = (size_t)h->line_count * sizeof(uint32_t),
+        [SECTION_LENGTHS] = (size_t)h->string_count * sizeof(uint32_t),
+        [SECTION_STRINGS] = h->string_bytes,
+    };
+
+    return Layout_Sections(sizeof(image_header), sizes, SECTION_COUNT, offsets);
+}
+
+//===============================================================================//
+// PATHS
+//===============================================================================//
+
+static bool ends_with(const char *str, const char *suffix)
+{
+    size_t len = strlen(str), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+const char *Image_Path(Arena *arena, const char *path)
+{
+    /* `.sudu` only needs the `c` of `.suduc` */
+    const char *ext = ends_with(path, ".sudu") ? "c" : IMAGE_EXTENSION;
+    size_t len = strlen(path);
+    size_t ext_len = strlen(ext);
+    char *out = Arena_Alloc(arena, len + ext_len + 1);
+    if (!out) return NULL;
+
+    memcpy(out, path, len);
+    memcpy(out + len, ext, ext_len + 1);
+    return out;
+}
+
+bool Is_Image_Path(const char *path)
+{
+    return ends_with(path, IMAGE_EXTENSION);
+}
+
+//===============================================================================//
+// WRITING
+//===============================================================================//
+
+/// @brief The strings of an image as they are being collected.
+typedef struct _string_table
+{
+    uint32_t *lengths;
+    char *bytes;
+    uint32_t count;
+    uint32_t used;
+} string_table;
+
+static uint32_t add_string(string_table *t, const char *str, size_t len)
+{
+    memcpy(t->bytes + t->used, str, len);
+    t->bytes[t->used + len] = '\0';
+    t->lengths[t->count] = (uint32_t)len;
+    t->used += (uint32_t)len + 1;
+    return t->count++;
+}
+
+bool Image_Write(const char *path, const Function *functions, uint32_t count,
+                 const char *source_path, const Line_Index *lines)
+{
+    image_header h = (image_header) {
+        .magic = IMAGE_MAGIC,
+        .version = IMAGE_VERSION,
+        .function_count = count,
+        .line_count = lines ? (uint32_t)lines->count : 0,
+        .source_len = lines ? (uint32_t)lines->source_len : 0,
+        .string_count = count + 1,
+    };
+
+    /* the source path first, then every function's name */
+    size_t path_len = strlen(source_path);
+    h.string_bytes = (uint32_t)path_len + 1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        size_t len = 0;
+        Intern_Lookup(functions[i].name, &len);
+        h.string_bytes += (uint32_t)len + 1;
+        h.code_count += (uint32_t)functions[i].code.count;
+        h.constant_count += (uint32_t)functions[i].constants.count;
+    }
+
+    image_function *records = calloc((size_t)count + 1, sizeof(image_function));
+    Value *constants = calloc((size_t)h.constant_count + 1, sizeof(Value));
+    string_table strings = (string_table) {
+        .lengths = malloc(((size_t)h.string_count + 1) * sizeof(uint32_t)),
+        .bytes = malloc((size_t)h.string_bytes + 1),
+    };
+    bool ok = records && constants && strings.lengths && strings.bytes;
+
+    uint32_t code_at = 0, constant_at = 0;
+    if (ok) h.source_path = add_string(&strings, source_path, path_len);
+    for (uint32_t i = 0; ok && i < count; i++)
+    {
+        const Function *fn = &functions[i];
+        size_t name_len = 0;
+        const char *name = Intern_Lookup(fn->name, &name_len);
+
+        records[i] = (image_function) {
+            .name = add_string(&strings, name ? name : "", name ? name_len : 0),
+            .register_count = fn->register_count,
+            .code_start = code_at,
+            .code_count = (uint32_t)fn->code.count,
+            .constant_start = constant_at,
+            .constant_count = (uint32_t)fn->constants.count,
+        };
+
+        /* copied field by field so the padding goes out as zeroes */
+        for (size_t k = 0; k < fn->constants.count; k++, constant_at++)
+        {
+            constants[constant_at].kind = fn->constants.data[k].kind;
+            constants[constant_at].as = fn->constants.data[k].as;
+        }
+        code_at += (uint32_t)fn->code.count;
+    }
+
+    size_t offsets[SECTION_COUNT];
+    size_t size = layout(&h, offsets);
+
+    /* written beside the old image and renamed over it, a run may have the old
+       one mapped */
+    File_Replacement file = {0};
+    ok = ok && Replacement_Open(path, &file);
+    ok = ok
+      && Replacement_Write(&file, 0, &h, sizeof(h))
+      && Replacement_Write(&file, offsets[SECTION_FUNCTIONS], records, count * sizeof(image_function))
+      && Replacement_Write(&file, offsets[SECTION_CONSTANTS], constants, h.constant_count * sizeof(Value))
+      && Replacement_Write(&file, offsets[SECTION_LINES], lines ? lines->starts : NULL, h.line_count * sizeof(uint32_t))
+      && Replacement_Write(&file, offsets[SECTION_LENGTHS], strings.lengths, h.string_count * sizeof(uint32_t))
+      && Replacement_Write(&file, offsets[SECTION_STRINGS], strings.bytes, h.string_bytes);
+
+    for (uint32_t i = 0; ok && i < count; i++)
+    {
+        const Function *fn = &functions[i];
+        size_t code = offsets[SECTION_CODE] + (size_t)records[i].code_start * sizeof(Instruction);
+        size_t positions = offsets[SECTION_POSITIONS] + (size_t)records[i].code_start * sizeof(uint32_t);
+        ok = Replacement_Write(&file, code, fn->code.data, fn->code.count * sizeof(Instruction))
+          && Replacement_Write(&file, positions, fn->positions.data, fn->code.count * sizeof(uint32_t));
+    }
+    if (file.file) ok = Replacement_Close(&file, size, ok);
+
+    free(records);
+    free(constants);
+    free(strings.lengths);
+    free(strings.bytes);
+    return ok;
+}
+
+//===============================================================================//
+// LOADING
+//===============================================================================//
+
+/// @brief Checks every string ends in a nul where its length says, and writes
+/// where each one starts.
+static bool read_strings(const image_header *h, const uint32_t *lengths, const char *bytes,
+                         uint32_t *starts)
+{
+    uint32_t at = 0;
+    for (uint32_t i = 0; i < h->string_count; i++)
+    {
+        if (lengths[i] >= h->string_bytes - at || bytes[at + lengths[i]] != '\0')
+            return false;
+        starts[i] = at;
+        at += lengths[i] + 1;
+    }
+    return true;
+}
+
+static bool in_range(uint32_t start, uint32_t count, uint32_t total)
+{
+    return start <= total && count <= total - start;
+}
+
+bool Image_Load(const char *path, Image *out)
+{
+    *out = (Image) {0};
+    if (!Map_File(path, &out->file)) return false;
+    out->arena = Arena_New(0);
+
+    image_header h;
+    size_t offsets[SECTION_COUNT];
+    bool ok = out->file.len >= sizeof(h);
+    if (ok) memcpy(&h, out->file.data, sizeof(h));
+    ok = ok && h.magic == IMAGE_MAGIC && h.version == IMAGE_VERSION && h.function_count > 0
+            && h.string_count > h.source_path && layout(&h, offsets) == out->file.len;
+    if (!ok)
+    {
+        Image_Free(out);
+        return false;
+    }
+
+    /* the pointer fix-ups, every array is used where it was mapped */
+    const char *base = out->file.data;
+    const image_function *records = (const image_function *)(base + offsets[SECTION_FUNCTIONS]);
+    Instruction *code = (Instruction *)(base + offsets[SECTION_CODE]);
+    uint32_t *positions = (uint32_t *)(base + offsets[SECTION_POSITIONS]);
+    Value *constants = (Value *)(base + offsets[SECTION_CONSTANTS]);
+    const uint32_t *lengths = (const uint32_t *)(base + offsets[SECTION_LENGTHS]);
+    const char *strings = base + offsets[SECTION_STRINGS];
+
+    uint32_t *starts = Arena_Alloc(&out->arena, ((size_t)h.string_count + 1) * sizeof(uint32_t));
+    out->functions = Arena_Alloc(&out->arena, ((size_t)h.function_count + 1) * sizeof(Function));
+    ok = starts && out->functions && read_strings(&h, lengths, strings, starts);
+
+    for (uint32_t i = 0; ok && i < h.function_count; i++)
+    {
+        image_function r = records[i];
+        ok = r.name < h.string_count
+          && in_range(r.code_start, r.code_count, h.code_count)
+          && in_range(r.constant_start, r.constant_count, h.constant_count);
+        if (!ok) break;
+
+        /* the arrays are read-only and never grow, the arena only keeps `Vec_Free`
+           off them */
+        Function *fn = &out->functions[i];
+        *fn = (Function) {
+            .code = {code + r.code_start, r.code_count, r.code_count, &out->arena},
+            .positions = {positions + r.code_start, r.code_count, r.code_count, &out->arena},
+            .constants = {constants + r.constant_start, r.constant_count, r.constant_count, &out->arena},
+            .name = Intern(strings + starts[r.name], lengths[r.name]),
+            .register_count = r.register_count,
+        };
+        ok = fn->name != INTERN_NONE;
+        out->function_count++;
+    }
+
+    if (!ok)
+    {
+        Image_Free(out);
+        return false;
+    }
+
+    out->source_path = strings + starts[h.source_path];
+    out->lines = (Line_Index) {
+        .starts = (uint32_t *)(base + offsets[SECTION_LINES]),
+        .count = h.line_count,
+        .source_len = h.source_len,
+    };
+    return true;
+}
+
+void Image_Free(Image *self)
+{
+    Unmap_File(&self->file);
+    Arena_Free(&self->arena);
+    *self = (Image) {0};
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Image(Test_Info *info)
+{
+    const char *path = "sudu_image_test" IMAGE_EXTENSION;
+    const char *src = "var x = 1.5\n"
+                      "x *= -2.0\n"
+                      "print(x)\n"
+                      "let big = 100000\n"
+                      "print(big + 1)\n"
+                      "print(big / (big - big))\n";
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+    Resolved resolved = Resolve(&parsed.ast, &arena, &errors);
+    Checked checked = Check_Types(&parsed.ast, &resolved, &arena, &errors);
+    Emitted emitted = Emit_Function(&parsed.ast, &resolved, &checked, &arena, &errors);
+    Line_Index lines = Line_Index_Build(src, strlen(src));
+
+    Function *fn = &emitted.fn;
+    bool ok = parsed.valid && resolved.valid && checked.valid && emitted.valid
+           && strcmp(Image_Path(&arena, "dir/main.sudu"), "dir/main" IMAGE_EXTENSION) == 0
+           && Image_Write(path, fn, 1, "main.sudu", &lines);
+
+    /* the loaded function is the written one, down to the positions */
+    Image image;
+    bool loaded = ok && Image_Load(path, &image);
+    Function *copy = loaded ? &image.functions[0] : NULL;
+    ok = loaded && image.function_count == 1
+      && copy->name == fn->name && copy->register_count == fn->register_count
+      && copy->code.count == fn->code.count && copy->constants.count == fn->constants.count
+      && memcmp(copy->code.data, fn->code.data, fn->code.count * sizeof(Instruction)) == 0
+      && memcmp(copy->positions.data, fn->positions.data, fn->code.count * sizeof(uint32_t)) == 0
+      && copy->constants.data[0].kind == VALUE_FLOAT && copy->constants.data[0].as.f == 1.5
+      && strcmp(image.source_path, "main.sudu") == 0 && image.lines.count == lines.count;
+
+    /* it runs straight out of the mapping, and errors still find their line */
+    FILE *out = tmpfile();
+    VM vm = VM_New(out);
+    char buffer[64] = {0};
+    ok = ok && out && VM_Run(&vm, copy) == RUN_DIVISION_BY_ZERO;
+    if (ok)
+    {
+        rewind(out);
+        buffer[fread(buffer, 1, sizeof(buffer) - 1, out)] = '\0';
+        size_t x = 0, y = 0;
+        Line_Index_Locate(&image.lines, copy->positions.data[vm.error_pc], &x, &y);
+        ok = strcmp(buffer, "-3\n100001\n") == 0 && y == 6;
+    }
+    if (out) fclose(out);
+    if (loaded) Image_Free(&image);
+
+    /* a file that is not an image of this version is refused */
+    FILE *file = fopen(path, "wb");
+    const uint32_t stale[] = {IMAGE_MAGIC, IMAGE_VERSION + 1};
+    ok = ok && file && fwrite(stale, sizeof(stale), 1, file) == 1;
+    if (file) fclose(file);
+    ok = ok && !Image_Load(path, &image)
+            && !Image_Load("sudu_image_test_missing" IMAGE_EXTENSION, &image);
+
+    remove(path);
+    VM_Free(&vm);
+    Line_Index_Free(&lines);
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "image did not round-trip the function"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,229 @@
+#include "backend/peephole.h"
+#include "backend/bytecode.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* an instruction a rewrite has done away with, dropped when the code is compacted */
+#define OP_DEAD BC_OPCODE_COUNT
+
+#define DEF_NONE UINT32_MAX
+#define DEF_MANY (UINT32_MAX - 1)
+
+//-------------------------------------------------------------------------------//
+// def-use counts
+//-------------------------------------------------------------------------------//
+
+/// @brief What the rewrites need to know about every virtual register: how many
+/// instructions read it, and which one writes it if only one does.
+typedef struct _peephole
+{
+    Lowered_Ins *code;
+    uint32_t *reads;
+    uint32_t *def;
+    size_t rewrites;
+} peephole;
+
+static bool writes_a(uint8_t op)
+{
+    return (Opcode_Registers(op) & REG_A) != 0;
+}
+
+static void count(peephole *p, size_t at)
+{
+    Lowered_Ins ins = p->code[at];
+    uint8_t regs = Opcode_Registers(ins.op);
+    if (regs & REG_B) p->reads[ins.b]++;
+    if (regs & REG_C) p->reads[ins.c]++;
+    if (regs & REG_WINDOW)
+        for (uint32_t k = 0; k < ins.c; k++)
+            p->reads[ins.a + k]++;
+
+    if (ins.op == BC_INCR) p->reads[ins.a]++;
+    if (writes_a(ins.op))
+        p->def[ins.a] = (p->def[ins.a] == DEF_NONE) ? (uint32_t)at : DEF_MANY;
+}
+
+//-------------------------------------------------------------------------------//
+// rewrites
+//-------------------------------------------------------------------------------//
+
+/// @brief Returns whether a register holds nothing but a small integer loaded for
+/// the one instruction that reads it, and what the integer is.
+static bool immediate(peephole *p, uint32_t vreg, size_t before, int32_t *value)
+{
+    uint32_t def = p->def[vreg];
+    if (p->reads[vreg] != 1 || def >= before) return false;
+    if (p->code[def].op != BC_LOADI) return false;
+
+    *value = (int32_t)p->code[def].b;
+    return *value >= -BC_SC_BIAS && *value <= BC_SC_BIAS;
+}
+
+/// @brief `LOADI t k; ADD x y t` to `ADDI x y k`, `SUB` with `-k`.
+static void fuse_immediate(peephole *p, size_t at)
+{
+    Lowered_Ins *ins = &p->code[at];
+    uint32_t other, vreg;
+    int32_t value;
+
+    if (immediate(p, ins->c, at, &value))
+    {
+        other = ins->b;
+        vreg = ins->c;
+        if (ins->op == BC_SUB_I64) value = -value;
+    }
+    else if (ins->op == BC_ADD_I64 && immediate(p, ins->b, at, &value))
+    {
+        other = ins->c;
+        vreg = ins->b;
+    }
+    else return;
+
+    p->code[p->def[vreg]].op = OP_DEAD;
+    p->reads[vreg] = 0;
+    *ins = (Lowered_Ins) {.op = BC_ADDI, .a = ins->a, .b = other, .c = (uint32_t)value};
+    p->rewrites++;
+}
+
+/// @brief `op t ...; MOVE x t` to `op x ...` when nothing else reads `t`. The
+/// instruction reads its operands before it writes, so `x` may be one of them.
+static size_t coalesce_move(peephole *p, size_t at)
+{
+    Lowered_Ins move = p->code[at];
+    size_t prev = at;
+    while (prev > 0 && p->code[prev - 1].op == OP_DEAD)
+        prev--;
+    if (prev == 0) return at;
+
+    Lowered_Ins *def = &p->code[prev - 1];
+    if (!writes_a(def->op) || def->op == BC_INCR) return at;
+    if (def->a != move.b || move.a == move.b || p->reads[move.b] != 1) return at;
+
+    /* `x` is now written twice, so it can no longer pass for a one-off load */
+    def->a = move.a;
+    p->def[move.a] = DEF_MANY;
+    p->reads[move.b] = 0;
+    p->code[at].op = OP_DEAD;
+    p->rewrites++;
+    return prev - 1;
+}
+
+/// @brief `ADDI x x 1` to `INCR x`.
+static void fuse_increment(peephole *p, size_t at)
+{
+    Lowered_Ins *ins = &p->code[at];
+    if (ins->op != BC_ADDI || ins->a != ins->b || (int32_t)ins->c != 1) return;
+
+    *ins = (Lowered_Ins) {.op = BC_INCR, .a = ins->a};
+    p->rewrites++;
+}
+
+size_t Optimize_Peephole(Lowered *lowered)
+{
+    size_t n = lowered->code.count;
+    uint32_t v = lowered->vreg_count;
+    uint32_t *block = malloc((size_t)v * 2 * sizeof(uint32_t) + 1);
+    if (!block) return 0;
+
+    peephole p = (peephole) {.code = lowered->code.data, .reads = block, .def = block + v};
+    memset(p.reads, 0, (size_t)v * sizeof(uint32_t));
+    for (uint32_t i = 0; i < v; i++)
+        p.def[i] = DEF_NONE;
+    for (size_t i = 0; i < n; i++)
+        count(&p, i);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t at = i;
+        switch (p.code[i].op)
+        {
+        case BC_ADD_I64:
+        case BC_SUB_I64: fuse_immediate(&p, i); break;
+        case BC_MOVE: at = coalesce_move(&p, i); break;
+        default: break;
+        }
+        fuse_increment(&p, at);
+    }
+
+    /* drop the dead instructions, their positions with them */
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (p.code[i].op == OP_DEAD) continue;
+        p.code[kept] = p.code[i];
+        lowered->positions.data[kept] = lowered->positions.data[i];
+        kept++;
+    }
+    Vec_Lowered_Ins_Truncate(&lowered->code, kept);
+    Vec_Code_Pos_Truncate(&lowered->positions, kept);
+
+    free(block);
+    return p.rewrites;
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+static bool lower(Lowered *self, uint8_t op, uint32_t a, uint32_t b, uint32_t c)
+{
+    return Vec_Lowered_Ins_Push(&self->code, (Lowered_Ins) {.op = op, .a = a, .b = b, .c = c})
+        && Vec_Code_Pos_Push(&self->positions, (uint32_t)self->code.count);
+}
+
+void Test_Peephole(Test_Info *info)
+{
+    Lowered low = {.vreg_count = 10};
+    bool ok = lower(&low, BC_LOADI, 0, 0, 0)            /* var i = 0 */
+           && lower(&low, BC_LOADI, 2, 1, 0)
+           && lower(&low, BC_ADD_I64, 0, 0, 2)          /* i = i + 1 */
+           && lower(&low, BC_LOADI, 3, 10, 0)
+           && lower(&low, BC_ADD_I64, 4, 3, 0)
+           && lower(&low, BC_MOVE, 1, 4, 0)             /* var j = 10 + i */
+           && lower(&low, BC_LOADI, 5, 2, 0)
+           && lower(&low, BC_SUB_I64, 1, 1, 5)          /* j -= 2 */
+           && lower(&low, BC_LOADI, 6, 1000, 0)
+           && lower(&low, BC_ADD_I64, 1, 1, 6)          /* j += 1000, too big for sC */
+           && lower(&low, BC_LOADI, 7, 3, 0)
+           && lower(&low, BC_MUL_I64, 8, 7, 7)          /* read twice, stays a load */
+           && lower(&low, BC_ADD_I64, 9, 1, 8)
+           && lower(&low, BC_MOVE, 0, 9, 0)             /* i = j + 3 * 3 */
+           && lower(&low, BC_HALT, 0, 0, 0);
+
+    Lowered_Ins expected[] = {
+        {.op = BC_LOADI, .a = 0, .b = 0},
+        {.op = BC_INCR, .a = 0},
+        {.op = BC_ADDI, .a = 1, .b = 0, .c = 10},
+        {.op = BC_ADDI, .a = 1, .b = 1, .c = (uint32_t)-2},
+        {.op = BC_LOADI, .a = 6, .b = 1000},
+        {.op = BC_ADD_I64, .a = 1, .b = 1, .c = 6},
+        {.op = BC_LOADI, .a = 7, .b = 3},
+        {.op = BC_MUL_I64, .a = 8, .b = 7, .c = 7},
+        {.op = BC_ADD_I64, .a = 0, .b = 1, .c = 8},
+        {.op = BC_HALT},
+    };
+    size_t count = sizeof(expected) / sizeof(expected[0]);
+
+    ok = ok && Optimize_Peephole(&low) == 6 && low.code.count == count && low.positions.count == count;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        Lowered_Ins got = low.code.data[i];
+        ok = got.op == expected[i].op && got.a == expected[i].a
+          && got.b == expected[i].b && got.c == expected[i].c;
+    }
+
+    /* what survives keeps the position it had, the fused `ADDI` the `ADD`'s */
+    ok = ok && low.positions.data[1] == 3 && low.positions.data[2] == 5;
+
+    Vec_Lowered_Ins_Free(&low.code);
+    Vec_Code_Pos_Free(&low.positions);
+    if (!Assert(ok, info, "lowered code was not rewritten as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,246 @@
+#include "backend/regalloc.h"
+#include "backend/bytecode.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANGE_NONE UINT32_MAX
+
+//-------------------------------------------------------------------------------//
+// live ranges
+//-------------------------------------------------------------------------------//
+
+/// @brief A window is allocated as one unit, led by its first virtual register,
+/// every other virtual register leads a unit of its own. `order` lists the leaders
+/// by the start of their range, which is the order the scan takes them in.
+typedef struct _live_ranges
+{
+    uint32_t *leader;
+    uint32_t *width;
+    uint32_t *start;
+    uint32_t *end;
+    uint32_t *order;
+    uint32_t *phys;
+    uint32_t count;
+} live_ranges;
+
+static void touch(live_ranges *r, uint32_t vreg, uint32_t at)
+{
+    uint32_t l = r->leader[vreg];
+    if (r->start[l] == RANGE_NONE)
+    {
+        r->start[l] = at;
+        r->order[r->count++] = l;
+    }
+    r->end[l] = at;
+}
+
+static bool compute_ranges(const Lowered *lowered, live_ranges *r)
+{
+    uint32_t n = lowered->vreg_count;
+    uint32_t *block = malloc((size_t)n * 6 * sizeof(uint32_t) + 1);
+    if (!block) return false;
+
+    *r = (live_ranges) {
+        .leader = block,
+        .width = block + n,
+        .start = block + 2 * (size_t)n,
+        .end = block + 3 * (size_t)n,
+        .order = block + 4 * (size_t)n,
+        .phys = block + 5 * (size_t)n,
+    };
+    for (uint32_t v = 0; v < n; v++)
+    {
+        r->leader[v] = v;
+        r->width[v] = 1;
+        r->start[v] = RANGE_NONE;
+    }
+    for (size_t i = 0; i < lowered->windows.count; i++)
+    {
+        Reg_Window w = lowered->windows.data[i];
+        r->width[w.base] = w.count;
+        for (uint32_t k = 0; k < w.count; k++)
+            r->leader[w.base + k] = w.base;
+    }
+
+    for (size_t i = 0; i < lowered->code.count; i++)
+    {
+        Lowered_Ins ins = lowered->code.data[i];
+        uint8_t regs = Opcode_Registers(ins.op);
+        if (regs & (REG_A | REG_WINDOW)) touch(r, ins.a, (uint32_t)i);
+        if (regs & REG_B) touch(r, ins.b, (uint32_t)i);
+        if (regs & REG_C) touch(r, ins.c, (uint32_t)i);
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------//
+// linear scan
+//-------------------------------------------------------------------------------//
+
+/// @brief Finds the lowest run of `width` free registers.
+/// @return the first register of the run, `RANGE_NONE` if there is none.
+static uint32_t find_free(const bool used[BC_REGISTER_MAX + 1], uint32_t width)
+{
+    uint32_t run = 0;
+    for (uint32_t reg = 0; reg <= BC_REGISTER_MAX; reg++)
+    {
+        run = used[reg] ? 0 : run + 1;
+        if (run == width) return reg + 1 - width;
+    }
+    return RANGE_NONE;
+}
+
+/// @brief Gives each unit its registers. A unit whose range ends at the instruction
+/// another one starts at hands its registers over, since an instruction reads its
+/// operands before it writes.
+static bool scan(live_ranges *r, uint32_t *register_count, uint32_t *overflow_at)
+{
+    bool used[BC_REGISTER_MAX + 1] = {0};
+    uint32_t active[BC_REGISTER_MAX + 1];
+    uint32_t active_count = 0;
+    *register_count = 0;
+
+    for (uint32_t i = 0; i < r->count; i++)
+    {
+        uint32_t unit = r->order[i];
+        uint32_t at = r->start[unit];
+
+        uint32_t kept = 0;
+        for (uint32_t k = 0; k < active_count; k++)
+        {
+            uint32_t other = active[k];
+            if (r->end[other] > at)
+            {
+                active[kept++] = other;
+                continue;
+            }
+            memset(used + r->phys[other], 0, r->width[other] * sizeof(bool));
+        }
+        active_count = kept;
+
+        uint32_t base = find_free(used, r->width[unit]);
+        if (base == RANGE_NONE)
+        {
+            *overflow_at = at;
+            return false;
+        }
+
+        r->phys[unit] = base;
+        memset(used + base, 1, r->width[unit] * sizeof(bool));
+        active[active_count++] = unit;
+        if (base + r->width[unit] > *register_count)
+            *register_count = base + r->width[unit];
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------//
+// encoding
+//-------------------------------------------------------------------------------//
+
+static uint32_t physical(const live_ranges *r, uint32_t vreg)
+{
+    uint32_t l = r->leader[vreg];
+    return r->phys[l] + (vreg - l);
+}
+
+static Instruction encode(const live_ranges *r, Lowered_Ins ins)
+{
+    uint8_t regs = Opcode_Registers(ins.op);
+    uint32_t a = (regs & (REG_A | REG_WINDOW)) ? physical(r, ins.a) : ins.a;
+    uint32_t b = (regs & REG_B) ? physical(r, ins.b) : ins.b;
+    uint32_t c = (regs & REG_C) ? physical(r, ins.c) : ins.c;
+
+    switch (Opcode_Format(ins.op))
+    {
+    case FORMAT_ASBX: return MAKE_ASBX(ins.op, a, (int32_t)b);
+    case FORMAT_ABSC: return MAKE_ABSC(ins.op, a, b, (int32_t)c);
+    case FORMAT_ABX: return MAKE_ABX(ins.op, a, b);
+    default: return MAKE_ABC(ins.op, a, b, c);
+    }
+}
+
+bool Allocate_Registers(const Lowered *lowered, Function *out, uint32_t *overflow_at)
+{
+    live_ranges r;
+    if (!compute_ranges(lowered, &r)) return false;
+
+    uint32_t register_count;
+    bool ok = scan(&r, &register_count, overflow_at);
+    for (size_t i = 0; ok && i < lowered->code.count; i++)
+    {
+        Instruction ins = encode(&r, lowered->code.data[i]);
+        if (INS_OP(ins) == BC_MOVE && INS_A(ins) == INS_B(ins)) continue;
+        ok = Function_Emit(out, ins, lowered->positions.data[i]);
+    }
+
+    if (ok) out->register_count = register_count;
+    free(r.leader);
+    return ok;
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+static bool lower(Lowered *self, uint8_t op, uint32_t a, uint32_t b, uint32_t c)
+{
+    return Vec_Lowered_Ins_Push(&self->code, (Lowered_Ins) {.op = op, .a = a, .b = b, .c = c})
+        && Vec_Code_Pos_Push(&self->positions, (uint32_t)self->code.count);
+}
+
+void Test_Register_Allocator(Test_Info *info)
+{
+    /* a running sum over 1000 short-lived temporaries fits in two registers */
+    Lowered low = {0};
+    bool ok = lower(&low, BC_LOADI, 0, 0, 0);
+    uint32_t vreg = 1;
+    for (uint32_t i = 0; ok && i < 1000; i++, vreg++)
+        ok = lower(&low, BC_LOADI, vreg, i, 0) && lower(&low, BC_ADD_I64, 0, 0, vreg);
+
+    /* a call's arguments end up side by side, whatever they were computed from */
+    uint32_t window = vreg;
+    ok = ok && Vec_Reg_Window_Push(&low.windows, (Reg_Window) {.base = window, .count = 2})
+            && lower(&low, BC_MOVE, window, 0, 0)
+            && lower(&low, BC_LOADI, window + 1, 7, 0)
+            && lower(&low, BC_CALLB, window, NATIVE_PRINT_I64, 2)
+            && lower(&low, BC_HALT, 0, 0, 0);
+    low.vreg_count = window + 2;
+
+    Function fn = Function_New(NULL, 0, 0);
+    uint32_t overflow_at = 0;
+    ok = ok && Allocate_Registers(&low, &fn, &overflow_at) && fn.register_count == 2;
+
+    Instruction call = fn.code.data[fn.code.count - 2];
+    Instruction arg = fn.code.data[fn.code.count - 3];
+    ok = ok && INS_OP(call) == BC_CALLB && INS_OP(arg) == BC_LOADI
+            && INS_A(arg) == INS_A(call) + 1;
+
+    /* 300 values live at once do not fit */
+    Lowered wide = {0};
+    for (uint32_t i = 0; ok && i < 300; i++)
+        ok = lower(&wide, BC_LOADI, i, i, 0);
+    for (uint32_t i = 0; ok && i < 300; i++)
+        ok = lower(&wide, BC_ADD_I64, 0, 0, i);
+    wide.vreg_count = 300;
+
+    Function overflow = Function_New(NULL, 0, 0);
+    ok = ok && !Allocate_Registers(&wide, &overflow, &overflow_at) && overflow_at == 256;
+
+    Vec_Lowered_Ins_Free(&low.code);
+    Vec_Code_Pos_Free(&low.positions);
+    Vec_Reg_Window_Free(&low.windows);
+    Vec_Lowered_Ins_Free(&wide.code);
+    Vec_Code_Pos_Free(&wide.positions);
+    Function_Free(&fn);
+    Function_Free(&overflow);
+    if (!Assert(ok, info, "registers were not allocated as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
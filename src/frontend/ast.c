@@ -1,297 +1,622 @@
 #include "frontend/ast.h"
 #include "util/common.h"
+#include "util/intern.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
 
 //===============================================================================//
 // NODE FUNCTIONS
 //===============================================================================//
 
-Node_Idx Node_Insert(List *map, Node node)
+Node_Idx Node_Insert(AST *self, Node_Kind kind, Span const span, Node_Data data)
 {
-    if (!map || !CHECK_LIST_COMPATIBILITY(map, Node))
-        return 0;
-    Node_Idx id = map->count;
-    List_Add(map, &node);
+    if (!self || self->kinds.count >= UINT32_MAX) return NODE_NONE;
+
+    /* reserve all three first so a failure leaves the arrays in step */
+    if (!Vec_Node_Kind_Reserve(&self->kinds, 1)
+        || !Vec_Node_Data_Reserve(&self->data, 1)
+        || !Vec_Node_Span_Reserve(&self->spans, 1))
+        return NODE_NONE;
+
+    Node_Idx id = (Node_Idx)self->kinds.count;
+    Vec_Node_Kind_Push(&self->kinds, (uint8_t)kind);
+    Vec_Node_Data_Push(&self->data, data);
+    Vec_Node_Span_Push(&self->spans, (Node_Span) {
+        .pos = (uint32_t)span.pos,
+        .len = (uint32_t)span.len,
+    });
     return id;
 }
 
 #define INDENT(i) for (int j = 0; j < (i); j++) putchar(' ')
-void Node_Print(List *map, Node_Idx id, int i)
+static Walk_Action print_node(AST *self, Node_Idx id, uint32_t depth, void *ctx)
 {
-    if (!map || id == 0 || !CHECK_LIST_COMPATIBILITY(map, Node))
-        return;
-    
-    INDENT(i);
-    Node *self = List_Get(map, id);
-    if (!self)
+    INDENT(*(int *)ctx + (int)depth * 2);
+    if (id >= AST_Count(self))
     {
         printf("<NULL>\n");
-        return;
+        return WALK_SKIP;
     }
 
-    printf("[%zu] : ", id);
-    switch (self->type)
+    printf("[%" PRIu32 "] : ", id);
+    switch (AST_Get_Kind(self, id))
     {
+        case NODE_ROOT:
+        {
+            printf("ROOT:%s\n", (self->items.count == 0) ? " <Empty>" : "");
+            break;
+        }
         case NODE_VARIABLE:
         {
-            printf("VARIABLE DECL (MUT = %i):\n", self->data.variable.mutability);
-            Node_Print(map, self->data.variable.symbol, i + 2);
-            if (self->data.variable.initializer != 0)
-                Node_Print(map, self->data.variable.initializer, i + 2);
+            printf("VARIABLE DECL (MUT = %i):\n", AST_Get_Variable(self, id).mutability);
             break;
         }
         case NODE_BINARY:
         {
-            printf("BINARY EXPR of %s:\n", OPERATOR_NAMES[self->data.binary.op]);
-            Node_Print(map, self->data.binary.lhs, i + 2);
-            Node_Print(map, self->data.binary.rhs, i + 2);
+            printf("BINARY EXPR of %s:\n", OPERATOR_NAMES[AST_Get_Binary(self, id).op]);
+            break;
+        }
+        case NODE_UNARY:
+        {
+            printf("UNARY EXPR of %s:\n", OPERATOR_NAMES[AST_Get_Unary(self, id).op]);
             break;
         }
         case NODE_ASSIGNMENT:
         {
-            printf("ASSIGNMENT EXPR of %s:\n", OPERATOR_NAMES[self->data.assignment.op]);
-            Node_Print(map, self->data.assignment.sym, i + 2);
-            Node_Print(map, self->data.assignment.val, i + 2);
+            printf("ASSIGNMENT EXPR of %s:\n", OPERATOR_NAMES[AST_Get_Assignment(self, id).op]);
             break;
         }
         case NODE_CALL:
         {
             printf("CALL EXPR:\n");
-            Node_Print(map, self->data.call.sym, i + 2);
-            Node_Print(map, self->data.call.args, i + 2);
             break;
         }
         case NODE_LIST:
         {
-            printf("LIST:");
-            if (self->data.list.count == 0)
-            {
-                printf(" <Empty>\n");
-                break;
-            }
-            else
-            {
-                putchar('\n');
-            }
-            for (size_t j = 0; j < self->data.list.count; j++)
-            {
-                Node_Idx id = self->data.list.nodes[j];
-                Node_Print(map, id, i + 2);
-            }
+            printf("LIST:%s\n", (AST_Get_List(self, id).count == 0) ? " <Empty>" : "");
             break;
         }
         case NODE_FLOAT:
         {
-            printf("FLOAT: %f\n", self->data.float_value);
+            printf("FLOAT: %f\n", AST_Get_Float(self, id));
             break;
         }
         case NODE_INTEGER:
         {
-            printf("INTEGER: %d\n", self->data.int_value);
+            printf("INTEGER: %" PRId64 "\n", AST_Get_Integer(self, id));
             break;
         }
         case NODE_GROUPING:
         {
             printf("GROUPING:\n");
-            Node_Print(map, self->data.inner_node, i + 2);
             break;
         }
         case NODE_SYMBOL:
         {
-            printf("SYMBOL: %s\n", self->data.symbol_name);
+            printf("SYMBOL: %s\n", Intern_Lookup(AST_Get_Symbol(self, id), NULL));
             break;
         }
         default:
         {
             printf("<Unknown Type>\n");
-            break;
+            return WALK_SKIP;
         }
     }
+    return WALK_CONTINUE;
 }
 
-void Node_Free(Node *self)
+void Node_Print(AST *self, Node_Idx id, int i)
 {
     if (!self) return;
-    switch (self->type)
+
+    AST_Visitor printer = (AST_Visitor) {.pre = print_node, .ctx = &i};
+    AST_Walk(self, id, &printer);
+}
+
+//===============================================================================//
+// NODE ACCESSORS
+//===============================================================================//
+
+/* 64-bit values are split across two words of the payload */
+
+static Node_Data pack_bits(uint64_t bits)
+{
+    return (Node_Data) {.a = (uint32_t)bits, .b = (uint32_t)(bits >> 32)};
+}
+
+static uint64_t unpack_bits(Node_Data data)
+{
+    return (uint64_t)data.a | ((uint64_t)data.b << 32);
+}
+
+Node_Kind AST_Get_Kind(const AST *self, Node_Idx id)
+{
+    return (Node_Kind)self->kinds.data[id];
+}
+
+Span AST_Get_Span(const AST *self, Node_Idx id)
+{
+    Node_Span span = self->spans.data[id];
+    return (Span) {.pos = span.pos, .len = span.len, .file = self->file};
+}
+
+int64_t AST_Get_Integer(const AST *self, Node_Idx id)
+{
+    return (int64_t)unpack_bits(self->data.data[id]);
+}
+
+double AST_Get_Float(const AST *self, Node_Idx id)
+{
+    uint64_t bits = unpack_bits(self->data.data[id]);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+Intern_Id AST_Get_Symbol(const AST *self, Node_Idx id)
+{
+    return (Intern_Id)self->data.data[id].a;
+}
+
+Node_Idx AST_Get_Inner(const AST *self, Node_Idx id)
+{
+    return self->data.data[id].a;
+}
+
+Node_List AST_Get_List(const AST *self, Node_Idx id)
+{
+    Node_Data data = self->data.data[id];
+    return (Node_List) {
+        .nodes = (data.b != 0) ? self->extra.data + data.a : NULL,
+        .count = data.b,
+    };
+}
+
+Node_Call AST_Get_Call(const AST *self, Node_Idx id)
+{
+    Node_Data data = self->data.data[id];
+    return (Node_Call) {.sym = data.a, .args = data.b};
+}
+
+Node_Binary AST_Get_Binary(const AST *self, Node_Idx id)
+{
+    Node_Data data = self->data.data[id];
+    return (Node_Binary) {.op = (Operator)data.a, .lhs = data.b, .rhs = data.c};
+}
+
+Node_Unary AST_Get_Unary(const AST *self, Node_Idx id)
+{
+    Node_Data data = self->data.data[id];
+    return (Node_Unary) {.op = (Operator)data.a, .operand = data.b};
+}
+
+Node_Assignment AST_Get_Assignment(const AST *self, Node_Idx id)
+{
+    Node_Data data = self->data.data[id];
+    return (Node_Assignment) {.op = (Operator)data.a, .sym = data.b, .val = data.c};
+}
+
+Node_Variable AST_Get_Variable(const AST *self, Node_Idx id)
+{
+    Node_Data data = self->data.data[id];
+    return (Node_Variable) {.symbol = data.a, .initializer = data.b, .mutability = data.c != 0};
+}
+
+//===============================================================================//
+// NODE REWRITING
+//===============================================================================//
+
+void AST_Set_Integer(AST *self, Node_Idx id, int64_t value)
+{
+    self->kinds.data[id] = NODE_INTEGER;
+    self->data.data[id] = pack_bits((uint64_t)value);
+}
+
+void AST_Set_Float(AST *self, Node_Idx id, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    self->kinds.data[id] = NODE_FLOAT;
+    self->data.data[id] = pack_bits(bits);
+}
+
+void AST_Set_Grouping(AST *self, Node_Idx id, Node_Idx inner)
+{
+    self->kinds.data[id] = NODE_GROUPING;
+    self->data.data[id] = (Node_Data) {.a = inner};
+}
+
+//===============================================================================//
+// TRAVERSAL
+//===============================================================================//
+
+/// @brief An entry of the walk's work stack, every node is pushed once to be
+/// entered and, if there is a post-order visitor, once more to be left.
+typedef struct _walk_frame
+{
+    Node_Idx id;
+    uint32_t depth;
+    bool leave;
+} walk_frame;
+
+VEC_DEFINE(Vec_Walk_Frame, walk_frame)
+
+#define INIT_WALK_STACK_CAPACITY 64
+
+const Node_Idx *AST_Children(const AST *self, Node_Idx id, Node_Idx fixed[3], uint32_t *count)
+{
+    *count = 0;
+    switch (AST_Get_Kind(self, id))
     {
-        case NODE_SYMBOL:
+        case NODE_ROOT:
         {
-            free(self->data.symbol_name);
-            break;
+            *count = (uint32_t)self->items.count;
+            return self->items.data;
         }
         case NODE_LIST:
         {
-            free(self->data.list.nodes);
+            Node_List list = AST_Get_List(self, id);
+            *count = list.count;
+            return list.nodes;
+        }
+        case NODE_GROUPING:
+        {
+            fixed[(*count)++] = AST_Get_Inner(self, id);
+            break;
+        }
+        case NODE_CALL:
+        {
+            Node_Call call = AST_Get_Call(self, id);
+            fixed[(*count)++] = call.sym;
+            fixed[(*count)++] = call.args;
+            break;
+        }
+        case NODE_BINARY:
+        {
+            Node_Binary binary = AST_Get_Binary(self, id);
+            fixed[(*count)++] = binary.lhs;
+            fixed[(*count)++] = binary.rhs;
+            break;
+        }
+        case NODE_UNARY:
+        {
+            fixed[(*count)++] = AST_Get_Unary(self, id).operand;
+            break;
+        }
+        case NODE_ASSIGNMENT:
+        {
+            Node_Assignment assignment = AST_Get_Assignment(self, id);
+            fixed[(*count)++] = assignment.sym;
+            fixed[(*count)++] = assignment.val;
+            break;
+        }
+        case NODE_VARIABLE:
+        {
+            Node_Variable variable = AST_Get_Variable(self, id);
+            fixed[(*count)++] = variable.symbol;
+            fixed[(*count)++] = variable.initializer;
             break;
         }
         default: break;
     }
-}
 
-//===============================================================================//
-// SUBTYPE FUNCTIONS
-//===============================================================================//
+    /* optional children that are not there */
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < *count; i++)
+        if (fixed[i] != NODE_NONE) fixed[kept++] = fixed[i];
+    *count = kept;
+    return fixed;
+}
 
-void Node_List_Add(Node_List *self, Node_Idx node)
+bool AST_Walk(AST *self, Node_Idx start, AST_Visitor const *visitor)
 {
-    if (!self) return;
-    if (self->count >= self->capacity)
+    if (!self || !visitor || start >= AST_Count(self)) return false;
+
+    Vec_Walk_Frame stack = Vec_Walk_Frame_New(INIT_WALK_STACK_CAPACITY);
+    bool ok = Vec_Walk_Frame_Push(&stack, (walk_frame) {.id = start});
+
+    walk_frame frame;
+    while (ok && Vec_Walk_Frame_Pop(&stack, &frame))
     {
-        /*(FIX) grow by 50% not 100%*/
-        size_t new_capacity = (self->capacity != 0)
-                            ? (self->capacity * 2)
-                            : 4;
-        void *new_nodes = realloc(self->nodes, new_capacity * sizeof(Node_Idx));
-        if (!new_nodes) return;
-
-        self->nodes = new_nodes;
-        self->capacity = new_capacity;
+        if (frame.leave)
+        {
+            if (visitor->post(self, frame.id, frame.depth, visitor->ctx) == WALK_STOP)
+                ok = false;
+            continue;
+        }
+
+        Walk_Action action = (visitor->pre)
+                           ? visitor->pre(self, frame.id, frame.depth, visitor->ctx)
+                           : WALK_CONTINUE;
+        if (action == WALK_STOP) { ok = false; break; }
+        if (action == WALK_SKIP) continue;
+
+        if (visitor->post)
+        {
+            frame.leave = true;
+            ok = Vec_Walk_Frame_Push(&stack, frame);
+        }
+
+        /* pushed in reverse so they come off the stack in source order */
+        Node_Idx fixed[3];
+        uint32_t count;
+        const Node_Idx *children = AST_Children(self, frame.id, fixed, &count);
+        ok = ok && Vec_Walk_Frame_Reserve(&stack, count);
+        for (uint32_t i = count; ok && i > 0; i--)
+        {
+            Vec_Walk_Frame_Push(&stack, (walk_frame) {
+                .id = children[i - 1],
+                .depth = frame.depth + 1,
+            });
+        }
     }
-    self->nodes[self->count] = node;
-    self->count++;
+
+    Vec_Walk_Frame_Free(&stack);
+    return ok;
 }
 
 //===============================================================================//
 // NODE BUILDER FUNCTIONS
 //===============================================================================//
 
-Node_Idx Make_Node_Integer(List *map, Span const span, int32_t value)
+Node_Idx Make_Node_Integer(AST *ast, Span const span, int64_t value)
 {
-    return Node_Insert(map, (Node) {
-        .type = NODE_INTEGER,
-        .span = span,
-        .data.int_value = value,
-    });
+    return Node_Insert(ast, NODE_INTEGER, span, pack_bits((uint64_t)value));
 }
 
-Node_Idx Make_Node_Float(List *map, Span const span, float value)
+Node_Idx Make_Node_Float(AST *ast, Span const span, double value)
 {
-    return Node_Insert(map, (Node) {
-        .type = NODE_FLOAT,
-        .span = span,
-        .data.float_value = value,
-    });
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return Node_Insert(ast, NODE_FLOAT, span, pack_bits(bits));
 }
 
-Node_Idx Make_Node_Grouping(List *map, Span const span, Node_Idx inner)
+Node_Idx Make_Node_Grouping(AST *ast, Span const span, Node_Idx inner)
 {
-    return Node_Insert(map, (Node) {
-        .type = NODE_GROUPING,
-        .span = span,
-        .data.inner_node = inner,
-    });
+    return Node_Insert(ast, NODE_GROUPING, span, (Node_Data) {.a = inner});
 }
 
-Node_Idx Make_Node_Symbol(List *map, Span const span, const char *src)
+Node_Idx Make_Node_Symbol(AST *ast, Span const span, Intern_Id name)
 {
-    char *lexeme = Get_Lexeme(src, span.pos, span.len);
-    return Node_Insert(map, (Node) {
-        .type = NODE_SYMBOL,
-        .span = span,
-        .data.symbol_name = lexeme,
-    });
+    return Node_Insert(ast, NODE_SYMBOL, span, (Node_Data) {.a = name});
 }
 
-Node_Idx Make_Node_Binary(List *map, Span const span, Node_Idx lhs, Node_Idx rhs, Operator op)
+Node_Idx Make_Node_Binary(AST *ast, Span const span, Node_Idx lhs, Node_Idx rhs, Operator op)
 {
-    return Node_Insert(map, (Node) {
-        .type = NODE_BINARY,
-        .span = span,
-        .data.binary = (Node_Binary) {
-            .lhs = lhs,
-            .rhs = rhs,
-            .op = op,
-        },
+    return Node_Insert(ast, NODE_BINARY, span, (Node_Data) {
+        .a = (uint32_t)op,
+        .b = lhs,
+        .c = rhs,
     });
 }
 
-Node_Idx Make_Node_Assignment(List *map, Span const span, Node_Idx sym, Node_Idx val, Operator op)
+Node_Idx Make_Node_Unary(AST *ast, Span const span, Node_Idx operand, Operator op)
 {
-        return Node_Insert(map, (Node) {
-        .type = NODE_ASSIGNMENT,
-        .span = span,
-        .data.assignment = (Node_Assignment) {
-            .sym = sym,
-            .val = val,
-            .op = op,
-        },
+    return Node_Insert(ast, NODE_UNARY, span, (Node_Data) {
+        .a = (uint32_t)op,
+        .b = operand,
     });
 }
 
-Node_Idx Make_Node_Variable(List *map, Span const span, Node_Idx sym, Node_Idx initializer, bool mut)
+Node_Idx Make_Node_Assignment(AST *ast, Span const span, Node_Idx sym, Node_Idx val, Operator op)
 {
-    return Node_Insert(map, (Node) {
-        .type = NODE_VARIABLE,
-        .span = span,
-        .data.variable = (Node_Variable) {
-            .symbol = sym,
-            .initializer = initializer,
-            .mutability = mut,
-        },
+    return Node_Insert(ast, NODE_ASSIGNMENT, span, (Node_Data) {
+        .a = (uint32_t)op,
+        .b = sym,
+        .c = val,
     });
 }
 
-Node_Idx Make_Node_Call(List *map, Span const span, Node_Idx sym, Node_Idx args)
+Node_Idx Make_Node_Variable(AST *ast, Span const span, Node_Idx sym, Node_Idx initializer, bool mut)
 {
-    return Node_Insert(map, (Node) {
-        .type = NODE_CALL,
-        .span = span,
-        .data.call = (Node_Call) {
-            .sym = sym,
-            .args = args,
-        },
+    return Node_Insert(ast, NODE_VARIABLE, span, (Node_Data) {
+        .a = sym,
+        .b = initializer,
+        .c = mut,
     });
 }
 
-Node_Idx Make_Node_List(List *map, Span const start_span, size_t capacity)
+Node_Idx Make_Node_Call(AST *ast, Span const span, Node_Idx sym, Node_Idx args)
 {
-    Node_List self = {0};
-    List basic_list = List_New(sizeof(Node_Idx), capacity);
-    
-    self.nodes = basic_list.data;
-    self.capacity = capacity;
-    return Node_Insert(map, (Node) {
-        .type = NODE_LIST,
-        .span = start_span,
-        .data.list = self,
+    return Node_Insert(ast, NODE_CALL, span, (Node_Data) {
+        .a = sym,
+        .b = args,
     });
 }
 
+Node_Idx Make_Node_List(AST *ast, Span const span, const Node_Idx *nodes, uint32_t count)
+{
+    if (!ast || ast->extra.count > UINT32_MAX - count) return NODE_NONE;
+
+    uint32_t start = (uint32_t)ast->extra.count;
+    if (!Vec_Node_Idx_Extend(&ast->extra, nodes, count))
+        return NODE_NONE;
+
+    Node_Idx id = Node_Insert(ast, NODE_LIST, span, (Node_Data) {.a = start, .b = count});
+    if (id == NODE_NONE)
+        Vec_Node_Idx_Truncate(&ast->extra, start);
+    return id;
+}
+
 //===============================================================================//
 // ABSTRACT SYNTAX TREE
 //===============================================================================//
 
-Node_Idx make_node_root(List *map, size_t capacity)
-{
-    Node_List self = {0};
-    List basic_list = List_New(sizeof(Node_Idx), capacity);
-    
-    self.nodes = basic_list.data;
-    self.capacity = capacity;
-    return Node_Insert(map, (Node) {
-        .type = NODE_ROOT,
-        .span = (Span) {0},
-        .data.root = self,
-    });
+AST AST_Init(File_Id file)
+{
+    return AST_Init_In(NULL, file);
 }
 
-AST AST_Init()
+AST AST_Init_In(Arena *arena, File_Id file)
 {
-    List node_map = List_New(sizeof(Node), INIT_NODE_MAP_CAPACITY);
-    
-    Node_Idx root_idx = make_node_root(&node_map, INIT_ROOT_NODE_CAPACITY);
-    Node *root_node = List_Get(&node_map, root_idx);
-
-    return (AST) {
-        .node_map = node_map,
-        .root_node = root_node,
+    AST self = (AST) {
+        .kinds = Vec_Node_Kind_New_In(arena, INIT_NODE_MAP_CAPACITY),
+        .data = Vec_Node_Data_New_In(arena, INIT_NODE_MAP_CAPACITY),
+        .spans = Vec_Node_Span_New_In(arena, INIT_NODE_MAP_CAPACITY),
+        .extra = Vec_Node_Idx_New_In(arena, INIT_NODE_EXTRA_CAPACITY),
+        .items = Vec_Node_Idx_New_In(arena, INIT_ROOT_NODE_CAPACITY),
+        .file = file,
+        .arena = arena,
     };
+
+    /* the root takes index 0, which is what makes 0 mean "no node" */
+    Node_Insert(&self, NODE_ROOT, (Span) {0}, (Node_Data) {0});
+    return self;
+}
+
+bool AST_Insert(AST *self, Node_Idx node_idx)
+{
+    return Vec_Node_Idx_Push(&self->items, node_idx);
+}
+
+size_t AST_Count(const AST *self)
+{
+    return self->kinds.count;
 }
 
-void AST_Insert(AST *self, Node_Idx node_idx)
+void AST_Free(AST *self)
 {
-    Node_List_Add(&self->root_node->data.root, node_idx);
-}
\ No newline at end of file
+    if (!self) return;
+
+    /* an arena tree owns nothing, Vec_*_Free leaves arena storage alone */
+    Vec_Node_Kind_Free(&self->kinds);
+    Vec_Node_Data_Free(&self->data);
+    Vec_Node_Span_Free(&self->spans);
+    Vec_Node_Idx_Free(&self->extra);
+    Vec_Node_Idx_Free(&self->items);
+    *self = (AST) {0};
+}
+
+//===============================================================================//
+// TESTS
+//===============================================================================//
+
+void Test_AST(Test_Info *info)
+{
+    Arena arena = Arena_New(0);
+    AST ast = AST_Init_In(&arena, 3);
+
+    /* print(x * 2.5, -9000000000) */
+    Node_Idx x = Make_Node_Symbol(&ast, (Span) {.pos = 6, .len = 1}, Intern("x", 1));
+    Node_Idx f = Make_Node_Float(&ast, (Span) {.pos = 10, .len = 3}, 2.5);
+    Node_Idx mul = Make_Node_Binary(&ast, (Span) {.pos = 6, .len = 7}, x, f, OP_MUL);
+    Node_Idx big = Make_Node_Integer(&ast, (Span) {.pos = 15, .len = 11}, -9000000000);
+    Node_Idx args = Make_Node_List(&ast, (Span) {.pos = 5, .len = 22}, (Node_Idx[]) {mul, big}, 2);
+    Node_Idx callee = Make_Node_Symbol(&ast, (Span) {.pos = 0, .len = 5}, Intern("print", 5));
+    Node_Idx call = Make_Node_Call(&ast, (Span) {.pos = 0, .len = 27}, callee, args);
+    Node_Idx empty = Make_Node_List(&ast, (Span) {0}, NULL, 0);
+    AST_Insert(&ast, call);
+
+    Node_Binary binary = AST_Get_Binary(&ast, mul);
+    Node_List list = AST_Get_List(&ast, args);
+    Span span = AST_Get_Span(&ast, call);
+    bool ok = call != NODE_NONE && AST_Count(&ast) == 9
+           && AST_Get_Kind(&ast, NODE_NONE) == NODE_ROOT
+           && binary.op == OP_MUL && binary.lhs == x && binary.rhs == f
+           && AST_Get_Float(&ast, f) == 2.5
+           && AST_Get_Integer(&ast, big) == -9000000000
+           && list.count == 2 && list.nodes[0] == mul && list.nodes[1] == big
+           && AST_Get_List(&ast, empty).count == 0
+           && AST_Get_Call(&ast, call).args == args
+           && span.pos == 0 && span.len == 27 && span.file == 3
+           && ast.items.count == 1 && ast.items.data[0] == call;
+
+    printf("> %zu nodes, %zu bytes per node\n", AST_Count(&ast),
+        sizeof(uint8_t) + sizeof(Node_Data) + sizeof(Node_Span));
+    Node_Print(&ast, call, 0);
+
+    AST_Free(&ast);
+    Arena_Free(&arena);
+
+    if (!Assert(ok, info, "compact AST did not round trip its nodes"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
+
+#define WALK_LOG_NONE UINT32_MAX
+
+/// @brief Records the order nodes are entered and left in, stopping at `stop_at`.
+typedef struct _walk_log
+{
+    Node_Idx entered[16];
+    Node_Idx left[16];
+    size_t entered_count;
+    size_t left_count;
+    Node_Idx skip;
+    Node_Idx stop_at;
+    uint32_t max_depth;
+} walk_log;
+
+static Walk_Action log_enter(AST *ast, Node_Idx id, uint32_t depth, void *ctx)
+{
+    (void)ast;
+    walk_log *log = ctx;
+    if (depth > log->max_depth) log->max_depth = depth;
+    if (log->entered_count < 16) log->entered[log->entered_count] = id;
+    log->entered_count++;
+    if (id == log->stop_at) return WALK_STOP;
+    return (id == log->skip) ? WALK_SKIP : WALK_CONTINUE;
+}
+
+static Walk_Action log_leave(AST *ast, Node_Idx id, uint32_t depth, void *ctx)
+{
+    (void)ast; (void)depth;
+    walk_log *log = ctx;
+    if (log->left_count < 16) log->left[log->left_count] = id;
+    log->left_count++;
+    return WALK_CONTINUE;
+}
+
+void Test_AST_Walk(Test_Info *info)
+{
+    AST ast = AST_Init(0);
+
+    /* let x = (1 + 2) */
+    Node_Idx x = Make_Node_Symbol(&ast, (Span) {0}, Intern("x", 1));
+    Node_Idx one = Make_Node_Integer(&ast, (Span) {0}, 1);
+    Node_Idx two = Make_Node_Integer(&ast, (Span) {0}, 2);
+    Node_Idx add = Make_Node_Binary(&ast, (Span) {0}, one, two, OP_ADD);
+    Node_Idx group = Make_Node_Grouping(&ast, (Span) {0}, add);
+    Node_Idx let = Make_Node_Variable(&ast, (Span) {0}, x, group, false);
+    AST_Insert(&ast, let);
+
+    walk_log log = {.skip = WALK_LOG_NONE, .stop_at = WALK_LOG_NONE};
+    AST_Visitor visitor = (AST_Visitor) {.pre = log_enter, .post = log_leave, .ctx = &log};
+    bool ok = AST_Walk(&ast, NODE_NONE, &visitor);
+
+    Node_Idx pre[] = {NODE_NONE, let, x, group, add, one, two};
+    Node_Idx post[] = {x, one, two, add, group, let, NODE_NONE};
+    ok = ok && log.entered_count == 7 && log.left_count == 7
+            && memcmp(log.entered, pre, sizeof(pre)) == 0
+            && memcmp(log.left, post, sizeof(post)) == 0
+            && log.max_depth == 4;
+
+    /* skipping a node skips everything under it, stopping ends the walk */
+    log = (walk_log) {.skip = group, .stop_at = WALK_LOG_NONE};
+    ok = ok && AST_Walk(&ast, let, &visitor) && log.entered_count == 3 && log.left_count == 2;
+    log = (walk_log) {.skip = WALK_LOG_NONE, .stop_at = add};
+    ok = ok && !AST_Walk(&ast, NODE_NONE, &visitor) && log.entered_count == 5;
+
+    /* a chain far deeper than the C stack would take recursively */
+    const uint32_t depth = 1000000;
+    Node_Idx chain = Make_Node_Integer(&ast, (Span) {0}, 0);
+    for (uint32_t i = 0; ok && i < depth; i++)
+        chain = Make_Node_Grouping(&ast, (Span) {0}, chain);
+    log = (walk_log) {.skip = WALK_LOG_NONE, .stop_at = WALK_LOG_NONE};
+    ok = ok && chain != NODE_NONE && AST_Walk(&ast, chain, &visitor)
+            && log.entered_count == depth + 1 && log.max_depth == depth;
+
+    AST_Free(&ast);
+
+    if (!Assert(ok, info, "AST walk visited the wrong nodes or order"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
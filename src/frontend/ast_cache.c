@@ -0,0 +1,442 @@
+#include "frontend/ast_cache.h"
+#include "frontend/ast.h"
+#include "frontend/parser.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/intern.h"
+#include "util/sections.h"
+#include "util/source.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//===============================================================================//
+// FILE LAYOUT
+//===============================================================================//
+
+/* a cache file is the header followed by these sections, each starting on an
+   8-byte boundary so the mapped arrays can be read in place:
+
+     kinds    node_count bytes
+     data     node_count Node_Data
+     spans    node_count Node_Span
+     extra    extra_count Node_Idx
+     items    item_count Node_Idx
+     lengths  string_count uint32_t
+     strings  string_bytes bytes, not nul-terminated
+
+   symbol nodes hold an index into the strings rather than an `Intern_Id`, since
+   ids are only meaningful to the process that handed them out. Everything is in
+   the host's byte order, a cache from a machine that differs fails the magic.
+   The header also records how many node kinds and operators there are and how
+   big a node is, so a tree from a build that numbers them differently is a miss
+   even if nobody remembered to bump the version. */
+
+#define AST_CACHE_MAGIC 0x54534155u /* "UAST" */
+
+enum
+{
+    #define X(name, token, str, flag, power, assoc) + 1
+    OPERATOR_COUNT = 0 OPERATOR_LIST,
+    #undef X
+};
+
+typedef struct _cache_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t node_count;
+    uint32_t extra_count;
+    uint32_t item_count;
+    uint32_t string_count;
+    uint32_t string_bytes;
+    uint16_t node_kinds;
+    uint16_t operators;
+    uint32_t node_size;
+    uint32_t span_size;
+} cache_header;
+
+static const cache_header CACHE_SHAPE = {
+    .node_kinds = NODE_KIND_COUNT,
+    .operators = OPERATOR_COUNT,
+    .node_size = sizeof(Node_Data),
+    .span_size = sizeof(Node_Span),
+};
+
+static bool same_shape(const cache_header *h)
+{
+    return h->node_kinds == CACHE_SHAPE.node_kinds && h->operators == CACHE_SHAPE.operators
+        && h->node_size == CACHE_SHAPE.node_size && h->span_size == CACHE_SHAPE.span_size;
+}
+
+typedef enum _cache_section
+{
+    SECTION_KINDS,
+    SECTION_DATA,
+    SECTION_SPANS,
+    SECTION_EXTRA,
+    SECTION_ITEMS,
+    SECTION_LENGTHS,
+    SECTION_STRINGS,
+    SECTION_COUNT,
+} cache_section;
+
+/// @brief Works out where each section starts.
+/// @return the size of the whole file.
+static size_t layout(const cache_header *h, size_t offsets[SECTION_COUNT])
+{
+    size_t sizes[SECTION_COUNT] = {
+        [SECTION_KINDS] = h->node_count,
+        [SECTION_DATA] = (size_t)h->node_count * sizeof(Node_Data),
+        [SECTION_SPANS] = (size_t)h->node_count * sizeof(Node_Span),
+        [SECTION_EXTRA] = (size_t)h->extra_count * sizeof(Node_Idx),
+        [SECTION_ITEMS] = (size_t)h->item_count * sizeof(Node_Idx),
+        [SECTION_LENGTHS] = (size_t)h->string_count * sizeof(uint32_t),
+        [SECTION_STRINGS] = h->string_bytes,
+    };
+
+    return Layout_Sections(sizeof(cache_header), sizes, SECTION_COUNT, offsets);
+}
+
+//===============================================================================//
+// HASHING AND PATHS
+//===============================================================================//
+
+uint64_t Hash_Source(const char *src, size_t len)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)src[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+const char *AST_Cache_Path(Arena *arena, const char *path)
+{
+    size_t len = strlen(path);
+    size_t ext = strlen(AST_CACHE_EXTENSION);
+    char *out = Arena_Alloc(arena, len + ext + 1);
+    if (!out) return NULL;
+
+    memcpy(out, path, len);
+    memcpy(out + len, AST_CACHE_EXTENSION, ext + 1);
+    return out;
+}
+
+//===============================================================================//
+// WRITING
+//===============================================================================//
+
+bool AST_Cache_Write(const AST *ast, const char *path, uint64_t hash)
+{
+    size_t count = AST_Count(ast);
+    cache_header h = (cache_header) {
+        .magic = AST_CACHE_MAGIC,
+        .version = AST_CACHE_VERSION,
+        .source_hash = hash,
+        .node_count = (uint32_t)count,
+        .extra_count = (uint32_t)ast->extra.count,
+        .item_count = (uint32_t)ast->items.count,
+        .node_kinds = CACHE_SHAPE.node_kinds,
+        .operators = CACHE_SHAPE.operators,
+        .node_size = CACHE_SHAPE.node_size,
+        .span_size = CACHE_SHAPE.span_size,
+    };
+
+    /* give every name the tree uses a local index, in order of first use */
+    size_t ids = Intern_Count() + 1;
+    uint32_t *local = calloc(ids, sizeof(uint32_t));
+    Node_Data *data = malloc(count * sizeof(Node_Data));
+    Intern_Id *names = malloc(count * sizeof(Intern_Id));
+    bool ok = local && data && names;
+
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        data[i] = ast->data.data[i];
+        if (ast->kinds.data[i] != NODE_SYMBOL) continue;
+
+        Intern_Id id = data[i].a;
+        if (id >= ids) { ok = false; break; }
+        if (local[id] == 0)
+        {
+            size_t len;
+            Intern_Lookup(id, &len);
+            names[h.string_count] = id;
+            local[id] = ++h.string_count;
+            h.string_bytes += (uint32_t)len;
+        }
+        data[i].a = local[id] - 1;
+    }
+
+    uint32_t *lengths = ok ? malloc((h.string_count + 1) * sizeof(uint32_t)) : NULL;
+    char *strings = ok ? malloc(h.string_bytes + 1) : NULL;
+    ok = ok && lengths && strings;
+
+    size_t at = 0;
+    for (uint32_t i = 0; ok && i < h.string_count; i++)
+    {
+        size_t len;
+        const char *str = Intern_Lookup(names[i], &len);
+        memcpy(strings + at, str, len);
+        lengths[i] = (uint32_t)len;
+        at += len;
+    }
+
+    size_t offsets[SECTION_COUNT];
+    size_t size = layout(&h, offsets);
+
+    /* written beside the old file and renamed over it, another job may be
+       reading the old one */
+    File_Replacement file = {0};
+    ok = ok && Replacement_Open(path, &file);
+    ok = ok
+      && Replacement_Write(&file, 0, &h, sizeof(h))
+      && Replacement_Write(&file, offsets[SECTION_KINDS], ast->kinds.data, count)
+      && Replacement_Write(&file, offsets[SECTION_DATA], data, count * sizeof(Node_Data))
+      && Replacement_Write(&file, offsets[SECTION_SPANS], ast->spans.data, count * sizeof(Node_Span))
+      && Replacement_Write(&file, offsets[SECTION_EXTRA], ast->extra.data, h.extra_count * sizeof(Node_Idx))
+      && Replacement_Write(&file, offsets[SECTION_ITEMS], ast->items.data, h.item_count * sizeof(Node_Idx))
+      && Replacement_Write(&file, offsets[SECTION_LENGTHS], lengths, h.string_count * sizeof(uint32_t))
+      && Replacement_Write(&file, offsets[SECTION_STRINGS], strings, h.string_bytes);
+    if (file.file) ok = Replacement_Close(&file, size, ok);
+
+    free(local);
+    free(data);
+    free(names);
+    free(lengths);
+    free(strings);
+    return ok;
+}
+
+//===============================================================================//
+// READING
+//===============================================================================//
+
+/// @brief Returns whether a node can stand where the parser puts an expression.
+static bool is_expression(uint8_t kind)
+{
+    switch ((Node_Kind)kind)
+    {
+    case NODE_INTEGER:
+    case NODE_FLOAT:
+    case NODE_SYMBOL:
+    case NODE_GROUPING:
+    case NODE_CALL:
+    case NODE_BINARY:
+    case NODE_ASSIGNMENT:
+    case NODE_UNARY: return true;
+    default: return false;
+    }
+}
+
+/// @brief Checks the nodes of a loaded tree point where they may and at the kinds
+/// of node the parser would have put there, so a damaged file is a miss rather
+/// than a crash or a bogus error later on. Children always come before their
+/// parent, which rules out cycles too.
+static bool validate(const cache_header *h, const uint8_t *kinds, const Node_Data *data,
+                     const Node_Idx *extra, const Node_Idx *items)
+{
+    uint32_t n = h->node_count;
+    if (n == 0 || kinds[0] != NODE_ROOT) return false;
+
+    for (uint32_t i = 1; i < n; i++)
+    {
+        Node_Data d = data[i];
+        switch ((Node_Kind)kinds[i])
+        {
+        case NODE_INTEGER:
+        case NODE_FLOAT: break;
+        case NODE_SYMBOL: if (d.a >= h->string_count) return false; break;
+        case NODE_GROUPING:
+            if (d.a >= i || !is_expression(kinds[d.a])) return false;
+            break;
+        case NODE_CALL:
+            if (d.a >= i || d.b >= i) return false;
+            if (kinds[d.a] != NODE_SYMBOL || kinds[d.b] != NODE_LIST) return false;
+            break;
+        case NODE_VARIABLE:
+            if (d.a >= i || d.b >= i || d.c > 1) return false;
+            if (kinds[d.a] != NODE_SYMBOL || !is_expression(kinds[d.b])) return false;
+            break;
+        case NODE_UNARY:
+            if (d.a >= OPERATOR_COUNT || d.b >= i || !is_expression(kinds[d.b])) return false;
+            break;
+        case NODE_BINARY:
+        case NODE_ASSIGNMENT:
+            if (d.a >= OPERATOR_COUNT || d.b >= i || d.c >= i) return false;
+            if (!is_expression(kinds[d.b]) || !is_expression(kinds[d.c])) return false;
+            if (kinds[i] == NODE_ASSIGNMENT && kinds[d.b] != NODE_SYMBOL) return false;
+            break;
+        case NODE_LIST:
+            if (d.a > h->extra_count || d.b > h->extra_count - d.a) return false;
+            for (uint32_t k = 0; k < d.b; k++)
+                if (extra[d.a + k] >= i || !is_expression(kinds[extra[d.a + k]])) return false;
+            break;
+        default: return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < h->item_count; i++)
+    {
+        if (items[i] == NODE_NONE || items[i] >= n) return false;
+        if (kinds[items[i]] != NODE_VARIABLE && !is_expression(kinds[items[i]])) return false;
+    }
+    return true;
+}
+
+bool AST_Cache_Read(const char *path, uint64_t hash, Arena *arena, File_Id file, AST *out)
+{
+    Mapped_File mapped;
+    if (!Map_File(path, &mapped)) return false;
+
+    cache_header h;
+    size_t offsets[SECTION_COUNT];
+    bool ok = mapped.len >= sizeof(h);
+    if (ok) memcpy(&h, mapped.data, sizeof(h));
+    ok = ok && h.magic == AST_CACHE_MAGIC && h.version == AST_CACHE_VERSION
+            && same_shape(&h) && h.source_hash == hash && layout(&h, offsets) == mapped.len;
+    if (!ok)
+    {
+        Unmap_File(&mapped);
+        return false;
+    }
+
+    const char *base = mapped.data;
+    const uint8_t *kinds = (const uint8_t *)(base + offsets[SECTION_KINDS]);
+    const Node_Data *data = (const Node_Data *)(base + offsets[SECTION_DATA]);
+    const Node_Span *spans = (const Node_Span *)(base + offsets[SECTION_SPANS]);
+    const Node_Idx *extra = (const Node_Idx *)(base + offsets[SECTION_EXTRA]);
+    const Node_Idx *items = (const Node_Idx *)(base + offsets[SECTION_ITEMS]);
+    const uint32_t *lengths = (const uint32_t *)(base + offsets[SECTION_LENGTHS]);
+    const char *strings = base + offsets[SECTION_STRINGS];
+
+    /* intern the names up front, symbol nodes are patched as they are copied */
+    Intern_Id *names = Arena_Alloc(arena, ((size_t)h.string_count + 1) * sizeof(Intern_Id));
+    ok = names != NULL && validate(&h, kinds, data, extra, items);
+
+    size_t at = 0;
+    for (uint32_t i = 0; ok && i < h.string_count; i++)
+    {
+        ok = lengths[i] <= h.string_bytes - at;
+        names[i] = ok ? Intern(strings + at, lengths[i]) : INTERN_NONE;
+        ok = ok && names[i] != INTERN_NONE;
+        at += lengths[i];
+    }
+
+    AST ast = (AST) {
+        .kinds = Vec_Node_Kind_New_In(arena, h.node_count),
+        .data = Vec_Node_Data_New_In(arena, h.node_count),
+        .spans = Vec_Node_Span_New_In(arena, h.node_count),
+        .extra = Vec_Node_Idx_New_In(arena, h.extra_count),
+        .items = Vec_Node_Idx_New_In(arena, h.item_count),
+        .file = file,
+        .arena = arena,
+    };
+    ok = ok
+      && Vec_Node_Kind_Extend(&ast.kinds, kinds, h.node_count)
+      && Vec_Node_Data_Extend(&ast.data, data, h.node_count)
+      && Vec_Node_Span_Extend(&ast.spans, spans, h.node_count)
+      && Vec_Node_Idx_Extend(&ast.extra, extra, h.extra_count)
+      && Vec_Node_Idx_Extend(&ast.items, items, h.item_count);
+
+    for (uint32_t i = 0; ok && i < h.node_count; i++)
+        if (ast.kinds.data[i] == NODE_SYMBOL)
+            ast.data.data[i].a = names[ast.data.data[i].a];
+
+    Unmap_File(&mapped);
+    if (ok) *out = ast;
+    return ok;
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_AST_Cache(Test_Info *info)
+{
+    const char *path = "sudu_cache_test.sudu" AST_CACHE_EXTENSION;
+    const char *src = "var count = 0\n"
+                      "count = count + 1\n"
+                      "print(count, -2.5 * (limit % 3))\n";
+    uint64_t hash = Hash_Source(src, strlen(src));
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+    bool ok = parsed.valid && AST_Cache_Write(&parsed.ast, path, hash);
+    if (!Assert(ok, info, "could not write the cache file"))
+    {
+        Arena_Free(&arena);
+        remove(path);
+        return;
+    }
+
+    /* a hit gives back the same nodes, a different source is a miss */
+    AST loaded;
+    ok = AST_Cache_Read(path, hash, &arena, 0, &loaded);
+    size_t count = AST_Count(&parsed.ast);
+    ok = ok && AST_Count(&loaded) == count
+            && loaded.items.count == parsed.ast.items.count
+            && loaded.extra.count == parsed.ast.extra.count
+            && memcmp(loaded.kinds.data, parsed.ast.kinds.data, count) == 0
+            && memcmp(loaded.data.data, parsed.ast.data.data, count * sizeof(Node_Data)) == 0
+            && memcmp(loaded.spans.data, parsed.ast.spans.data, count * sizeof(Node_Span)) == 0
+            && memcmp(loaded.extra.data, parsed.ast.extra.data,
+                      loaded.extra.count * sizeof(Node_Idx)) == 0;
+
+    AST stale;
+    ok = ok && !AST_Cache_Read(path, hash + 1, &arena, 0, &stale)
+            && !AST_Cache_Read("sudu_cache_test_missing" AST_CACHE_EXTENSION, hash, &arena, 0, &stale);
+
+    /* so is a tree whose hash matches but whose nodes point at the wrong kinds,
+       here a call whose arguments are an integer */
+    Node_Idx call = NODE_NONE, integer = NODE_NONE;
+    for (Node_Idx i = 1; i < count; i++)
+    {
+        if (AST_Get_Kind(&parsed.ast, i) == NODE_CALL) call = i;
+        if (AST_Get_Kind(&parsed.ast, i) == NODE_INTEGER && integer == NODE_NONE) integer = i;
+    }
+    ok = ok && call != NODE_NONE && integer != NODE_NONE;
+    if (ok)
+    {
+        Node_Idx args = parsed.ast.data.data[call].b;
+        parsed.ast.data.data[call].b = integer;
+        ok = AST_Cache_Write(&parsed.ast, path, hash) && !AST_Cache_Read(path, hash, &arena, 0, &stale);
+        parsed.ast.data.data[call].b = args;
+        ok = ok && AST_Cache_Write(&parsed.ast, path, hash) && AST_Cache_Read(path, hash, &arena, 0, &stale);
+    }
+
+    /* a truncated file is a miss as well, the half is copied out first since
+       rewriting a mapped file pulls the pages out from under the mapping */
+    Mapped_File whole;
+    char *half = NULL;
+    size_t half_len = 0;
+    if (ok && Map_File(path, &whole))
+    {
+        half_len = whole.len / 2;
+        half = malloc(half_len);
+        if (half) memcpy(half, whole.data, half_len);
+        Unmap_File(&whole);
+    }
+    FILE *file = half ? fopen(path, "wb") : NULL;
+    ok = ok && file && fwrite(half, 1, half_len, file) == half_len;
+    if (file) fclose(file);
+    free(half);
+    ok = ok && !AST_Cache_Read(path, hash, &arena, 0, &stale);
+
+    remove(path);
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "cache did not round-trip the AST"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,255 @@
+#include "frontend/check.h"
+#include "frontend/ast.h"
+#include "frontend/parser.h"
+#include "frontend/resolve.h"
+#include "frontend/types.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/tests.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//===============================================================================//
+// CHECKER STATE
+//===============================================================================//
+
+static const Token_Kind OPERATOR_TOKENS[] = {
+    #define X(name, token, str, flag, power, assoc) [name] = token,
+    OPERATOR_LIST
+    #undef X
+};
+
+typedef struct _checker
+{
+    AST *ast;
+    const Resolved *resolved;
+    Arena *arena;
+    Vec_Error *errs;
+    Type_Id *types;
+    Type_Id *locals;
+    bool failed;
+} checker;
+
+static void type_error(checker *c, Node_Idx id, const char *fmt, ...)
+{
+    c->failed = true;
+    Error e = (Error) {
+        .type = ERR_TYPE_MISMATCH,
+        .span = AST_Get_Span(c->ast, id),
+    };
+
+    va_list args;
+    va_start(args, fmt);
+    e.message = Error_VFormat(c->arena, &e.msg_len, fmt, args);
+    va_end(args);
+
+    Vec_Error_Push(c->errs, e);
+}
+
+static const char *spell(Operator op)
+{
+    return TOKEN_SPELLINGS[OPERATOR_TOKENS[op]];
+}
+
+static const char *name_of(checker *c, Type_Id type)
+{
+    return Type_Name(c->arena, type);
+}
+
+//===============================================================================//
+// RULES
+//===============================================================================//
+
+static Type_Id check_unary(checker *c, Node_Idx id)
+{
+    Node_Unary un = AST_Get_Unary(c->ast, id);
+    Type_Id operand = c->types[un.operand];
+    if (operand == TYPE_NONE || Type_Is_Numeric(operand)) return operand;
+
+    type_error(c, id, "`%s` cannot be applied to a value of type `%s`.", spell(un.op), name_of(c, operand));
+    return TYPE_NONE;
+}
+
+/// @brief Checks the operands of an arithmetic operator, shared by binary
+/// operators and compound assignment.
+static Type_Id check_arithmetic(checker *c, Node_Idx id, Operator op, Type_Id lhs, Type_Id rhs)
+{
+    if (lhs == TYPE_NONE || rhs == TYPE_NONE) return TYPE_NONE;
+    if (lhs == rhs && Type_Is_Numeric(lhs)) return lhs;
+
+    type_error(c, id, "`%s` cannot be applied to `%s` and `%s`.",
+        spell(op), name_of(c, lhs), name_of(c, rhs));
+    return TYPE_NONE;
+}
+
+static Type_Id check_assignment(checker *c, Node_Idx id)
+{
+    Node_Assignment assign = AST_Get_Assignment(c->ast, id);
+    Type_Id target = c->types[assign.sym];
+    Type_Id value = c->types[assign.val];
+    if (target == TYPE_NONE || value == TYPE_NONE) return TYPE_NONE;
+
+    if (assign.op != OP_ASSIGN)
+        return check_arithmetic(c, id, assign.op, target, value);
+    if (target == value) return target;
+
+    type_error(c, assign.val, "Cannot assign a value of type `%s` to a local of type `%s`.",
+        name_of(c, value), name_of(c, target));
+    return TYPE_NONE;
+}
+
+static Type_Id check_variable(checker *c, Node_Idx id)
+{
+    Node_Variable var = AST_Get_Variable(c->ast, id);
+    Type_Id init = c->types[var.initializer];
+    if (init == TYPE_VOID)
+    {
+        type_error(c, var.initializer, "This expression has no value to bind.");
+        init = TYPE_NONE;
+    }
+
+    uint32_t slot = c->resolved->slots[id];
+    if (slot != SLOT_NONE)
+        c->locals[slot] = c->types[var.symbol] = init;
+    return TYPE_VOID;
+}
+
+static Type_Id check_call(checker *c, Node_Idx id)
+{
+    Node_Call call = AST_Get_Call(c->ast, id);
+    Node_List args = AST_Get_List(c->ast, call.args);
+
+    switch (c->resolved->slots[id])
+    {
+    case BUILTIN_PRINT:
+    {
+        if (args.count != 1)
+        {
+            type_error(c, id, "`print` takes 1 argument, found %u.", (unsigned)args.count);
+            break;
+        }
+        Type_Id arg = c->types[args.nodes[0]];
+        if (arg != TYPE_NONE && !Type_Is_Numeric(arg) && arg != TYPE_BOOL)
+            type_error(c, args.nodes[0], "`print` cannot print a value of type `%s`.", name_of(c, arg));
+        break;
+    }
+    default: break;
+    }
+    return TYPE_VOID;
+}
+
+/// @brief Post-order visitor, the children of a node have their types when the
+/// walk leaves it.
+static Walk_Action check_node(AST *ast, Node_Idx id, uint32_t depth, void *ctx)
+{
+    (void)depth;
+    checker *c = ctx;
+    Type_Id type = TYPE_VOID;
+
+    switch (AST_Get_Kind(ast, id))
+    {
+    case NODE_INTEGER: type = TYPE_INT; break;
+    case NODE_FLOAT: type = TYPE_FLOAT; break;
+    case NODE_SYMBOL:
+    {
+        /* callees and names that did not resolve have no slot */
+        uint32_t slot = c->resolved->slots[id];
+        type = (slot != SLOT_NONE) ? c->locals[slot] : TYPE_NONE;
+        break;
+    }
+    case NODE_GROUPING: type = c->types[AST_Get_Inner(ast, id)]; break;
+    case NODE_UNARY: type = check_unary(c, id); break;
+    case NODE_BINARY:
+    {
+        Node_Binary bin = AST_Get_Binary(ast, id);
+        type = check_arithmetic(c, id, bin.op, c->types[bin.lhs], c->types[bin.rhs]);
+        break;
+    }
+    case NODE_ASSIGNMENT: type = check_assignment(c, id); break;
+    case NODE_VARIABLE: type = check_variable(c, id); break;
+    case NODE_CALL: type = check_call(c, id); break;
+    default: break;
+    }
+
+    c->types[id] = type;
+    return WALK_CONTINUE;
+}
+
+Checked Check_Types(AST *ast, const Resolved *resolved, Arena *arena, Vec_Error *errors)
+{
+    size_t count = AST_Count(ast);
+    size_t locals = (resolved->local_count != 0) ? resolved->local_count : 1;
+    checker c = (checker) {
+        .ast = ast,
+        .resolved = resolved,
+        .arena = arena,
+        .errs = errors,
+        .types = Arena_Alloc(arena, count * sizeof(Type_Id)),
+        .locals = Arena_Alloc(arena, locals * sizeof(Type_Id)),
+    };
+    if (!c.types || !c.locals) return (Checked) {0};
+
+    memset(c.types, 0, count * sizeof(Type_Id));
+    memset(c.locals, 0, locals * sizeof(Type_Id));
+
+    AST_Visitor visitor = (AST_Visitor) {.post = check_node, .ctx = &c};
+    bool walked = AST_Walk(ast, NODE_NONE, &visitor);
+
+    return (Checked) {
+        .types = c.types,
+        .locals = c.locals,
+        .valid = walked && !c.failed,
+    };
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Checker(Test_Info *info)
+{
+    const char *src = "var i = 0\n"
+                      "i = i + 1\n"
+                      "print(i)\n"
+                      "var x = 2.5 * -(1.0)\n"
+                      "x *= 2.0\n"
+                      "let bad = i + x\n"
+                      "let y = bad * 2\n"
+                      "i = x\n"
+                      "let v = print(x)\n"
+                      "print(1, 2)\n";
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+    AST *ast = &parsed.ast;
+    Resolved resolved = Resolve(ast, &arena, &errors);
+    if (!Assert(parsed.valid && resolved.valid, info, "checker test source did not resolve"))
+    {
+        Arena_Free(&arena);
+        return;
+    }
+
+    Checked checked = Check_Types(ast, &resolved, &arena, &errors);
+    Node_Idx *items = ast->items.data;
+    Node_Assignment inc = AST_Get_Assignment(ast, items[1]);
+
+    /* `bad` does not check, and `y` does not report it a second time */
+    bool ok = !checked.valid && errors.count == 4
+           && checked.locals[0] == TYPE_INT && checked.locals[1] == TYPE_FLOAT
+           && checked.locals[2] == TYPE_NONE && checked.locals[3] == TYPE_NONE
+           && checked.types[items[1]] == TYPE_INT && checked.types[inc.val] == TYPE_INT
+           && checked.types[items[2]] == TYPE_VOID && checked.types[items[4]] == TYPE_FLOAT
+           && errors.data[0].type == ERR_TYPE_MISMATCH;
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "types were not checked as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
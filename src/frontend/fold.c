@@ -0,0 +1,331 @@
+#include "frontend/fold.h"
+#include "frontend/ast.h"
+#include "frontend/parser.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//===============================================================================//
+// FOLDER STATE
+//===============================================================================//
+
+/// @brief State of one folding pass. `impure` holds a byte per node that is set when
+/// evaluating the node could have a side effect or stop the run, it is filled in
+/// bottom-up as the walk leaves each node.
+typedef struct _folder
+{
+    AST *ast;
+    Arena *arena;
+    Vec_Error *errs;
+    uint8_t *impure;
+    size_t folded;
+    bool failed;
+} folder;
+
+static void fold_error(folder *f, Node_Idx id, Error_Type type, const char *message)
+{
+    f->failed = true;
+    Error e = (Error) {
+        .type = type,
+        .span = AST_Get_Span(f->ast, id),
+    };
+    e.message = Error_Format(f->arena, &e.msg_len, "%s", message);
+    Vec_Error_Push(f->errs, e);
+}
+
+static bool is_integer(const AST *ast, Node_Idx id, int64_t value)
+{
+    return AST_Get_Kind(ast, id) == NODE_INTEGER && AST_Get_Integer(ast, id) == value;
+}
+
+/// @brief Returns whether a node is a `/` or `%` that could divide by zero at run
+/// time, anything but a nonzero integer literal as the divisor might.
+static bool may_trap(const AST *ast, Node_Idx id)
+{
+    if (AST_Get_Kind(ast, id) != NODE_BINARY) return false;
+    Node_Binary bin = AST_Get_Binary(ast, id);
+    if (bin.op != OP_DIV && bin.op != OP_MOD) return false;
+    return AST_Get_Kind(ast, bin.rhs) != NODE_INTEGER || is_integer(ast, bin.rhs, 0);
+}
+
+//===============================================================================//
+// FOLDING RULES
+//===============================================================================//
+
+/// @brief Folds an operator applied to two integers.
+/// @return `false` if the result cannot be computed, after reporting why.
+static bool fold_integers(folder *f, Node_Idx id, Operator op, int64_t a, int64_t b)
+{
+    int64_t result = 0;
+    bool overflow = false;
+
+    switch (op)
+    {
+    case OP_ADD: overflow = __builtin_add_overflow(a, b, &result); break;
+    case OP_SUB: overflow = __builtin_sub_overflow(a, b, &result); break;
+    case OP_MUL: overflow = __builtin_mul_overflow(a, b, &result); break;
+    case OP_DIV:
+    case OP_MOD:
+        if (b == 0)
+        {
+            fold_error(f, id, ERR_DIVISION_BY_ZERO, "Division by zero in a constant expression.");
+            return false;
+        }
+        /* INT64_MIN / -1 does not fit, INT64_MIN % -1 is 0 but undefined in C */
+        if (a == INT64_MIN && b == -1)
+        {
+            overflow = (op == OP_DIV);
+            result = 0;
+            break;
+        }
+        result = (op == OP_DIV) ? a / b : a % b;
+        break;
+    default: return false;
+    }
+
+    if (overflow)
+    {
+        fold_error(f, id, ERR_INTEGER_OVERFLOW, "Constant expression overflows a 64-bit integer.");
+        return false;
+    }
+
+    AST_Set_Integer(f->ast, id, result);
+    return true;
+}
+
+/// @brief Folds an operator applied to two floats, following IEEE 754 so division by
+/// zero gives an infinity or NaN rather than an error.
+static bool fold_floats(folder *f, Node_Idx id, Operator op, double a, double b)
+{
+    double result;
+    switch (op)
+    {
+    case OP_ADD: result = a + b; break;
+    case OP_SUB: result = a - b; break;
+    case OP_MUL: result = a * b; break;
+    case OP_DIV: result = a / b; break;
+    case OP_MOD: result = fmod(a, b); break;
+    default: return false;
+    }
+
+    AST_Set_Float(f->ast, id, result);
+    return true;
+}
+
+/// @brief Rewrites `x + 0`, `0 + x`, `x - 0`, `x * 1`, `1 * x` and `x / 1` to `(x)`,
+/// and `x * 0`, `0 * x` to `0` when `x` has no side effects and cannot trap.
+static bool simplify_binary(folder *f, Node_Idx id, Node_Binary bin)
+{
+    AST *ast = f->ast;
+    Node_Idx keep = NODE_NONE;
+
+    switch (bin.op)
+    {
+    case OP_ADD:
+        if (is_integer(ast, bin.rhs, 0)) keep = bin.lhs;
+        else if (is_integer(ast, bin.lhs, 0)) keep = bin.rhs;
+        break;
+    case OP_SUB:
+    case OP_DIV:
+        if (is_integer(ast, bin.rhs, bin.op == OP_SUB ? 0 : 1)) keep = bin.lhs;
+        break;
+    case OP_MUL:
+        if (is_integer(ast, bin.rhs, 1)) keep = bin.lhs;
+        else if (is_integer(ast, bin.lhs, 1)) keep = bin.rhs;
+        else if ((is_integer(ast, bin.rhs, 0) && !f->impure[bin.lhs])
+                 || (is_integer(ast, bin.lhs, 0) && !f->impure[bin.rhs]))
+        {
+            AST_Set_Integer(ast, id, 0);
+            return true;
+        }
+        break;
+    default: break;
+    }
+
+    if (keep == NODE_NONE) return false;
+    while (AST_Get_Kind(ast, keep) == NODE_GROUPING)
+        keep = AST_Get_Inner(ast, keep);
+    AST_Set_Grouping(ast, id, keep);
+    return true;
+}
+
+static bool fold_binary(folder *f, Node_Idx id)
+{
+    AST *ast = f->ast;
+    Node_Binary bin = AST_Get_Binary(ast, id);
+    Node_Kind lhs = AST_Get_Kind(ast, bin.lhs);
+    Node_Kind rhs = AST_Get_Kind(ast, bin.rhs);
+
+    if (lhs == NODE_INTEGER && rhs == NODE_INTEGER)
+        return fold_integers(f, id, bin.op,
+                             AST_Get_Integer(ast, bin.lhs), AST_Get_Integer(ast, bin.rhs));
+    if (lhs == NODE_FLOAT && rhs == NODE_FLOAT)
+        return fold_floats(f, id, bin.op,
+                           AST_Get_Float(ast, bin.lhs), AST_Get_Float(ast, bin.rhs));
+    return simplify_binary(f, id, bin);
+}
+
+static bool fold_unary(folder *f, Node_Idx id)
+{
+    AST *ast = f->ast;
+    Node_Unary un = AST_Get_Unary(ast, id);
+    if (un.op != OP_SUB) return false;
+
+    switch (AST_Get_Kind(ast, un.operand))
+    {
+    case NODE_INTEGER:
+    {
+        int64_t value = AST_Get_Integer(ast, un.operand);
+        if (value == INT64_MIN)
+        {
+            fold_error(f, id, ERR_INTEGER_OVERFLOW, "Constant expression overflows a 64-bit integer.");
+            return false;
+        }
+        AST_Set_Integer(ast, id, -value);
+        return true;
+    }
+    case NODE_FLOAT:
+        AST_Set_Float(ast, id, -AST_Get_Float(ast, un.operand));
+        return true;
+    default: return false;
+    }
+}
+
+/// @brief Post-order visitor, the children of a node are already folded when the
+/// walk leaves it.
+static Walk_Action fold_node(AST *ast, Node_Idx id, uint32_t depth, void *ctx)
+{
+    (void)depth;
+    folder *f = ctx;
+    Node_Kind kind = AST_Get_Kind(ast, id);
+
+    Node_Idx fixed[3];
+    uint32_t count;
+    const Node_Idx *children = AST_Children(ast, id, fixed, &count);
+    bool impure = (kind == NODE_CALL || kind == NODE_ASSIGNMENT || kind == NODE_VARIABLE)
+               || may_trap(ast, id);
+    for (uint32_t i = 0; !impure && i < count; i++)
+        impure = f->impure[children[i]];
+    f->impure[id] = impure;
+
+    bool folded = false;
+    switch (kind)
+    {
+    case NODE_GROUPING:
+    {
+        Node_Idx inner = AST_Get_Inner(ast, id);
+        Node_Kind inner_kind = AST_Get_Kind(ast, inner);
+        if (inner_kind == NODE_INTEGER)
+            AST_Set_Integer(ast, id, AST_Get_Integer(ast, inner));
+        else if (inner_kind == NODE_FLOAT)
+            AST_Set_Float(ast, id, AST_Get_Float(ast, inner));
+        folded = (inner_kind == NODE_INTEGER || inner_kind == NODE_FLOAT);
+        break;
+    }
+    case NODE_UNARY: folded = fold_unary(f, id); break;
+    case NODE_BINARY: folded = fold_binary(f, id); break;
+    default: break;
+    }
+
+    if (folded) f->folded++;
+    return WALK_CONTINUE;
+}
+
+//===============================================================================//
+// CONSTANT FOLDING
+//===============================================================================//
+
+Folded Fold_Constants(AST *ast, Arena *arena, Vec_Error *errors)
+{
+    folder f = (folder) {
+        .ast = ast,
+        .arena = arena,
+        .errs = errors,
+        .impure = calloc(AST_Count(ast), 1),
+    };
+    if (!f.impure) return (Folded) {0};
+
+    AST_Visitor visitor = (AST_Visitor) {.post = fold_node, .ctx = &f};
+    bool walked = AST_Walk(ast, NODE_NONE, &visitor);
+
+    free(f.impure);
+    return (Folded) {.folded = f.folded, .valid = walked && !f.failed};
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+/// @brief Returns the initializer of the nth top level declaration.
+static Node_Idx initializer(const AST *ast, size_t n)
+{
+    return AST_Get_Variable(ast, ast->items.data[n]).initializer;
+}
+
+void Test_Fold(Test_Info *info)
+{
+    const char *src = "let a = 2 + 3 * (4 - 1)\n"
+                      "let b = (1 + 2) * x\n"
+                      "let c = x * 1 + 0\n"
+                      "let d = f(x) * 0\n"
+                      "let e = 0 * (x - 1)\n"
+                      "let g = 1.5 * -2.0\n"
+                      "let h = 7 % -(3)\n"
+                      "let i = 9223372036854775807 + 1\n"
+                      "let j = 1 / (2 - 2)\n"
+                      "let k = x + 0.0\n"
+                      "let l = (1 / x) * 0\n"
+                      "let m = 0 * (x % 0)\n"
+                      "let n = (x / 2) * 0\n";
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+    if (!Assert(parsed.valid, info, "fold test source did not parse"))
+    {
+        Arena_Free(&arena);
+        return;
+    }
+
+    AST *ast = &parsed.ast;
+    Folded folded = Fold_Constants(ast, &arena, &errors);
+    Intern_Id x = Intern("x", 1);
+
+    Node_Binary b = AST_Get_Binary(ast, initializer(ast, 1));
+    bool ok = !folded.valid && errors.count == 2
+           && errors.data[0].type == ERR_INTEGER_OVERFLOW
+           && errors.data[1].type == ERR_DIVISION_BY_ZERO
+           && AST_Get_Integer(ast, initializer(ast, 0)) == 11
+           && AST_Get_Kind(ast, initializer(ast, 1)) == NODE_BINARY
+           && AST_Get_Integer(ast, b.lhs) == 3 && AST_Get_Symbol(ast, b.rhs) == x
+           && AST_Get_Kind(ast, initializer(ast, 2)) == NODE_GROUPING
+           && AST_Get_Symbol(ast, AST_Get_Inner(ast, initializer(ast, 2))) == x
+           && AST_Get_Kind(ast, initializer(ast, 3)) == NODE_BINARY
+           && AST_Get_Kind(ast, initializer(ast, 4)) == NODE_INTEGER
+           && AST_Get_Integer(ast, initializer(ast, 4)) == 0
+           && AST_Get_Float(ast, initializer(ast, 5)) == -3.0
+           && AST_Get_Integer(ast, initializer(ast, 6)) == 1
+           && AST_Get_Kind(ast, initializer(ast, 9)) == NODE_BINARY
+           && AST_Get_Kind(ast, initializer(ast, 10)) == NODE_BINARY
+           && AST_Get_Kind(ast, initializer(ast, 11)) == NODE_BINARY
+           && AST_Get_Integer(ast, initializer(ast, 12)) == 0;
+
+    /* folded nodes keep the span of the expression they replace */
+    Span span = AST_Get_Span(ast, initializer(ast, 0));
+    ok = ok && span.pos == 8 && span.len == 15;
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "constants were not folded as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -1,48 +1,30 @@
 #include "util/common.h"
 #include "util/errors.h"
 #include "frontend/lexer.h"
+#include "frontend/scan.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
 #include <ctype.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 //===============================================================================//
 // LEXER MACROS
 //===============================================================================//
 
 #define IS_EOF ((lexer->pos) >= (lexer->len))
-#define TOKEN_HERE(kind) (Token) {(kind), ((Span) {lexer->pos, 1}), lexer->x, lexer->y}
-#define TOKEN_DOUBLE(kind) (Token) {(kind), ((Span) {start_pos, 2}), start_col, lexer->y}
+#define TOKEN_HERE(token_kind) (Token) {.kind = (token_kind), .span = {.pos = lexer->pos, .len = 1}, .x = lexer->x, .y = lexer->y}
 
 //===============================================================================//
 // LEXER IMPLEMENTATION
 //===============================================================================//
 
-typedef struct _lexer_t
-{
-    List *errs;
-    const char *src;
-    size_t len;
-    size_t pos;
-    size_t x;
-    size_t y;
-} lexer_t;
-
-/* forward */ static Token next_token(lexer_t *lexer);
-
-static Token_Kind cmp_keywords(const char *src, const Span *span)
-{
-    if      (Cmp_Lexeme(src, span, "func"))
-        return TOK_FUNC;
-    else if (Cmp_Lexeme(src, span, "let"))
-        return TOK_LET;
-    else if (Cmp_Lexeme(src, span, "var"))
-        return TOK_VAR;
-    else
-        return TOK_SYMBOL_LITERAL;
-}
+/* forward */ static Token next_token(Lexer *lexer);
 
-static void consume_char(lexer_t *lexer)
+static void consume_char(Lexer *lexer)
 {
     if (IS_EOF)
         return;
@@ -50,14 +32,14 @@ static void consume_char(lexer_t *lexer)
     lexer->x += 1;
 }
 
-static char peek_char(const lexer_t *lexer)
+static char peek_char(const Lexer *lexer)
 {
     if (lexer->pos + 1 >= lexer->len)
         return '\0';
     return lexer->src[lexer->pos + 1];
 }
 
-static bool expect_char(lexer_t *lexer, char c)
+static bool expect_char(Lexer *lexer, char c)
 {
     if (peek_char(lexer) == c)
     {
@@ -68,31 +50,46 @@ static bool expect_char(lexer_t *lexer, char c)
     return false;
 }
 
-static char current_char(const lexer_t *lexer)
+static char current_char(const Lexer *lexer)
 {
     if (IS_EOF)
         return '\0';
     return lexer->src[lexer->pos];
 }
 
-static void eat_whitespace(lexer_t *lexer)
+/// @brief Jumps the lexer forward to `pos`, keeping the column in step.
+static void advance_to(Lexer *lexer, size_t pos)
 {
-    char ch = current_char(lexer);
-    while (ch == ' ' || ch == '\t' || ch == '\r')
+    lexer->x += pos - lexer->pos;
+    lexer->pos = pos;
+}
+
+/// @brief Jumps the lexer forward to `pos` over text that may span lines, such as
+/// a comment, keeping the line and column in step.
+static void advance_over_lines(Lexer *lexer, size_t pos)
+{
+    const char *at = lexer->src + lexer->pos;
+    const char *end = lexer->src + pos;
+    const char *newline;
+    while ((newline = memchr(at, '\n', (size_t)(end - at))) != NULL)
     {
-        consume_char(lexer);
-        ch = current_char(lexer);
+        lexer->y++;
+        lexer->x = 0;
+        lexer->pos = (size_t)(newline - lexer->src);
+        at = newline + 1;
     }
+    advance_to(lexer, pos);
 }
 
-static bool is_symbol_char_start(char c)
+static void eat_whitespace(Lexer *lexer)
 {
-    return (c != '\0' && (isalpha(c) || c == '_'));
+    if (IS_EOF) return;
+    advance_to(lexer, Scan_Whitespace(lexer->src, lexer->pos, lexer->len));
 }
 
-static bool is_symbol_char(char c)
+static bool is_symbol_char_start(char c)
 {
-    return (c != '\0' && (isalnum(c) || c == '_'));
+    return (c != '\0' && (isalpha(c) || c == '_'));
 }
 
 static bool is_number_char(char c)
@@ -105,19 +102,27 @@ static bool breaks_comment(char c)
     return (c == '\n' || c == '\0');
 }
 
+/// @brief Records a lexing error against the file being lexed.
+static void push_error(Lexer *lexer, Error e)
+{
+    e.span.file = lexer->file;
+    if (!Vec_Error_Push(lexer->errs, e))
+        lexer->lost_errors = true;
+}
+
 static Span distance_span(size_t to, size_t from)
 {
-    return (Span) {from, to - from + 1};
+    return (Span) {.pos = from, .len = to - from + 1};
 }
 
-static char peek_char_n(const lexer_t *lexer, size_t n)
+static char peek_char_n(const Lexer *lexer, size_t n)
 {
     if (lexer->pos + n >= lexer->len)
         return '\0';
     return lexer->src[lexer->pos + n];
 }
 
-static bool expect_char_n(lexer_t *lexer, char c, size_t n)
+static bool expect_char_n(Lexer *lexer, char c, size_t n)
 {
     if (lexer->pos + n > lexer->len) return false;
 
@@ -131,18 +136,25 @@ static bool expect_char_n(lexer_t *lexer, char c, size_t n)
     return true;
 }
 
-static void consume_char_n(lexer_t *lexer, size_t n)
+static void consume_char_n(Lexer *lexer, size_t n)
 {
     lexer->pos = (lexer->pos + n > lexer->len) ? lexer->len : lexer->pos + n;
 }
 
-static void skip_to_newline(lexer_t *lexer)
+static void skip_to_newline(Lexer *lexer)
 {
-    while (current_char(lexer) != '\n')
-        consume_char(lexer);
+    advance_to(lexer, Scan_Line(lexer->src, lexer->pos, lexer->len));
 }
 
-static Token take_string_literal(lexer_t *lexer, size_t pos, size_t x)
+/// @brief Skips over the run of characters the scanner accepts starting just after
+/// the current one, leaving the lexer on the last character of the run.
+static void take_run(Lexer *lexer, size_t (*scan)(const char *, size_t, size_t))
+{
+    if (lexer->pos + 1 >= lexer->len) return;
+    advance_to(lexer, scan(lexer->src, lexer->pos + 1, lexer->len) - 1);
+}
+
+static Token take_string_literal(Lexer *lexer, size_t pos, size_t x)
 {
     while (!expect_char(lexer, '"'))
     {
@@ -160,7 +172,7 @@ static Token take_string_literal(lexer_t *lexer, size_t pos, size_t x)
                     .message = message,
                     .msg_len = strlen(message)
                 };
-                List_Add(lexer->errs, &e);
+                push_error(lexer, e);
                 return next_token(lexer); /* should return this newline */
             }
             case '\0':
@@ -174,7 +186,7 @@ static Token take_string_literal(lexer_t *lexer, size_t pos, size_t x)
                     .message = message,
                     .msg_len = strlen(message),
                 };
-                List_Add(lexer->errs, &e);
+                push_error(lexer, e);
                 return next_token(lexer); /* should return this EOF */
             }
             default: consume_char(lexer);
@@ -189,7 +201,7 @@ static Token take_string_literal(lexer_t *lexer, size_t pos, size_t x)
     };
 }
 
-static Token take_raw_string_literal(lexer_t *lexer, size_t pos, size_t x, size_t y)
+static Token take_raw_string_literal(Lexer *lexer, size_t pos, size_t x, size_t y)
 {
     while (!expect_char_n(lexer, '"', 3))
     {
@@ -201,13 +213,18 @@ static Token take_raw_string_literal(lexer_t *lexer, size_t pos, size_t x, size_
                 .type = ERR_INVALID_LITERAL,
                 .span = {pos, 3}, /* 3 len for the triple " delimiter */
                 .x = x,
-                .y = lexer->y,
+                .y = y,
                 .message = message,
                 .msg_len = strlen(message),
             };
-            List_Add(lexer->errs, &e);
+            push_error(lexer, e);
             return next_token(lexer); /* should return this EOF */
         }
+        if (c == '\n')
+        {
+            lexer->y++;
+            lexer->x = 0; /* consume() advances it to 1 */
+        }
         consume_char(lexer);
     }
     
@@ -219,160 +236,402 @@ static Token take_raw_string_literal(lexer_t *lexer, size_t pos, size_t x, size_
     };
 }
 
-static Token take_multiline_comment(lexer_t *lexer)
+static Token take_multiline_comment(Lexer *lexer)
 {
-    while (!expect_char_n(lexer, '#', 3))
+    for (;;)
+    {
+        size_t pound = Scan_Pound(lexer->src, lexer->pos, lexer->len);
+        if (pound >= lexer->len)
+        {
+            /* unterminated, the rest of the file is comment */
+            advance_over_lines(lexer, lexer->len);
+            return next_token(lexer);
+        }
+
+        advance_over_lines(lexer, pound);
+        if (expect_char_n(lexer, '#', 3))
+            break;
         consume_char(lexer);
+    }
     consume_char(lexer);
     return next_token(lexer);
 }
 
 //===============================================================================//
-// TOKENIZER
+// OPERATOR STATE MACHINE
 //===============================================================================//
 
-static Token next_token(lexer_t *lexer)
+// Operators and punctuation are matched by a DFA built from the spellings in
+// `TOKEN_LIST`. Every byte is first mapped to a character class (0 for bytes that
+// never appear in an operator), then the transition table is indexed by state and
+// class. State 0 is the dead state and state 1 the start state, an accepting state
+// maps to its token kind and a non-accepting one to `TOK_ILLEGAL`.
+
+#define DFA_DEAD 0
+#define DFA_START 1
+#define DFA_MAX_STATES 128
+#define DFA_MAX_CLASSES 32
+
+/* states, classes and token kinds are all stored in bytes */
+_Static_assert(DFA_MAX_STATES <= UINT8_MAX + 1, "DFA states must fit in a byte");
+_Static_assert(DFA_MAX_CLASSES <= UINT8_MAX + 1, "DFA classes must fit in a byte");
+_Static_assert(TOKEN_KIND_COUNT <= UINT8_MAX + 1, "token kinds must fit in a byte");
+
+/// @brief Stops the program when the tables cannot be built from `TOKEN_LIST`. That
+/// is a mistake in the token list or in the table sizes here, and lexing on with
+/// a table that is wrong would misclassify tokens without a word.
+_Noreturn static void tables_failed(const char *why)
 {
+    fprintf(stderr, "sudu: cannot build the lexer tables, %s\n", why);
+    abort();
+}
 
-    if (IS_EOF) return TOKEN_HERE(TOK_EOF);
-    
-    eat_whitespace(lexer);
-    char ch = current_char(lexer);
-    size_t start_col = lexer->x;
-    size_t start_pos = lexer->pos;
+static uint8_t dfa_class[256];
+static uint8_t dfa_next[DFA_MAX_STATES][DFA_MAX_CLASSES];
+static uint8_t dfa_accept[DFA_MAX_STATES];
 
-    switch (ch)
+static void build_dfa(void)
+{
+    size_t states = DFA_START + 1;
+    size_t classes = 1;
+
+    for (size_t kind = 0; kind < sizeof(TOKEN_SPELLINGS) / sizeof(TOKEN_SPELLINGS[0]); kind++)
     {
-        case '(': return TOKEN_HERE(TOK_OPEN_PAREN);
-        case ')': return TOKEN_HERE(TOK_CLOSE_PAREN);
-        case '{': return TOKEN_HERE(TOK_OPEN_BRACE);
-        case '}': return TOKEN_HERE(TOK_CLOSE_BRACE);
-        case '[': return TOKEN_HERE(TOK_OPEN_BRACKET);
-        case ']': return TOKEN_HERE(TOK_CLOSE_BRACKET);
-        case '%': return TOKEN_HERE(TOK_PERCENT);
-        case ':': return TOKEN_HERE(TOK_COLON);
-        case ';': return TOKEN_HERE(TOK_SEMICOLON);
-        case '.': return TOKEN_HERE(TOK_DOT);
-        case ',': return TOKEN_HERE(TOK_COMMA);
-        case '?': return TOKEN_HERE(TOK_QUESTION);
+        const char *spelling = TOKEN_SPELLINGS[kind];
+        if (!spelling || is_symbol_char_start(spelling[0])) continue;
 
-        case '\n':
+        uint8_t state = DFA_START;
+        for (const char *c = spelling; *c; c++)
         {
-            Token tk = TOKEN_HERE(TOK_NEWLINE);
-            lexer->y++;
-            lexer->x = 0; /* zero here because consume() will advance it to 1 */
-            return tk;
-        }
+            uint8_t *class = &dfa_class[(uint8_t)*c];
+            if (*class == 0)
+            {
+                if (classes >= DFA_MAX_CLASSES) tables_failed("DFA_MAX_CLASSES is too small");
+                *class = (uint8_t)classes++;
+            }
 
-        case '+':
-        {
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_PLUS_EQUALS);
-            if (expect_char(lexer, '+'))
-                return TOKEN_DOUBLE(TOK_PLUS_PLUS);
-            return TOKEN_HERE(TOK_PLUS);
+            uint8_t *next = &dfa_next[state][*class];
+            if (*next == DFA_DEAD)
+            {
+                if (states >= DFA_MAX_STATES) tables_failed("DFA_MAX_STATES is too small");
+                *next = (uint8_t)states++;
+            }
+            state = *next;
         }
+        dfa_accept[state] = (uint8_t)kind;
+    }
+}
 
-        case '-':
-        {
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_MINUS_EQUALS);
-            if (expect_char(lexer, '-'))
-                return TOKEN_DOUBLE(TOK_MINUS_MINUS);
-            if (expect_char(lexer, '>'))
-                return TOKEN_DOUBLE(TOK_ARROW);
-            return TOKEN_HERE(TOK_MINUS);
-        }
+/// @brief Runs the operator DFA from the current character, taking the longest
+/// spelling that matches. On a match the lexer is left on its last character.
+/// @return the matched kind, or `TOK_ILLEGAL` if no operator starts here.
+static Token_Kind take_operator(Lexer *lexer)
+{
+    const uint8_t *src = (const uint8_t *)lexer->src;
+    Token_Kind kind = TOK_ILLEGAL;
+    size_t end = lexer->pos;
+    uint8_t state = DFA_START;
 
-        case '*':
+    for (size_t i = lexer->pos; i < lexer->len; i++)
+    {
+        state = dfa_next[state][dfa_class[src[i]]];
+        if (state == DFA_DEAD) break;
+        if (dfa_accept[state] != TOK_ILLEGAL)
         {
-            if (expect_char(lexer, '*'))
-            {
-                if (expect_char(lexer, '='))
-                    return (Token) {
-                        .kind = TOK_STAR_STAR_EQUALS,
-                        .span = (Span) {start_pos, 3},
-                        .x = start_col,
-                        .y = lexer->y
-                    };
-                return TOKEN_DOUBLE(TOK_STAR_STAR);
-            }
-            
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_STAR_EQUALS);
-            return TOKEN_HERE(TOK_STAR);
+            kind = dfa_accept[state];
+            end = i;
         }
+    }
+
+    if (kind != TOK_ILLEGAL)
+        advance_to(lexer, end);
+    return kind;
+}
 
-        case '/':
+//===============================================================================//
+// KEYWORD PERFECT HASH
+//===============================================================================//
+
+// Keywords are the spellings in `TOKEN_LIST` that look like identifiers. They are
+// placed with hash-and-displace into a table with exactly one slot per keyword:
+// the seed 0 hash picks a bucket, the bucket's displacement reseeds the hash, and
+// that hash picks the slot. So classifying an identifier costs two hashes and one
+// compare no matter how many keywords there are.
+
+/* every token kind could be a keyword, so the tables cannot overflow */
+#define KEYWORD_MAX TOKEN_KIND_COUNT
+
+typedef struct _keyword_t
+{
+    const char *spelling;
+    size_t len;
+    Token_Kind kind;
+} keyword_t;
+
+static keyword_t keyword_slots[KEYWORD_MAX];
+static uint8_t keyword_disp[KEYWORD_MAX];
+static size_t keyword_count = 0;
+
+/// @brief Hashes the length plus the first, middle and last characters.
+static uint32_t keyword_hash(const char *s, size_t len, uint32_t seed)
+{
+    uint32_t h = ((uint32_t)len * 0x9E3779B1u) ^ (seed * 0x85EBCA77u);
+    h = (h ^ (uint8_t)s[0]) * 0x01000193u;
+    h = (h ^ (uint8_t)s[len / 2]) * 0x01000193u;
+    h = (h ^ (uint8_t)s[len - 1]) * 0x01000193u;
+    return h ^ (h >> 15);
+}
+
+static void build_keywords(void)
+{
+    keyword_t found[KEYWORD_MAX];
+    size_t n = 0;
+
+    for (size_t kind = 0; kind < sizeof(TOKEN_SPELLINGS) / sizeof(TOKEN_SPELLINGS[0]); kind++)
+    {
+        const char *spelling = TOKEN_SPELLINGS[kind];
+        if (!spelling || !is_symbol_char_start(spelling[0])) continue;
+
+        found[n++] = (keyword_t) {spelling, strlen(spelling), (Token_Kind)kind};
+    }
+
+    keyword_count = n;
+    if (n == 0) return;
+
+    size_t bucket_of[KEYWORD_MAX];
+    size_t bucket_size[KEYWORD_MAX] = {0};
+    bool taken[KEYWORD_MAX] = {0};
+
+    for (size_t i = 0; i < n; i++)
+    {
+        bucket_of[i] = keyword_hash(found[i].spelling, found[i].len, 0) % n;
+        bucket_size[bucket_of[i]]++;
+    }
+
+    /* place the biggest buckets first while the table is still empty */
+    for (size_t size = n; size > 0; size--)
+    {
+        for (size_t bucket = 0; bucket < n; bucket++)
         {
-            if (expect_char(lexer, '/'))
+            if (bucket_size[bucket] != size) continue;
+
+            uint32_t disp;
+            for (disp = 1; disp <= UINT8_MAX; disp++)
             {
-                if (expect_char(lexer, '='))
-                    return (Token) {
-                        .kind = TOK_SLASH_SLASH_EQUALS,
-                        .span = (Span) {start_pos, 3},
-                        .x = start_col,
-                        .y = lexer->y
-                    };
-                return TOKEN_DOUBLE(TOK_SLASH_SLASH);
+                bool placed = true;
+                size_t slots[KEYWORD_MAX];
+                size_t count = 0;
+
+                for (size_t i = 0; i < n && placed; i++)
+                {
+                    if (bucket_of[i] != bucket) continue;
+
+                    size_t slot = keyword_hash(found[i].spelling, found[i].len, disp) % n;
+                    placed = !taken[slot];
+                    for (size_t j = 0; j < count && placed; j++)
+                        placed = slots[j] != slot;
+                    slots[count++] = slot;
+                }
+
+                if (!placed) continue;
+
+                count = 0;
+                for (size_t i = 0; i < n; i++)
+                {
+                    if (bucket_of[i] != bucket) continue;
+                    keyword_slots[slots[count]] = found[i];
+                    taken[slots[count++]] = true;
+                }
+                break;
             }
-            
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_SLASH_EQUALS);
-            return TOKEN_HERE(TOK_SLASH);
-        }
-     
-        case '=':
-        {
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_EQUALS_EQUALS);
-            if (expect_char(lexer, '>'))
-                return TOKEN_DOUBLE(TOK_FAT_ARROW);
-            return TOKEN_HERE(TOK_EQUALS);
-        }
 
-        case '<':
-        {
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_LESS_EQUALS);
-            return TOKEN_HERE(TOK_LESS);
+            /* keywords that share length, first, middle and last character */
+            /* can never be told apart, fail loudly rather than misclassify */
+            if (disp > UINT8_MAX) tables_failed("two keywords hash alike under every displacement");
+            keyword_disp[bucket] = (uint8_t)disp;
         }
+    }
+}
 
-        case '>':
-        {
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_GREATER_EQUALS);
-            return TOKEN_HERE(TOK_GREATER);
-        }
+static Token_Kind cmp_keywords(const char *src, const Span *span)
+{
+    if (keyword_count == 0) return TOK_SYMBOL_LITERAL;
 
-        case '!':
-        {
-            if (expect_char(lexer, '='))
-                return TOKEN_DOUBLE(TOK_BANG_EQUALS);
-            return TOKEN_HERE(TOK_BANG);
-        }
+    const char *s = src + span->pos;
+    size_t len = span->len;
 
-        case '&':
-        {
-            if (expect_char(lexer, '&'))
-                return TOKEN_DOUBLE(TOK_AMPSAND_AMPSAND);
-            return TOKEN_HERE(TOK_AMPSAND);
-        }
+    uint32_t disp = keyword_disp[keyword_hash(s, len, 0) % keyword_count];
+    const keyword_t *kw = &keyword_slots[keyword_hash(s, len, disp) % keyword_count];
+
+    if (kw->len == len && memcmp(kw->spelling, s, len) == 0)
+        return kw->kind;
+    return TOK_SYMBOL_LITERAL;
+}
+
+static bool tables_ready = false;
+
+static void build_tables(void)
+{
+    build_dfa();
+    build_keywords();
+    tables_ready = true;
+}
+
+//===============================================================================//
+// NUMERIC LITERALS
+//===============================================================================//
+
+#define FLOAT_LITERAL_BUFFER 64
 
-        case '|':
+/// @brief The value of a digit in the given radix, -1 if it is not one.
+static int digit_value(char c, int radix)
+{
+    int value;
+    char lower = (char)(c | 0x20);
+    if (c >= '0' && c <= '9')
+        value = c - '0';
+    else if (lower >= 'a' && lower <= 'f')
+        value = lower - 'a' + 10;
+    else
+        return -1;
+    return (value < radix) ? value : -1;
+}
+
+/// @brief The radix the character after a leading '0' selects, 10 if it is not a prefix.
+static int radix_of_prefix(char c)
+{
+    switch (c)
+    {
+        case 'x': case 'X': return 16;
+        case 'o': case 'O': return 8;
+        case 'b': case 'B': return 2;
+        default: return 10;
+    }
+}
+
+/// @brief Decodes integer digits, skipping separators.
+/// @return `false` if the value does not fit in an `int64_t`.
+static bool decode_integer(const char *digits, size_t len, int radix, int64_t *out)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (digits[i] == '_') continue;
+
+        int digit = digit_value(digits[i], radix);
+        if (value > ((uint64_t)INT64_MAX - (uint64_t)digit) / (uint64_t)radix)
+            return false;
+        value = value * (uint64_t)radix + (uint64_t)digit;
+    }
+
+    *out = (int64_t)value;
+    return true;
+}
+
+/// @brief Decodes a decimal float, skipping separators. Only literals longer than the
+/// stack buffer need to allocate.
+/// @return `false` if the value is too large to represent.
+static bool decode_float(const char *digits, size_t len, double *out)
+{
+    char buffer[FLOAT_LITERAL_BUFFER];
+    char *text = (len < sizeof(buffer)) ? buffer : malloc(len + 1);
+    if (!text) return false;
+
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++)
+        if (digits[i] != '_')
+            text[n++] = digits[i];
+    text[n] = '\0';
+
+    double value = strtod(text, NULL);
+    if (text != buffer) free(text);
+
+    if (isinf(value)) return false;
+    *out = value;
+    return true;
+}
+
+/// @brief Builds the token for the number literal the lexer has just passed over and
+/// decodes its value, a literal that does not fit is reported and decodes as 0.
+static Token take_number_literal(Lexer *lexer, Token_Kind kind, size_t start_pos, size_t start_col, int radix)
+{
+    Token t = (Token) {
+        .kind = kind,
+        .span = distance_span(lexer->pos, start_pos),
+        .x = start_col,
+        .y = lexer->y,
+    };
+
+    const char *digits = lexer->src + t.span.pos;
+    size_t len = t.span.len;
+    bool fits;
+
+    if (kind == TOK_FLOAT_LITERAL)
+    {
+        fits = decode_float(digits, len, &t.value.float_value);
+    }
+    else
+    {
+        size_t prefix = (radix != 10) ? 2 : 0;
+        fits = decode_integer(digits + prefix, len - prefix, radix, &t.value.int_value);
+    }
+
+    if (!fits)
+    {
+        const char *message = (kind == TOK_FLOAT_LITERAL)
+                            ? "Float literal is too large to be represented."
+                            : "Integer literal is too large, the largest integer is 9223372036854775807.";
+        push_error(lexer, (Error) {
+            .type = ERR_INVALID_LITERAL,
+            .span = t.span,
+            .x = start_col,
+            .y = lexer->y,
+            .message = message,
+            .msg_len = strlen(message),
+        });
+        t.value = (Token_Value) {0};
+    }
+
+    return t;
+}
+
+//===============================================================================//
+// TOKENIZER
+//===============================================================================//
+
+static Token next_token(Lexer *lexer)
+{
+
+    if (IS_EOF) return TOKEN_HERE(TOK_EOF);
+    
+    eat_whitespace(lexer);
+    char ch = current_char(lexer);
+    size_t start_col = lexer->x;
+    size_t start_pos = lexer->pos;
+
+    /* operators and punctuation */
+    Token_Kind op = take_operator(lexer);
+    if (op != TOK_ILLEGAL)
+        return (Token) {
+            .kind = op,
+            .span = distance_span(lexer->pos, start_pos),
+            .x = start_col,
+            .y = lexer->y,
+        };
+
+    switch (ch)
+    {
+        case '\n':
         {
-            if (expect_char(lexer, '|'))
-                return TOKEN_DOUBLE(TOK_PIPE_PIPE);
-            return TOKEN_HERE(TOK_PIPE);
+            Token tk = TOKEN_HERE(TOK_NEWLINE);
+            lexer->y++;
+            lexer->x = 0; /* zero here because consume() will advance it to 1 */
+            return tk;
         }
 
-
-        /* handle comments and directives */
+        /* handle comments, directives are matched as operators */
         case '#':
         {
-            if (expect_char(lexer, '!'))
-                return TOKEN_DOUBLE(TOK_POUND_BANG);
-
             if (expect_char_n(lexer, '#', 2))
                 return take_multiline_comment(lexer);
             
@@ -403,8 +662,7 @@ static Token next_token(lexer_t *lexer)
             /* handle identifiers */
             if (is_symbol_char_start(ch))
             {
-                while (is_symbol_char(peek_char(lexer)))
-                    consume_char(lexer);
+                take_run(lexer, Scan_Symbol);
                 
                 Span span = distance_span(lexer->pos, start_pos);
                 Token_Kind kind = cmp_keywords(lexer->src, &span);
@@ -419,36 +677,29 @@ static Token next_token(lexer_t *lexer)
             /* handle digits */
             if (is_number_char(ch))
             {
-                Token_Kind kind = TOK_INTEGER_LITERAL;
-                
-                char peeked_char;
-                while ((peeked_char = peek_char(lexer)) != '\0'
-                    && (is_number_char(peeked_char)))
+                /* a radix prefix only counts with a digit of its radix right after it */
+                int radix = (ch == '0') ? radix_of_prefix(peek_char(lexer)) : 10;
+                if (radix != 10 && digit_value(peek_char_n(lexer, 2), radix) >= 0)
                 {
-                    consume_char(lexer);
+                    consume_char(lexer); /* consume the prefix */
+                    while (peek_char(lexer) == '_' || digit_value(peek_char(lexer), radix) >= 0)
+                        consume_char(lexer);
+                    return take_number_literal(lexer, TOK_INTEGER_LITERAL, start_pos, start_col, radix);
                 }
 
+                Token_Kind kind = TOK_INTEGER_LITERAL;
+                take_run(lexer, Scan_Digits);
+
                 char maybe_dot = peek_char(lexer);
                 char after_dot = (maybe_dot != '\0') ? peek_char_n(lexer, 2) : '\0';
                 
                 if (maybe_dot == '.' && isdigit(after_dot)) {
                     kind = TOK_FLOAT_LITERAL;
                     consume_char(lexer); /* consume the dot */
-                    
-                    while ((peeked_char = peek_char(lexer)) != '\0'
-                        && (is_number_char(peeked_char)))
-                    {
-                        consume_char(lexer);
-                    }
+                    take_run(lexer, Scan_Digits);
                 }
 
-                Span span = distance_span(lexer->pos, start_pos);
-                return (Token) {
-                    .kind = kind,
-                    .span = span,
-                    .x = start_col,
-                    .y = lexer->y,
-                };
+                return take_number_literal(lexer, kind, start_pos, start_col, 10);
             }
             
             const char *message = "This character is not allowed.";
@@ -460,91 +711,257 @@ static Token next_token(lexer_t *lexer)
                 .message = message,
                 .msg_len = strlen(message)
             };
-            List_Add(lexer->errs, &e);
+            push_error(lexer, e);
             return TOKEN_HERE(TOK_ILLEGAL);
         }
     }
 }
 
-Tokens Tokenize(const char *src, List *errors)
+//===============================================================================//
+// STREAMING INTERFACE
+//===============================================================================//
+
+/// @brief Lexes the next token straight from the source, bypassing the lookahead.
+/// Once the end of the source is reached this keeps handing back the same EOF token.
+static Token produce_token(Lexer *lexer)
+{
+    if (lexer->done)
+        return lexer->eof;
+
+    if (current_char(lexer) == '\0')
+    {
+        lexer->done = true;
+        lexer->eof = (Token) {
+            .kind = TOK_EOF,
+            .span = (Span) {lexer->pos, 1, lexer->file},
+            .x = lexer->x,
+            .y = lexer->y,
+        };
+        return lexer->eof;
+    }
+
+    Token t = next_token(lexer);
+    t.span.file = lexer->file;
+    consume_char(lexer);
+
+    if (t.kind == TOK_EOF)
+    {
+        lexer->done = true;
+        lexer->eof = t;
+    }
+    return t;
+}
+
+Lexer Lexer_Init(const char *src, size_t len, File_Id file, Vec_Error *errors)
 {
-    lexer_t lexer = (lexer_t) {
+    if (!tables_ready) build_tables();
+
+    return (Lexer) {
         .errs = errors,
         .src = src,
-        .len = strlen(src),
+        .len = len,
+        .file = file,
         .pos = 0,
         .x = 1,
         .y = 1,
     };
+}
+
+Token Lexer_Next(Lexer *self)
+{
+    if (self->ahead_count == 0)
+        return produce_token(self);
 
-    List raw_tokens = List_New(sizeof(Token), INIT_TOKEN_CAPACITY);
-    if (raw_tokens.capacity == 0)
-        return (Tokens) {
-            .tokens = raw_tokens,
-            .valid = false,
+    Token t = self->ahead[self->ahead_head];
+    self->ahead_head = (self->ahead_head + 1) % LEXER_LOOKAHEAD;
+    self->ahead_count--;
+    return t;
+}
+
+Token Lexer_Peek(Lexer *self, size_t n)
+{
+    assert(n < LEXER_LOOKAHEAD);
+    if (n >= LEXER_LOOKAHEAD) n = LEXER_LOOKAHEAD - 1;
+
+    while (self->ahead_count <= n)
+    {
+        size_t tail = (self->ahead_head + self->ahead_count) % LEXER_LOOKAHEAD;
+        self->ahead[tail] = produce_token(self);
+        self->ahead_count++;
+    }
+
+    return self->ahead[(self->ahead_head + n) % LEXER_LOOKAHEAD];
+}
+
+//===============================================================================//
+// TOKEN STORE
+//===============================================================================//
+
+bool Token_Store_Add(Token_Store *self, Token const *token)
+{
+    if (!self || !token) return false;
+
+    if (self->count >= self->capacity)
+    {
+        size_t new_capacity = (self->capacity != 0)
+                            ? (self->capacity * VEC_GROWTH_FACTOR)
+                            : INIT_TOKEN_CAPACITY;
+        uint8_t *new_kinds = realloc(self->kinds, new_capacity * sizeof(uint8_t));
+        if (!new_kinds) return false;
+        self->kinds = new_kinds;
+
+        Token_Span *new_spans = realloc(self->spans, new_capacity * sizeof(Token_Span));
+        if (!new_spans) return false;
+        self->spans = new_spans;
+
+        self->capacity = new_capacity;
+    }
+
+    if (token->kind == TOK_INTEGER_LITERAL || token->kind == TOK_FLOAT_LITERAL)
+    {
+        if (self->literal_count >= self->literal_capacity)
+        {
+            size_t new_capacity = (self->literal_capacity != 0)
+                                ? (self->literal_capacity * VEC_GROWTH_FACTOR)
+                                : INIT_LITERAL_CAPACITY;
+            Token_Literal *new_literals = realloc(self->literals, new_capacity * sizeof(Token_Literal));
+            if (!new_literals) return false;
+
+            self->literals = new_literals;
+            self->literal_capacity = new_capacity;
+        }
+
+        self->literals[self->literal_count++] = (Token_Literal) {
+            .token = (uint32_t)self->count,
+            .value = token->value,
         };
+    }
 
-    Tokens buffer = (Tokens) {
-        .tokens = raw_tokens,
-        .valid = true,
+    self->kinds[self->count] = (uint8_t)token->kind;
+    self->spans[self->count] = (Token_Span) {
+        .pos = (uint32_t)token->span.pos,
+        .len = (uint32_t)token->span.len,
     };
+    self->count++;
+    return true;
+}
 
-    while(current_char(&lexer) != '\0')
+Token_Value Token_Store_Value(const Token_Store *self, size_t n)
+{
+    /* literals are appended in token order, so the side array is sorted */
+    size_t lo = 0, hi = self->literal_count;
+    while (lo < hi)
     {
-        Token t = next_token(&lexer);
-        List_Add(&buffer.tokens, &t);
+        size_t mid = lo + (hi - lo) / 2;
+        if (self->literals[mid].token < n) lo = mid + 1;
+        else                               hi = mid;
+    }
 
-        
+    if (lo < self->literal_count && self->literals[lo].token == n)
+        return self->literals[lo].value;
+    return (Token_Value) {0};
+}
 
-        consume_char(&lexer);
-    }
+Token Token_Store_Get(const Token_Store *self, size_t n)
+{
+    Token_Span span = self->spans[n];
+    Token t = (Token) {
+        .kind = (Token_Kind)self->kinds[n],
+        .span = (Span) {span.pos, span.len, self->file},
+    };
+    Line_Index_Locate(&self->lines, span.pos, &t.x, &t.y);
+    if (t.kind == TOK_INTEGER_LITERAL || t.kind == TOK_FLOAT_LITERAL)
+        t.value = Token_Store_Value(self, n);
+    return t;
+}
+
+void Token_Store_Free(Token_Store *self)
+{
+    if (!self) return;
+    free(self->kinds);
+    free(self->spans);
+    free(self->literals);
+    Line_Index_Free(&self->lines);
+    *self = (Token_Store) {0};
+}
+
+Tokens Tokenize(const char *src, size_t len, File_Id file, Vec_Error *errors)
+{
+    Lexer lexer = Lexer_Init(src, len, file, errors);
+    Tokens buffer = (Tokens) {0};
 
-    Token *last_tok = List_Get(&buffer.tokens, buffer.tokens.count - 1);
-    if (last_tok && last_tok->kind == TOK_EOF)
+    /* the store packs offsets into 32 bits */
+    if (len > UINT32_MAX)
         return buffer;
 
-    Token eof_tok = (Token) {
-        .kind = TOK_EOF,
-        .span = (Span) {lexer.pos, 1},
-        .x = lexer.x,
-        .y = lexer.y,
-    };
-    List_Add(&buffer.tokens, &eof_tok);
+    buffer.tokens.file = file;
+    buffer.tokens.lines = Line_Index_Build(src, len);
+    if (buffer.tokens.lines.count == 0)
+        return buffer;
+
+    Token t;
+    do
+    {
+        t = Lexer_Next(&lexer);
+        if (!Token_Store_Add(&buffer.tokens, &t))
+        {
+            Token_Store_Free(&buffer.tokens);
+            return buffer;
+        }
+    } while (t.kind != TOK_EOF);
+
+    /* a lexing error that could not be recorded makes the whole run invalid */
+    buffer.valid = !lexer.lost_errors;
     return buffer;
 }
 
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+/// @brief Reports errors from a test source lexed as file 0.
+static void report_test_errors(Vec_Error *errors, const char *path, const char *src)
+{
+    Source_Manager sources = Source_Manager_New();
+    File_Id file;
+    Source_Add_Buffer(&sources, path, src, strlen(src), &file);
+    Report_Errors(errors, &sources);
+    Source_Manager_Free(&sources);
+}
+
 void Test_Lexer(Test_Info *info)
 {
     const char *src = 
         "( ) { } [ ] \n"
         "+ - * / ++ -- ** += -= *= **= // /= //= % ! != = == < <= > >= | || & && : ; . ? , -> =>";
 
-    List errors = {0};
-    Tokens buf = Tokenize(src, &errors);
+    Vec_Error errors = {0};
+    Tokens buf = Tokenize(src, strlen(src), 0, &errors);
 
     if (!buf.valid) { 
-        Report_Errors(&errors, src, "test");
+        report_test_errors(&errors, "test", src);
         Assert(false, info, "lexer returned invalid buffer");
-        List_Free(&errors);
+        Vec_Error_Free(&errors);
         return;
     }
 
     size_t count = buf.tokens.count;
     Assert(count > 0, info, "lexer produced no tokens");
 
-    Token *tokens = (Token *)buf.tokens.data;
+    uint8_t *kinds = buf.tokens.kinds;
 
-    Assert(tokens[0].kind == TOK_OPEN_PAREN, info, "expected TOK_OPEN_PAREN as first token");
-    Assert(tokens[1].kind == TOK_CLOSE_PAREN, info, "expected TOK_CLOSE_PAREN as second token");
-    Assert(tokens[2].kind == TOK_OPEN_BRACE, info, "expected TOK_OPEN_BRACE as third token");
-    Assert(tokens[3].kind == TOK_CLOSE_BRACE, info, "expected TOK_CLOSE_BRACE as fourth token");
+    Assert(kinds[0] == TOK_OPEN_PAREN, info, "expected TOK_OPEN_PAREN as first token");
+    Assert(kinds[1] == TOK_CLOSE_PAREN, info, "expected TOK_CLOSE_PAREN as second token");
+    Assert(kinds[2] == TOK_OPEN_BRACE, info, "expected TOK_OPEN_BRACE as third token");
+    Assert(kinds[3] == TOK_CLOSE_BRACE, info, "expected TOK_CLOSE_BRACE as fourth token");
 
     for (size_t i = 0; i < count; ++i) {
-        Token *tok = &tokens[i];
-        Print_Token(src, tok);
+        Token tok = Token_Store_Get(&buf.tokens, i);
+        Print_Token(src, &tok);
     }
 
-    List_Free(&errors);
+    Token_Store_Free(&buf.tokens);
+    Vec_Error_Free(&errors);
 
     info->success = true;
     info->status = true;
@@ -556,27 +973,26 @@ void Test_Literals(Test_Info *info)
         "0 .5 5. 0.5.round() 1_000 1_000.5 42__42 3..14\n"
         "symbol func var let another_symbol343 _and_another";
 
-    List errors = List_New(sizeof(Error), 4);
-    Tokens buf = Tokenize(src, &errors);
+    Vec_Error errors = Vec_Error_New(4);
+    Tokens buf = Tokenize(src, strlen(src), 0, &errors);
 
     if (!buf.valid) {
-        Report_Errors(&errors, src, "test");
+        report_test_errors(&errors, "test", src);
         Assert(false, info, "lexer returned invalid buffer");
-        List_Free(&errors);
+        Vec_Error_Free(&errors);
         return;
     }
 
     size_t count = buf.tokens.count;
     Assert(count > 0, info, "lexer produced no tokens");
 
-    Token *tokens = (Token *)buf.tokens.data;
-
     for (size_t i = 0; i < count; ++i) {
-        Token *tok = &tokens[i];
-        Print_Token(src, tok);
+        Token tok = Token_Store_Get(&buf.tokens, i);
+        Print_Token(src, &tok);
     }
 
-    List_Free(&errors);
+    Token_Store_Free(&buf.tokens);
+    Vec_Error_Free(&errors);
 
     info->success = true;
     info->status = true;
@@ -589,30 +1005,290 @@ void Test_Lexer_Other(Test_Info *info)
         "\"this one will also error\n"
         "\"\"\"this will error";
 
-    List errors = List_New(sizeof(Error), 4);
-    Tokens buf = Tokenize(src, &errors);
+    Vec_Error errors = Vec_Error_New(4);
+    Tokens buf = Tokenize(src, strlen(src), 0, &errors);
 
     if (!buf.valid) {
-        Report_Errors(&errors, src, "test");
+        report_test_errors(&errors, "test", src);
         Assert(false, info, "lexer returned invalid buffer");
-        List_Free(&errors);
+        Vec_Error_Free(&errors);
         return;
     }
 
     size_t count = buf.tokens.count;
     Assert(count > 0, info, "lexer produced no tokens");
 
-    Token *tokens = (Token *)buf.tokens.data;
-
     for (size_t i = 0; i < count; ++i) {
-        Token *tok = &tokens[i];
-        Print_Token(src, tok);
+        Token tok = Token_Store_Get(&buf.tokens, i);
+        Print_Token(src, &tok);
     }
 
-    Report_Errors(&errors, src, "<TestPath>.sudu");
+    report_test_errors(&errors, "<TestPath>.sudu", src);
 
-    List_Free(&errors);
+    Token_Store_Free(&buf.tokens);
+    Vec_Error_Free(&errors);
 
     info->success = true;
     info->status = true;
 } 
+
+void Test_Lexer_Scan_Levels(Test_Info *info)
+{
+    const char *src =
+        "let a_rather_long_identifier_name_for_the_vector_path = 1_000_000_000_000_000_000\n"
+        "var y                                     =     3.14159265358979323846264338327950\n"
+        "# a single line comment that is long enough to cover more than one vector block\n"
+        "##\n"
+        "  a multi-line comment # with # stray # pounds ## in it\n"
+        "###\n"
+        "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\tfunc(y, 12) // 4\n"
+        "# unterminated comment at the end of the file";
+
+    Scan_Level restore = Scan_Get_Level();
+    Scan_Level best = Scan_Best_Level();
+
+    Scan_Set_Level(SCAN_SCALAR);
+    Vec_Error scalar_errors = Vec_Error_New(4);
+    Tokens scalar = Tokenize(src, strlen(src), 0, &scalar_errors);
+
+    for (Scan_Level level = SCAN_SSE2; level <= best; level++)
+    {
+        Scan_Set_Level(level);
+        Vec_Error errors = Vec_Error_New(4);
+        Tokens buf = Tokenize(src, strlen(src), 0, &errors);
+
+        bool same = buf.tokens.count == scalar.tokens.count
+                 && errors.count == scalar_errors.count;
+        for (size_t i = 0; same && i < buf.tokens.count; i++)
+        {
+            same = buf.tokens.kinds[i] == scalar.tokens.kinds[i]
+                && buf.tokens.spans[i].pos == scalar.tokens.spans[i].pos
+                && buf.tokens.spans[i].len == scalar.tokens.spans[i].len;
+        }
+
+        Token_Store_Free(&buf.tokens);
+        Vec_Error_Free(&errors);
+        if (!Assert(same, info, "vector scan level produced a different token stream"))
+        {
+            Scan_Set_Level(restore);
+            Token_Store_Free(&scalar.tokens);
+            Vec_Error_Free(&scalar_errors);
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < scalar.tokens.count; ++i)
+    {
+        Token tok = Token_Store_Get(&scalar.tokens, i);
+        Print_Token(src, &tok);
+    }
+
+    Scan_Set_Level(restore);
+    Token_Store_Free(&scalar.tokens);
+    Vec_Error_Free(&scalar_errors);
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Lexer_Operators(Test_Info *info)
+{
+    /* every fixed spelling has to lex back to exactly its own token */
+    for (size_t kind = 0; kind < sizeof(TOKEN_SPELLINGS) / sizeof(TOKEN_SPELLINGS[0]); kind++)
+    {
+        const char *spelling = TOKEN_SPELLINGS[kind];
+        if (!spelling) continue;
+
+        Vec_Error errors = Vec_Error_New(4);
+        Tokens buf = Tokenize(spelling, strlen(spelling), 0, &errors);
+        bool ok = buf.tokens.count == 2 && errors.count == 0
+               && buf.tokens.kinds[0] == kind
+               && buf.tokens.spans[0].len == strlen(spelling);
+        printf("> '%s' -> %s\n", spelling, TOKEN_KIND_NAMES[buf.tokens.kinds[0]]);
+
+        Token_Store_Free(&buf.tokens);
+        Vec_Error_Free(&errors);
+        if (!Assert(ok, info, "operator spelling did not lex to its own token"))
+            return;
+    }
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Lexer_Keywords(Test_Info *info)
+{
+    /* near misses of every keyword have to stay plain symbols */
+    const char *src = "fun funcs lett le va vars mu muts pro procs en ends retur returns Func LET _end";
+
+    Vec_Error errors = Vec_Error_New(4);
+    Tokens buf = Tokenize(src, strlen(src), 0, &errors);
+
+    bool ok = errors.count == 0;
+    for (size_t i = 0; ok && i < buf.tokens.count; i++)
+    {
+        Token tok = Token_Store_Get(&buf.tokens, i);
+        Print_Token(src, &tok);
+        ok = tok.kind == TOK_SYMBOL_LITERAL || tok.kind == TOK_EOF;
+    }
+
+    Token_Store_Free(&buf.tokens);
+    Vec_Error_Free(&errors);
+    if (!Assert(ok, info, "identifier was misclassified as a keyword"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Lexer_Stream(Test_Info *info)
+{
+    const char *src =
+        "var i = 0\n"
+        "i = i + 1 # trailing comment\n"
+        "print(i)";
+
+    Vec_Error errors = Vec_Error_New(4);
+    Tokens buf = Tokenize(src, strlen(src), 0, &errors);
+    Lexer lexer = Lexer_Init(src, strlen(src), 0, &errors);
+
+    /* peek at a different depth before every pull, the stream has to come */
+    /* out exactly as the materialized buffer did and then repeat EOF */
+    bool ok = true;
+    for (size_t i = 0; ok && i < buf.tokens.count + 4; i++)
+    {
+        size_t depth = i % LEXER_LOOKAHEAD;
+        size_t ahead = (i + depth < buf.tokens.count) ? i + depth : buf.tokens.count - 1;
+        Token expect_ahead = Token_Store_Get(&buf.tokens, ahead);
+        Token peeked = Lexer_Peek(&lexer, depth);
+        ok = peeked.kind == expect_ahead.kind && peeked.span.pos == expect_ahead.span.pos;
+
+        size_t at = (i < buf.tokens.count) ? i : buf.tokens.count - 1;
+        Token expect = Token_Store_Get(&buf.tokens, at);
+        Token t = Lexer_Next(&lexer);
+        ok = ok && t.kind == expect.kind
+                && t.span.pos == expect.span.pos && t.span.len == expect.span.len
+                && t.x == expect.x && t.y == expect.y;
+        if (ok) Print_Token(src, &t);
+    }
+
+    Token_Store_Free(&buf.tokens);
+    Vec_Error_Free(&errors);
+    if (!Assert(ok, info, "streamed tokens did not match Tokenize"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Token_Store(Test_Info *info)
+{
+    const char *src =
+        "let a = 1\n"
+        "##\n"
+        "  comment\n"
+        "###\n"
+        "\"\"\"raw\nstring\"\"\" b";
+
+    Vec_Error errors = Vec_Error_New(4);
+    Tokens buf = Tokenize(src, strlen(src), 0, &errors);
+    if (!Assert(buf.valid, info, "lexer returned invalid buffer"))
+    {
+        Vec_Error_Free(&errors);
+        return;
+    }
+
+    size_t packed = sizeof(buf.tokens.kinds[0]) + sizeof(buf.tokens.spans[0]);
+    printf("> %zu bytes per stored token, %zu per Token\n", packed, sizeof(Token));
+
+    /* line/column come from the real line starts, so they stay right */
+    /* after comments and raw strings that span lines */
+    Token b = Token_Store_Get(&buf.tokens, buf.tokens.count - 2);
+    Print_Token(src, &b);
+    bool ok = b.kind == TOK_SYMBOL_LITERAL && b.y == 6 && b.x == 11;
+
+    Token_Store_Free(&buf.tokens);
+    Vec_Error_Free(&errors);
+    if (!Assert(ok, info, "stored token expanded to the wrong line/column"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Lexer_Numbers(Test_Info *info)
+{
+    struct { const char *src; Token_Kind kind; int64_t int_value; double float_value; size_t errors; } cases[] = {
+        {"0",                    TOK_INTEGER_LITERAL, 0,                   0.0,    0},
+        {"1_000_000",            TOK_INTEGER_LITERAL, 1000000,             0.0,    0},
+        {"0x1F",                 TOK_INTEGER_LITERAL, 31,                  0.0,    0},
+        {"0XdEaD_bEeF",          TOK_INTEGER_LITERAL, 0xDEADBEEF,          0.0,    0},
+        {"0b1010_1010",          TOK_INTEGER_LITERAL, 170,                 0.0,    0},
+        {"0o17",                 TOK_INTEGER_LITERAL, 15,                  0.0,    0},
+        {"9223372036854775807",  TOK_INTEGER_LITERAL, INT64_MAX,           0.0,    0},
+        {"9223372036854775808",  TOK_INTEGER_LITERAL, 0,                   0.0,    1},
+        {"0x1_0000_0000_0000_0000", TOK_INTEGER_LITERAL, 0,                0.0,    1},
+        {"3.25",                 TOK_FLOAT_LITERAL,   0,                   3.25,   0},
+        {"1_000.5",              TOK_FLOAT_LITERAL,   0,                   1000.5, 0},
+        {"0x",                   TOK_INTEGER_LITERAL, 0,                   0.0,    0}, /* '0' then symbol 'x' */
+        {"0b2",                  TOK_INTEGER_LITERAL, 0,                   0.0,    0}, /* '0' then symbol 'b2' */
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const char *src = cases[i].src;
+        Vec_Error errors = Vec_Error_New(4);
+        Tokens buf = Tokenize(src, strlen(src), 0, &errors);
+
+        Token tok = Token_Store_Get(&buf.tokens, 0);
+        Print_Token(src, &tok);
+
+        bool ok = tok.kind == cases[i].kind && errors.count == cases[i].errors;
+        if (tok.kind == TOK_INTEGER_LITERAL)
+            ok = ok && tok.value.int_value == cases[i].int_value;
+        else
+            ok = ok && tok.value.float_value == cases[i].float_value;
+
+        Token_Store_Free(&buf.tokens);
+        Vec_Error_Free(&errors);
+        if (!Assert(ok, info, "numeric literal decoded to the wrong value"))
+        {
+            printf("> case '%s' failed\n", src);
+            return;
+        }
+    }
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Lexer_Lines(Test_Info *info)
+{
+    /* the line count has to take in the newlines a comment or raw string skips */
+    const char *src =
+        "##\n"
+        "comment\n"
+        "###\n"
+        "let s = \"\"\"a\n"
+        "b\"\"\"\n"
+        "x = $\n";
+
+    Vec_Error errors = Vec_Error_New(4);
+    Lexer lexer = Lexer_Init(src, strlen(src), 0, &errors);
+
+    Token x = (Token) {0};
+    for (Token t = Lexer_Next(&lexer); t.kind != TOK_EOF; t = Lexer_Next(&lexer))
+        if (t.kind == TOK_SYMBOL_LITERAL && src[t.span.pos] == 'x')
+            x = t;
+
+    bool ok = x.y == 6 && x.x == 1
+           && errors.count == 1 && errors.data[0].type == ERR_ILLEGAL_CHAR
+           && errors.data[0].y == 6 && errors.data[0].x == 5;
+
+    Vec_Error_Free(&errors);
+    if (!Assert(ok, info, "lexer lost count of the lines"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,587 @@
+#include "frontend/parser.h"
+#include "frontend/ast.h"
+#include "frontend/lexer.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+//===============================================================================//
+// PRECEDENCE TABLES
+//===============================================================================//
+
+/* indexed by token kind and generated from OPERATOR_LIST, a power of 0 means the
+   token is not an infix operator and a prefix entry of 0 that it is not a prefix one */
+
+#define OP_CALL_POWER (OP_PREFIX_POWER + 10)
+#define IS_INFIX(flag) ((flag) & (OP_FLAG_BINARY | OP_FLAG_ASSIGN))
+
+static const uint8_t INFIX_POWER[TOK_EOF + 1] = {
+    #define X(name, token, str, flag, power, assoc) [token] = IS_INFIX(flag) ? (power) : 0,
+    OPERATOR_LIST
+    #undef X
+};
+
+static const uint8_t INFIX_ASSOC[TOK_EOF + 1] = {
+    #define X(name, token, str, flag, power, assoc) [token] = (assoc),
+    OPERATOR_LIST
+    #undef X
+};
+
+static const uint8_t INFIX_ASSIGN[TOK_EOF + 1] = {
+    #define X(name, token, str, flag, power, assoc) [token] = ((flag) & OP_FLAG_ASSIGN) != 0,
+    OPERATOR_LIST
+    #undef X
+};
+
+static const uint8_t TOKEN_OPERATOR[TOK_EOF + 1] = {
+    #define X(name, token, str, flag, power, assoc) [token] = (name),
+    OPERATOR_LIST
+    #undef X
+};
+
+static const uint8_t IS_PREFIX[TOK_EOF + 1] = {
+    #define X(name, token, str, flag, power, assoc) [token] = ((flag) & OP_FLAG_UNARY) != 0,
+    OPERATOR_LIST
+    #undef X
+};
+
+//===============================================================================//
+// TOKEN HANDLING
+//===============================================================================//
+
+static void advance(Parser *p)
+{
+    p->previous = p->current;
+    p->current = Lexer_Next(&p->lexer);
+}
+
+static bool check(const Parser *p, Token_Kind kind)
+{
+    return p->current.kind == kind;
+}
+
+static bool match(Parser *p, Token_Kind kind)
+{
+    if (!check(p, kind)) return false;
+    advance(p);
+    return true;
+}
+
+/// @brief Newlines end statements, except inside parentheses where an expression
+/// may run over several lines.
+static void skip_newlines_in_parens(Parser *p)
+{
+    if (p->parens == 0) return;
+    while (match(p, TOK_NEWLINE));
+}
+
+static Span join_spans(Span from, Span to)
+{
+    return (Span) {
+        .pos = from.pos,
+        .len = (to.pos + to.len > from.pos) ? to.pos + to.len - from.pos : from.len,
+        .file = from.file,
+    };
+}
+
+//===============================================================================//
+// ERRORS
+//===============================================================================//
+
+/// @brief Describes a token for an error message, "`x`" or "end of line".
+static const char *describe(Parser *p, Token const *token)
+{
+    switch (token->kind)
+    {
+        case TOK_NEWLINE: return "end of line";
+        case TOK_EOF:     return "end of file";
+        default:
+        {
+            const char *text = Error_Format(p->arena, NULL, "`%.*s`",
+                (int)token->span.len, p->lexer.src + token->span.pos);
+            return text;
+        }
+    }
+}
+
+/// @brief Returns the line a token starts on. The lexer's own count is not to be
+/// trusted for this, so the line comes from the token's offset.
+static size_t line_of(Parser *p, Token const *token)
+{
+    if (p->lines.count == 0)
+        p->lines = Line_Index_Build(p->lexer.src, p->lexer.len);
+
+    size_t x = 0, y = 0;
+    Line_Index_Locate(&p->lines, token->span.pos, &x, &y);
+    return y;
+}
+
+/// @brief Reports an error at a token, unless the statement already has one. The
+/// position is left for `Print_Error` to work out from the span.
+static void error_at(Parser *p, Token const *token, Error_Type type, const char *fmt, ...)
+{
+    p->failed = true;
+    if (p->panic) return;
+    p->panic = true;
+
+    Error e = (Error) {
+        .type = type,
+        .span = token->span,
+    };
+
+    va_list args;
+    va_start(args, fmt);
+    e.message = Error_VFormat(p->arena, &e.msg_len, fmt, args);
+    va_end(args);
+
+    Vec_Error_Push(p->errs, e);
+}
+
+/// @brief Skips the rest of the line the error happened on.
+static void synchronize(Parser *p)
+{
+    while (!check(p, TOK_NEWLINE) && !check(p, TOK_EOF))
+        advance(p);
+    p->panic = false;
+    p->parens = 0;
+    p->depth = 0;
+}
+
+/// @brief Notes a node that could not be allocated.
+static Node_Idx checked(Parser *p, Node_Idx node)
+{
+    if (node == NODE_NONE) p->failed = true;
+    return node;
+}
+
+//===============================================================================//
+// EXPRESSIONS
+//===============================================================================//
+
+static Node_Idx parse_expression(Parser *p, uint8_t min_power);
+
+static Node_Idx parse_symbol(Parser *p, Token const *name)
+{
+    Intern_Id id = Intern(p->lexer.src + name->span.pos, name->span.len);
+    if (id == INTERN_NONE) p->failed = true;
+    return checked(p, Make_Node_Symbol(p->ast, name->span, id));
+}
+
+static Node_Idx parse_grouping(Parser *p)
+{
+    Token open = p->current;
+    advance(p);
+    p->parens++;
+    skip_newlines_in_parens(p);
+
+    Node_Idx inner = parse_expression(p, 0);
+    skip_newlines_in_parens(p);
+    if (p->panic) return NODE_NONE;
+
+    if (!match(p, TOK_CLOSE_PAREN))
+    {
+        error_at(p, &p->current, ERR_SYNTAX, "Expected `)` to close the `(` on line %zu, found %s.",
+            line_of(p, &open), describe(p, &p->current));
+        return NODE_NONE;
+    }
+    p->parens--;
+
+    return checked(p, Make_Node_Grouping(p->ast, join_spans(open.span, p->previous.span), inner));
+}
+
+static Node_Idx parse_call(Parser *p, Node_Idx callee)
+{
+    Token open = p->current;
+    if (AST_Get_Kind(p->ast, callee) != NODE_SYMBOL)
+    {
+        error_at(p, &open, ERR_SYNTAX, "Only a name can be called.");
+        return NODE_NONE;
+    }
+
+    advance(p);
+    p->parens++;
+    skip_newlines_in_parens(p);
+
+    /* arguments pile up on the scratch stack until the list is closed */
+    size_t base = p->scratch.count;
+    while (!check(p, TOK_CLOSE_PAREN))
+    {
+        Node_Idx arg = parse_expression(p, 0);
+        if (p->panic) break;
+        if (!Vec_Node_Idx_Push(&p->scratch, arg)) p->failed = true;
+
+        skip_newlines_in_parens(p);
+        if (!match(p, TOK_COMMA)) break;
+        skip_newlines_in_parens(p);
+    }
+
+    if (!p->panic && !match(p, TOK_CLOSE_PAREN))
+        error_at(p, &p->current, ERR_SYNTAX, "Expected `,` or `)` in the call on line %zu, found %s.",
+            line_of(p, &open), describe(p, &p->current));
+    if (p->panic)
+    {
+        Vec_Node_Idx_Truncate(&p->scratch, base);
+        return NODE_NONE;
+    }
+    p->parens--;
+
+    Node_Idx args = checked(p, Make_Node_List(p->ast, join_spans(open.span, p->previous.span),
+        p->scratch.data + base, (uint32_t)(p->scratch.count - base)));
+    Vec_Node_Idx_Truncate(&p->scratch, base);
+
+    Span span = join_spans(AST_Get_Span(p->ast, callee), p->previous.span);
+    return checked(p, Make_Node_Call(p->ast, span, callee, args));
+}
+
+static Node_Idx parse_prefix(Parser *p)
+{
+    Token t = p->current;
+    switch (t.kind)
+    {
+        case TOK_INTEGER_LITERAL:
+        {
+            advance(p);
+            return checked(p, Make_Node_Integer(p->ast, t.span, t.value.int_value));
+        }
+        case TOK_FLOAT_LITERAL:
+        {
+            advance(p);
+            return checked(p, Make_Node_Float(p->ast, t.span, t.value.float_value));
+        }
+        case TOK_SYMBOL_LITERAL:
+        {
+            advance(p);
+            return parse_symbol(p, &t);
+        }
+        case TOK_OPEN_PAREN:
+        {
+            return parse_grouping(p);
+        }
+        case TOK_ILLEGAL:
+        {
+            /* the lexer has already reported it */
+            p->failed = true;
+            p->panic = true;
+            return NODE_NONE;
+        }
+        default: break;
+    }
+
+    if (IS_PREFIX[t.kind])
+    {
+        advance(p);
+        Node_Idx operand = parse_expression(p, OP_PREFIX_POWER);
+        if (p->panic) return NODE_NONE;
+
+        Span span = join_spans(t.span, AST_Get_Span(p->ast, operand));
+        return checked(p, Make_Node_Unary(p->ast, span, operand, (Operator)TOKEN_OPERATOR[t.kind]));
+    }
+
+    error_at(p, &t, ERR_EXPECTED_EXPRESSION, "Expected an expression, found %s.", describe(p, &t));
+    return NODE_NONE;
+}
+
+/// @brief Parses an expression whose operators all bind at least as tightly as
+/// `min_power`, the core of the precedence climbing.
+static Node_Idx parse_expression(Parser *p, uint8_t min_power)
+{
+    if (++p->depth > PARSER_MAX_DEPTH)
+    {
+        error_at(p, &p->current, ERR_SYNTAX, "Expression is nested too deeply.");
+        p->depth--;
+        return NODE_NONE;
+    }
+
+    Node_Idx lhs = parse_prefix(p);
+    while (!p->panic)
+    {
+        skip_newlines_in_parens(p);
+        Token op = p->current;
+
+        if (op.kind == TOK_OPEN_PAREN)
+        {
+            if (OP_CALL_POWER < min_power) break;
+            lhs = parse_call(p, lhs);
+            continue;
+        }
+
+        uint8_t power = INFIX_POWER[op.kind];
+        if (power == 0 || power < min_power) break;
+
+        advance(p);
+        skip_newlines_in_parens(p);
+        uint8_t next_power = (INFIX_ASSOC[op.kind] == OP_ASSOC_RIGHT) ? power : power + 1;
+        Node_Idx rhs = parse_expression(p, next_power);
+        if (p->panic) break;
+
+        Span span = join_spans(AST_Get_Span(p->ast, lhs), AST_Get_Span(p->ast, rhs));
+        Operator operator = (Operator)TOKEN_OPERATOR[op.kind];
+        if (INFIX_ASSIGN[op.kind])
+        {
+            if (AST_Get_Kind(p->ast, lhs) != NODE_SYMBOL)
+            {
+                error_at(p, &op, ERR_SYNTAX, "Only a name can be assigned to.");
+                break;
+            }
+            lhs = checked(p, Make_Node_Assignment(p->ast, span, lhs, rhs, operator));
+        }
+        else
+        {
+            lhs = checked(p, Make_Node_Binary(p->ast, span, lhs, rhs, operator));
+        }
+    }
+
+    p->depth--;
+    return p->panic ? NODE_NONE : lhs;
+}
+
+//===============================================================================//
+// STATEMENTS
+//===============================================================================//
+
+/// @brief `let` declares an immutable variable, `var` and `mut` mutable ones.
+static Node_Idx parse_declaration(Parser *p)
+{
+    Token keyword = p->current;
+    advance(p);
+
+    Token name = p->current;
+    if (!match(p, TOK_SYMBOL_LITERAL))
+    {
+        error_at(p, &name, ERR_SYNTAX, "Expected a name after `%s`, found %s.",
+            TOKEN_SPELLINGS[keyword.kind], describe(p, &name));
+        return NODE_NONE;
+    }
+    Node_Idx symbol = parse_symbol(p, &name);
+
+    if (!match(p, TOK_EQUALS))
+    {
+        error_at(p, &p->current, ERR_SYNTAX, "Expected `=` after the name of `%.*s`, found %s.",
+            (int)name.span.len, p->lexer.src + name.span.pos, describe(p, &p->current));
+        return NODE_NONE;
+    }
+
+    Node_Idx initializer = parse_expression(p, 0);
+    if (p->panic) return NODE_NONE;
+
+    Span span = join_spans(keyword.span, AST_Get_Span(p->ast, initializer));
+    return checked(p, Make_Node_Variable(p->ast, span, symbol, initializer, keyword.kind != TOK_LET));
+}
+
+static Node_Idx parse_statement(Parser *p)
+{
+    switch (p->current.kind)
+    {
+        case TOK_LET:
+        case TOK_VAR:
+        case TOK_MUT:
+            return parse_declaration(p);
+        case TOK_POUND_BANG:
+        {
+            /* directives are not acted on yet */
+            while (!check(p, TOK_NEWLINE) && !check(p, TOK_EOF))
+                advance(p);
+            return NODE_NONE;
+        }
+        case TOK_FUNC:
+        case TOK_PROC:
+        case TOK_END:
+        case TOK_RETURN:
+        {
+            error_at(p, &p->current, ERR_SYNTAX, "`%s` is not supported yet.",
+                TOKEN_SPELLINGS[p->current.kind]);
+            return NODE_NONE;
+        }
+        default:
+            return parse_expression(p, 0);
+    }
+}
+
+//===============================================================================//
+// PARSER
+//===============================================================================//
+
+Parsed Parse(const char *src, size_t len, File_Id file, Arena *arena, Vec_Error *errors)
+{
+    Parsed result = (Parsed) {0};
+    if (!src || !arena || !errors) return result;
+
+    size_t errors_before = errors->count;
+    result.ast = AST_Init_In(arena, file);
+    Parser p = (Parser) {
+        .lexer = Lexer_Init(src, len, file, errors),
+        .ast = &result.ast,
+        .errs = errors,
+        .arena = arena,
+        .scratch = Vec_Node_Idx_New(INIT_PARSER_SCRATCH_CAPACITY),
+    };
+    if (AST_Count(&result.ast) == 0) p.failed = true;
+
+    advance(&p);
+    while (!check(&p, TOK_EOF))
+    {
+        if (match(&p, TOK_NEWLINE) || match(&p, TOK_SEMICOLON))
+            continue;
+
+        Node_Idx statement = parse_statement(&p);
+        if (!p.panic && statement != NODE_NONE)
+        {
+            if (!AST_Insert(&result.ast, statement))
+                p.failed = true;
+            if (!check(&p, TOK_NEWLINE) && !check(&p, TOK_SEMICOLON) && !check(&p, TOK_EOF))
+                error_at(&p, &p.current, ERR_SYNTAX, "Expected the end of the line, found %s.",
+                    describe(&p, &p.current));
+        }
+        if (p.panic) synchronize(&p);
+    }
+
+    Vec_Node_Idx_Free(&p.scratch);
+    Line_Index_Free(&p.lines);
+    result.valid = !p.failed && !p.lexer.lost_errors && errors->count == errors_before;
+    return result;
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+/// @brief Checks a node is a symbol with the given name.
+static bool is_symbol(const AST *ast, Node_Idx id, const char *name)
+{
+    return AST_Get_Kind(ast, id) == NODE_SYMBOL
+        && AST_Get_Symbol(ast, id) == Intern(name, strlen(name));
+}
+
+void Test_Parser(Test_Info *info)
+{
+    const char *src = "var i = 0\n"
+                      "i = i + 1\n"
+                      "print(i)\n"
+                      "\n"
+                      "let x = -1 + 2 * (3 - 4) % 5\n"
+                      "a = b = 2.5; print(\n"
+                      "    x,\n"
+                      "    a\n"
+                      "        + 1,\n"
+                      ")\n";
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+    AST *ast = &parsed.ast;
+    Node_Print(ast, NODE_NONE, 0);
+
+    bool ok = parsed.valid && errors.count == 0 && ast->items.count == 6;
+    if (!Assert(ok, info, "standard 1 did not parse into six statements"))
+    {
+        Arena_Free(&arena);
+        return;
+    }
+    Node_Idx *items = ast->items.data;
+
+    /* var i = 0 */
+    Node_Variable var = AST_Get_Variable(ast, items[0]);
+    ok = AST_Get_Kind(ast, items[0]) == NODE_VARIABLE && var.mutability
+      && is_symbol(ast, var.symbol, "i") && AST_Get_Integer(ast, var.initializer) == 0;
+
+    /* i = i + 1 */
+    Node_Assignment assign = AST_Get_Assignment(ast, items[1]);
+    Node_Binary add = AST_Get_Binary(ast, assign.val);
+    ok = ok && AST_Get_Kind(ast, items[1]) == NODE_ASSIGNMENT && assign.op == OP_ASSIGN
+            && is_symbol(ast, assign.sym, "i") && add.op == OP_ADD
+            && is_symbol(ast, add.lhs, "i") && AST_Get_Integer(ast, add.rhs) == 1;
+
+    /* print(i) */
+    Node_Call call = AST_Get_Call(ast, items[2]);
+    Node_List args = AST_Get_List(ast, call.args);
+    ok = ok && AST_Get_Kind(ast, items[2]) == NODE_CALL && is_symbol(ast, call.sym, "print")
+            && args.count == 1 && is_symbol(ast, args.nodes[0], "i");
+
+    /* (-1) + ((2 * (3 - 4)) % 5) */
+    Node_Variable let = AST_Get_Variable(ast, items[3]);
+    Node_Binary sum = AST_Get_Binary(ast, let.initializer);
+    Node_Unary neg = AST_Get_Unary(ast, sum.lhs);
+    Node_Binary mod = AST_Get_Binary(ast, sum.rhs);
+    Node_Binary mul = AST_Get_Binary(ast, mod.lhs);
+    ok = ok && !let.mutability && sum.op == OP_ADD
+            && AST_Get_Kind(ast, sum.lhs) == NODE_UNARY && neg.op == OP_SUB
+            && AST_Get_Integer(ast, neg.operand) == 1
+            && mod.op == OP_MOD && mul.op == OP_MUL
+            && AST_Get_Kind(ast, mul.rhs) == NODE_GROUPING
+            && AST_Get_Binary(ast, AST_Get_Inner(ast, mul.rhs)).op == OP_SUB;
+
+    /* assignment groups to the right, calls may span lines */
+    Node_Assignment outer = AST_Get_Assignment(ast, items[4]);
+    Node_Call multi = AST_Get_Call(ast, items[5]);
+    ok = ok && is_symbol(ast, outer.sym, "a")
+            && AST_Get_Kind(ast, outer.val) == NODE_ASSIGNMENT
+            && AST_Get_Float(ast, AST_Get_Assignment(ast, outer.val).val) == 2.5
+            && AST_Get_List(ast, multi.args).count == 2;
+
+    Span span = AST_Get_Span(ast, items[1]);
+    ok = ok && span.pos == 10 && span.len == 9;
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "parsed tree did not have the expected shape"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Parser_Recovery(Test_Info *info)
+{
+    const char *src = "let = 5\n"
+                      "var y = 2 +\n"
+                      "let z = (1 +)\n"
+                      "var w = 3\n"
+                      "x + 1 = 2\n"
+                      "let a = $ + 1\n"
+                      "print(w) w\n"
+                      "print(w)\n";
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+
+    Source_Manager sources = Source_Manager_New();
+    File_Id file;
+    Source_Add_Buffer(&sources, "<recovery>", src, strlen(src), &file);
+    Report_Errors(&errors, &sources);
+    Source_Manager_Free(&sources);
+
+    /* one error a line, and the good lines still make it into the tree */
+    size_t lines[] = {1, 2, 3, 5, 6, 7};
+    Line_Index index = Line_Index_Build(src, strlen(src));
+    bool ok = !parsed.valid && errors.count == 6 && parsed.ast.items.count == 3;
+    for (size_t i = 0; ok && i < errors.count; i++)
+    {
+        size_t x = 0, y = 0;
+        Line_Index_Locate(&index, errors.data[i].span.pos, &x, &y);
+        ok = y == lines[i];
+    }
+    Line_Index_Free(&index);
+
+    /* lines named in messages count the ones inside comments */
+    const char *commented = "##\ncomment\n###\nvar x = (1 +\n 2\nx = 1\n";
+    size_t before = errors.count;
+    Parse(commented, strlen(commented), 0, &arena, &errors);
+    ok = ok && errors.count == before + 1
+            && strstr(errors.data[before].message, "on line 4") != NULL
+            && errors.data[before].span.pos == strlen("##\ncomment\n###\nvar x = (1 +\n 2\n");
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "parser did not recover at the end of each line"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,410 @@
+#include "frontend/resolve.h"
+#include "frontend/ast.h"
+#include "frontend/parser.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/errors.h"
+#include "util/intern.h"
+#include "util/tests.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//===============================================================================//
+// SCOPES
+//===============================================================================//
+
+/* ids are handed out in order, so a multiplicative hash spreads them well enough */
+static uint32_t hash_id(Intern_Id id)
+{
+    return id * 2654435761u;
+}
+
+static Binding *find_slot(const Scope *scope, Intern_Id name)
+{
+    uint32_t mask = scope->capacity - 1;
+    uint32_t i = hash_id(name) & mask;
+    while (scope->table[i].name != INTERN_NONE && scope->table[i].name != name)
+        i = (i + 1) & mask;
+    return &scope->table[i];
+}
+
+static bool scope_init(Arena *arena, Scope *scope, uint32_t capacity)
+{
+    Binding *table = Arena_Alloc(arena, capacity * sizeof(Binding));
+    if (!table) return false;
+
+    memset(table, 0, capacity * sizeof(Binding));
+    *scope = (Scope) {.table = table, .capacity = capacity};
+    return true;
+}
+
+/* the old table is left in the arena, scopes only ever grow */
+static bool scope_grow(Arena *arena, Scope *scope)
+{
+    if (scope->capacity > UINT32_MAX / 2) return false;
+
+    Scope grown;
+    if (!scope_init(arena, &grown, scope->capacity * 2)) return false;
+    for (uint32_t i = 0; i < scope->capacity; i++)
+        if (scope->table[i].name != INTERN_NONE)
+            *find_slot(&grown, scope->table[i].name) = scope->table[i];
+
+    grown.count = scope->count;
+    *scope = grown;
+    return true;
+}
+
+Scope_Chain Scope_Chain_New(Arena *arena)
+{
+    return (Scope_Chain) {
+        .scopes = Vec_Scope_New_In(arena, INIT_SCOPE_CHAIN_CAPACITY),
+        .arena = arena,
+    };
+}
+
+bool Scope_Push(Scope_Chain *self)
+{
+    Scope scope;
+    return scope_init(self->arena, &scope, INIT_SCOPE_CAPACITY)
+        && Vec_Scope_Push(&self->scopes, scope);
+}
+
+void Scope_Pop(Scope_Chain *self)
+{
+    Vec_Scope_Pop(&self->scopes, NULL);
+}
+
+bool Scope_Declare(Scope_Chain *self, Binding binding)
+{
+    if (self->scopes.count == 0 || binding.name == INTERN_NONE) return false;
+    Scope *scope = &self->scopes.data[self->scopes.count - 1];
+
+    /* keep the table at most half full so probes stay short */
+    if ((scope->count + 1) * 2 > scope->capacity && !scope_grow(self->arena, scope))
+        return false;
+
+    Binding *slot = find_slot(scope, binding.name);
+    if (slot->name == INTERN_NONE) scope->count++;
+    *slot = binding;
+    return true;
+}
+
+Binding *Scope_Find_Local(Scope_Chain *self, Intern_Id name)
+{
+    if (self->scopes.count == 0) return NULL;
+    Binding *slot = find_slot(&self->scopes.data[self->scopes.count - 1], name);
+    return (slot->name == name) ? slot : NULL;
+}
+
+Binding *Scope_Lookup(Scope_Chain *self, Intern_Id name)
+{
+    for (size_t i = self->scopes.count; i > 0; i--)
+    {
+        Binding *slot = find_slot(&self->scopes.data[i - 1], name);
+        if (slot->name == name) return slot;
+    }
+    return NULL;
+}
+
+//===============================================================================//
+// RESOLVER STATE
+//===============================================================================//
+
+/// @brief State of one resolver pass. `bound` marks the symbols their parent has
+/// already dealt with: declared names, assignment targets and callees, so the walk
+/// does not look them up again as plain uses.
+typedef struct _resolver
+{
+    AST *ast;
+    Arena *arena;
+    Vec_Error *errs;
+    Scope_Chain chain;
+    uint32_t *slots;
+    uint8_t *bound;
+    uint32_t local_count;
+    Intern_Id discard;
+    Intern_Id builtins[BUILTIN_COUNT];
+    bool failed;
+} resolver;
+
+static void resolve_error(resolver *r, Node_Idx id, Error_Type type, const char *fmt, ...)
+{
+    r->failed = true;
+    Error e = (Error) {
+        .type = type,
+        .span = AST_Get_Span(r->ast, id),
+    };
+
+    va_list args;
+    va_start(args, fmt);
+    e.message = Error_VFormat(r->arena, &e.msg_len, fmt, args);
+    va_end(args);
+
+    Vec_Error_Push(r->errs, e);
+}
+
+/// @brief Returns a symbol's name for a message, `*len` gets its length.
+static const char *name_of(const AST *ast, Node_Idx id, int *len)
+{
+    size_t n = 0;
+    const char *name = Intern_Lookup(AST_Get_Symbol(ast, id), &n);
+    *len = (int)n;
+    return name ? name : "";
+}
+
+//===============================================================================//
+// RESOLUTION
+//===============================================================================//
+
+/// @brief Resolves a symbol that refers to a local.
+/// @return the binding, `NULL` after reporting why there is none.
+static Binding *resolve_use(resolver *r, Node_Idx id)
+{
+    Intern_Id name = AST_Get_Symbol(r->ast, id);
+    int len;
+    const char *str = name_of(r->ast, id, &len);
+
+    if (name == r->discard)
+    {
+        resolve_error(r, id, ERR_UNDECLARED_NAME, "`%s` discards a value, it cannot be used.", DISCARD_NAME);
+        return NULL;
+    }
+
+    Binding *binding = Scope_Lookup(&r->chain, name);
+    if (!binding)
+    {
+        resolve_error(r, id, ERR_UNDECLARED_NAME, "`%.*s` is not declared.", len, str);
+        return NULL;
+    }
+
+    r->slots[id] = binding->slot;
+    return binding;
+}
+
+static void resolve_callee(resolver *r, Node_Idx call, Node_Idx callee)
+{
+    r->bound[callee] = true;
+    Intern_Id name = AST_Get_Symbol(r->ast, callee);
+    for (uint32_t i = 0; i < BUILTIN_COUNT; i++)
+    {
+        if (r->builtins[i] != name) continue;
+        r->slots[call] = i;
+        return;
+    }
+
+    int len;
+    const char *str = name_of(r->ast, callee, &len);
+    resolve_error(r, callee, ERR_UNDECLARED_NAME, "`%.*s` is not a known function.", len, str);
+}
+
+static void resolve_target(resolver *r, Node_Idx assign, Node_Idx target)
+{
+    r->bound[target] = true;
+    Binding *binding = resolve_use(r, target);
+    if (!binding) return;
+
+    r->slots[assign] = binding->slot;
+    if (!binding->mutability)
+    {
+        int len;
+        const char *str = name_of(r->ast, target, &len);
+        resolve_error(r, target, ERR_IMMUTABLE,
+            "`%.*s` is declared with `let` and cannot be assigned to, declare it with `var` instead.",
+            len, str);
+    }
+}
+
+/// @brief Binds a declared name, once its initializer has been resolved so that
+/// the initializer cannot see the name it is initializing.
+static void declare(resolver *r, Node_Idx id)
+{
+    Node_Variable var = AST_Get_Variable(r->ast, id);
+    Intern_Id name = AST_Get_Symbol(r->ast, var.symbol);
+    if (name == r->discard) return;
+
+    if (Scope_Find_Local(&r->chain, name))
+    {
+        int len;
+        const char *str = name_of(r->ast, var.symbol, &len);
+        resolve_error(r, var.symbol, ERR_DUPLICATE_NAME, "`%.*s` is already declared in this scope.", len, str);
+        return;
+    }
+
+    Binding binding = (Binding) {
+        .name = name,
+        .slot = r->local_count,
+        .decl = id,
+        .mutability = var.mutability,
+    };
+    if (!Scope_Declare(&r->chain, binding))
+    {
+        r->failed = true;
+        return;
+    }
+
+    r->slots[id] = r->slots[var.symbol] = r->local_count++;
+}
+
+static Walk_Action enter_node(AST *ast, Node_Idx id, uint32_t depth, void *ctx)
+{
+    (void)depth;
+    resolver *r = ctx;
+
+    switch (AST_Get_Kind(ast, id))
+    {
+    case NODE_VARIABLE:
+        r->bound[AST_Get_Variable(ast, id).symbol] = true;
+        break;
+    case NODE_ASSIGNMENT:
+        resolve_target(r, id, AST_Get_Assignment(ast, id).sym);
+        break;
+    case NODE_CALL:
+        resolve_callee(r, id, AST_Get_Call(ast, id).sym);
+        break;
+    case NODE_SYMBOL:
+        if (!r->bound[id]) resolve_use(r, id);
+        break;
+    default: break;
+    }
+    return WALK_CONTINUE;
+}
+
+static Walk_Action leave_node(AST *ast, Node_Idx id, uint32_t depth, void *ctx)
+{
+    (void)depth;
+    if (AST_Get_Kind(ast, id) == NODE_VARIABLE) declare(ctx, id);
+    return WALK_CONTINUE;
+}
+
+Resolved Resolve(AST *ast, Arena *arena, Vec_Error *errors)
+{
+    size_t count = AST_Count(ast);
+    resolver r = (resolver) {
+        .ast = ast,
+        .arena = arena,
+        .errs = errors,
+        .chain = Scope_Chain_New(arena),
+        .slots = Arena_Alloc(arena, count * sizeof(uint32_t)),
+        .bound = calloc(count, 1),
+        .discard = Intern(DISCARD_NAME, strlen(DISCARD_NAME)),
+    };
+    if (!r.slots || !r.bound || !Scope_Push(&r.chain))
+    {
+        free(r.bound);
+        return (Resolved) {0};
+    }
+
+    memset(r.slots, 0xFF, count * sizeof(uint32_t)); /* SLOT_NONE */
+    #define X(name, str) r.builtins[name] = Intern(str, strlen(str));
+    BUILTIN_LIST
+    #undef X
+
+    /* there are no blocks or functions yet, so a file is a single scope */
+    AST_Visitor visitor = (AST_Visitor) {.pre = enter_node, .post = leave_node, .ctx = &r};
+    bool walked = AST_Walk(ast, NODE_NONE, &visitor);
+
+    free(r.bound);
+    return (Resolved) {
+        .slots = r.slots,
+        .local_count = r.local_count,
+        .valid = walked && !r.failed,
+    };
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Scope_Chain(Test_Info *info)
+{
+    Arena arena = Arena_New(0);
+    Scope_Chain chain = Scope_Chain_New(&arena);
+    bool ok = Scope_Push(&chain);
+
+    /* enough names to make the table grow a few times */
+    Intern_Id names[600];
+    char buffer[16];
+    for (uint32_t i = 0; ok && i < 600; i++)
+    {
+        int len = snprintf(buffer, sizeof(buffer), "local%u", (unsigned)i);
+        names[i] = Intern(buffer, (size_t)len);
+        ok = Scope_Declare(&chain, (Binding) {.name = names[i], .slot = i});
+    }
+    for (uint32_t i = 0; ok && i < 600; i++)
+    {
+        Binding *b = Scope_Lookup(&chain, names[i]);
+        ok = b && b->slot == i;
+    }
+
+    /* an inner scope shadows, and the outer binding comes back once it is gone */
+    ok = ok && Scope_Push(&chain)
+            && Scope_Declare(&chain, (Binding) {.name = names[5], .slot = 1000})
+            && Scope_Lookup(&chain, names[5])->slot == 1000
+            && Scope_Lookup(&chain, names[6])->slot == 6
+            && Scope_Find_Local(&chain, names[6]) == NULL;
+    Scope_Pop(&chain);
+    ok = ok && Scope_Lookup(&chain, names[5])->slot == 5
+            && Scope_Lookup(&chain, Intern("missing", 7)) == NULL;
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "scope chain did not bind names as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
+
+void Test_Resolver(Test_Info *info)
+{
+    const char *src = "var i = 0\n"
+                      "let _ = i + 10\n"
+                      "let _ = 5\n"
+                      "i = i + 1\n"
+                      "print(i)\n"
+                      "let k = k\n"
+                      "k = 3\n"
+                      "let i = 4\n"
+                      "foo(_)\n";
+
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, &arena, &errors);
+    if (!Assert(parsed.valid, info, "resolver test source did not parse"))
+    {
+        Arena_Free(&arena);
+        return;
+    }
+
+    AST *ast = &parsed.ast;
+    Resolved resolved = Resolve(ast, &arena, &errors);
+    Node_Idx *items = ast->items.data;
+
+    /* i = i + 1 */
+    Node_Assignment assign = AST_Get_Assignment(ast, items[3]);
+    Node_Binary add = AST_Get_Binary(ast, assign.val);
+    bool ok = !resolved.valid && resolved.local_count == 2
+           && resolved.slots[items[0]] == 0
+           && resolved.slots[items[3]] == 0 && resolved.slots[add.lhs] == 0
+           && resolved.slots[items[4]] == BUILTIN_PRINT
+           && resolved.slots[items[5]] == 1;
+
+    /* `k` in its own initializer, assigning to `k`, declaring `i` twice, `foo` and `_` */
+    Error_Type expected[] = {
+        ERR_UNDECLARED_NAME, ERR_IMMUTABLE, ERR_DUPLICATE_NAME, ERR_UNDECLARED_NAME, ERR_UNDECLARED_NAME,
+    };
+    ok = ok && errors.count == 5;
+    for (size_t i = 0; ok && i < errors.count; i++)
+        ok = errors.data[i].type == expected[i];
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "names did not resolve to the expected slots"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
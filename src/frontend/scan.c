@@ -0,0 +1,331 @@
+#include "frontend/scan.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define SCAN_X86 0
+#endif
+
+//===============================================================================//
+// SCALAR CLASSES
+//===============================================================================//
+
+// These have to agree byte-for-byte with the vector classes below, the lexer
+// relies on every level producing the exact same token stream.
+
+static inline bool scalar_space(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool scalar_digit(unsigned char c)
+{
+    return (c >= '0' && c <= '9') || c == '_';
+}
+
+static inline bool scalar_symbol(unsigned char c)
+{
+    unsigned char lower = c | 0x20;
+    return scalar_digit(c) || (lower >= 'a' && lower <= 'z');
+}
+
+static inline bool scalar_not_newline(unsigned char c)
+{
+    return c != '\n';
+}
+
+static inline bool scalar_not_pound(unsigned char c)
+{
+    return c != '#';
+}
+
+//===============================================================================//
+// VECTOR CLASSES
+//===============================================================================//
+
+#if SCAN_X86
+
+/* signed compares are fine here, every byte >= 0x80 is negative and so falls */
+/* outside of the (all ASCII) ranges being tested for. */
+
+SSE2_TARGET static inline __m128i sse2_range(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(
+        _mm_cmpgt_epi8(v, _mm_set1_epi8((char)(lo - 1))),
+        _mm_cmplt_epi8(v, _mm_set1_epi8((char)(hi + 1))));
+}
+
+SSE2_TARGET static inline __m128i sse2_space(__m128i v)
+{
+    return _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+}
+
+SSE2_TARGET static inline __m128i sse2_digit(__m128i v)
+{
+    return _mm_or_si128(sse2_range(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+
+SSE2_TARGET static inline __m128i sse2_symbol(__m128i v)
+{
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_or_si128(sse2_digit(v), sse2_range(lower, 'a', 'z'));
+}
+
+SSE2_TARGET static inline __m128i sse2_not_newline(__m128i v)
+{
+    return _mm_xor_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_set1_epi8(-1));
+}
+
+SSE2_TARGET static inline __m128i sse2_not_pound(__m128i v)
+{
+    return _mm_xor_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('#')), _mm_set1_epi8(-1));
+}
+
+AVX2_TARGET static inline __m256i avx2_range(__m256i v, char lo, char hi)
+{
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)(lo - 1))),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(hi + 1)), v));
+}
+
+AVX2_TARGET static inline __m256i avx2_space(__m256i v)
+{
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+}
+
+AVX2_TARGET static inline __m256i avx2_digit(__m256i v)
+{
+    return _mm256_or_si256(avx2_range(v, '0', '9'), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+}
+
+AVX2_TARGET static inline __m256i avx2_symbol(__m256i v)
+{
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(avx2_digit(v), avx2_range(lower, 'a', 'z'));
+}
+
+AVX2_TARGET static inline __m256i avx2_not_newline(__m256i v)
+{
+    return _mm256_xor_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_set1_epi8(-1));
+}
+
+AVX2_TARGET static inline __m256i avx2_not_pound(__m256i v)
+{
+    return _mm256_xor_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('#')), _mm256_set1_epi8(-1));
+}
+
+#endif // SCAN_X86
+
+//===============================================================================//
+// SCANNER GENERATION
+//===============================================================================//
+
+/* Every scanner skips bytes while they are members of its class. The vector */
+/* versions test a whole block at once and finish the tail with the scalar one. */
+
+#define DEFINE_SCALAR_SCANNER(name) \
+    static size_t name##_scalar(const char *src, size_t pos, size_t len) \
+    { \
+        while (pos < len && scalar_##name((unsigned char)src[pos])) \
+            pos++; \
+        return pos; \
+    }
+
+#if SCAN_X86
+
+#define DEFINE_SCANNER(name) \
+    DEFINE_SCALAR_SCANNER(name) \
+    SSE2_TARGET static size_t name##_sse2(const char *src, size_t pos, size_t len) \
+    { \
+        while (pos + 16 <= len) \
+        { \
+            __m128i block = _mm_loadu_si128((const __m128i *)(src + pos)); \
+            uint32_t stop = ~(uint32_t)_mm_movemask_epi8(sse2_##name(block)) & 0xFFFFu; \
+            if (stop) return pos + (size_t)__builtin_ctz(stop); \
+            pos += 16; \
+        } \
+        return name##_scalar(src, pos, len); \
+    } \
+    AVX2_TARGET static size_t name##_avx2(const char *src, size_t pos, size_t len) \
+    { \
+        while (pos + 32 <= len) \
+        { \
+            __m256i block = _mm256_loadu_si256((const __m256i *)(src + pos)); \
+            uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(avx2_##name(block)); \
+            if (stop) return pos + (size_t)__builtin_ctz(stop); \
+            pos += 32; \
+        } \
+        return name##_sse2(src, pos, len); \
+    }
+
+#else
+
+#define DEFINE_SCANNER(name) DEFINE_SCALAR_SCANNER(name)
+
+#endif // SCAN_X86
+
+DEFINE_SCANNER(space)
+DEFINE_SCANNER(symbol)
+DEFINE_SCANNER(digit)
+DEFINE_SCANNER(not_newline)
+DEFINE_SCANNER(not_pound)
+
+//===============================================================================//
+// DISPATCH
+//===============================================================================//
+
+typedef size_t (*scan_fn)(const char *src, size_t pos, size_t len);
+
+typedef struct _scanner_table
+{
+    scan_fn space;
+    scan_fn symbol;
+    scan_fn digit;
+    scan_fn not_newline;
+    scan_fn not_pound;
+} scanner_table;
+
+#define SCANNER_TABLE(suffix) (scanner_table) { \
+    space_##suffix, symbol_##suffix, digit_##suffix, not_newline_##suffix, not_pound_##suffix }
+
+static scanner_table scanners;
+static Scan_Level scanners_level;
+static bool scanners_ready = false;
+
+Scan_Level Scan_Best_Level(void)
+{
+#if SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SCAN_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SCAN_SSE2;
+#endif
+    return SCAN_SCALAR;
+}
+
+void Scan_Set_Level(Scan_Level level)
+{
+    Scan_Level best = Scan_Best_Level();
+    if (level > best) level = best;
+
+    switch (level)
+    {
+#if SCAN_X86
+        case SCAN_AVX2: scanners = SCANNER_TABLE(avx2); break;
+        case SCAN_SSE2: scanners = SCANNER_TABLE(sse2); break;
+#endif
+        default:
+        {
+            level = SCAN_SCALAR;
+            scanners = SCANNER_TABLE(scalar);
+            break;
+        }
+    }
+
+    scanners_level = level;
+    scanners_ready = true;
+}
+
+Scan_Level Scan_Get_Level(void)
+{
+    if (!scanners_ready) Scan_Set_Level(Scan_Best_Level());
+    return scanners_level;
+}
+
+size_t Scan_Whitespace(const char *src, size_t pos, size_t len)
+{
+    if (!scanners_ready) Scan_Set_Level(Scan_Best_Level());
+    return scanners.space(src, pos, len);
+}
+
+size_t Scan_Symbol(const char *src, size_t pos, size_t len)
+{
+    if (!scanners_ready) Scan_Set_Level(Scan_Best_Level());
+    return scanners.symbol(src, pos, len);
+}
+
+size_t Scan_Digits(const char *src, size_t pos, size_t len)
+{
+    if (!scanners_ready) Scan_Set_Level(Scan_Best_Level());
+    return scanners.digit(src, pos, len);
+}
+
+size_t Scan_Line(const char *src, size_t pos, size_t len)
+{
+    if (!scanners_ready) Scan_Set_Level(Scan_Best_Level());
+    return scanners.not_newline(src, pos, len);
+}
+
+size_t Scan_Pound(const char *src, size_t pos, size_t len)
+{
+    if (!scanners_ready) Scan_Set_Level(Scan_Best_Level());
+    return scanners.not_pound(src, pos, len);
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Scan(Test_Info *info)
+{
+    static const char alphabet[] = " \t\r\n#_09azAZ@[`{+.\"\x80\xff";
+    static const char *level_names[] = {"scalar", "sse2", "avx2"};
+
+    Scan_Level restore = Scan_Get_Level();
+    Scan_Level best = Scan_Best_Level();
+    printf("> best scan level: %s\n", level_names[best]);
+
+    char buffer[200];
+    uint32_t seed = 0x5D0DA;
+
+    for (int round = 0; round < 64; round++)
+    {
+        /* long runs of a single class are what the vector paths actually skip, */
+        /* so fill the buffer in runs rather than byte by byte */
+        size_t len = 0;
+        while (len < sizeof(buffer))
+        {
+            seed = seed * 1103515245u + 12345u;
+            char c = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+            size_t run = ((seed >> 8) % 40) + 1;
+            for (size_t i = 0; i < run && len < sizeof(buffer); i++)
+                buffer[len++] = c;
+        }
+
+        for (Scan_Level level = SCAN_SCALAR; level <= best; level++)
+        {
+            Scan_Set_Level(level);
+            for (size_t pos = 0; pos <= len; pos++)
+            {
+                bool ok = Scan_Whitespace(buffer, pos, len) == space_scalar(buffer, pos, len)
+                       && Scan_Symbol(buffer, pos, len) == symbol_scalar(buffer, pos, len)
+                       && Scan_Digits(buffer, pos, len) == digit_scalar(buffer, pos, len)
+                       && Scan_Line(buffer, pos, len) == not_newline_scalar(buffer, pos, len)
+                       && Scan_Pound(buffer, pos, len) == not_pound_scalar(buffer, pos, len);
+                if (!Assert(ok, info, "vector scanner disagreed with the scalar scanner"))
+                {
+                    printf("> mismatch at level %s, pos %zu\n", level_names[level], pos);
+                    Scan_Set_Level(restore);
+                    return;
+                }
+            }
+        }
+    }
+
+    Scan_Set_Level(restore);
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,314 @@
+#include "frontend/types.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------------//
+// table
+//-------------------------------------------------------------------------------//
+
+/// @brief One type. For a function `a` is its return type and its parameters are
+/// `count` entries of `params` from `start`, for an array `a` is the element type.
+typedef struct _type_entry
+{
+    uint8_t kind;
+    Type_Id a;
+    uint32_t start;
+    uint32_t count;
+    uint32_t hash;
+} type_entry;
+
+VEC_DEFINE(Vec_Type_Entry, type_entry)
+VEC_DEFINE(Vec_Type_Id, Type_Id)
+
+/// @brief `entries` is indexed by id, `slots` is the open-addressed hash table of
+/// ids with 0 (`TYPE_NONE`, never hashed) marking an empty slot.
+typedef struct _type_table
+{
+    Vec_Type_Entry entries;
+    Vec_Type_Id params;
+    Type_Id *slots;
+    size_t slot_count;
+} type_table;
+
+static type_table table = {0};
+
+static const char *PRIMITIVE_NAMES[] = {
+    [TYPE_KIND_NONE] = "<error>",
+    [TYPE_KIND_VOID] = "void",
+    [TYPE_KIND_INT] = "int",
+    [TYPE_KIND_FLOAT] = "float",
+    [TYPE_KIND_BOOL] = "bool",
+};
+
+/// @brief Puts the primitives in at their fixed ids the first time the table is used.
+static bool ensure_table(void)
+{
+    if (table.entries.count != 0) return true;
+    if (!Vec_Type_Entry_Reserve(&table.entries, INIT_TYPE_CAPACITY)) return false;
+
+    for (uint8_t kind = TYPE_KIND_NONE; kind <= TYPE_KIND_BOOL; kind++)
+        Vec_Type_Entry_Push(&table.entries, (type_entry) {.kind = kind});
+    return true;
+}
+
+static uint32_t hash_words(uint32_t hash, uint32_t word)
+{
+    /* FNV-1a a word at a time, it is only ever fed small ids */
+    return (hash ^ word) * 16777619u;
+}
+
+static uint32_t hash_type(uint8_t kind, Type_Id a, const Type_Id *params, uint32_t count)
+{
+    uint32_t hash = hash_words(hash_words(2166136261u, kind), a);
+    hash = hash_words(hash, count);
+    for (uint32_t i = 0; i < count; i++)
+        hash = hash_words(hash, params[i]);
+    return hash;
+}
+
+static bool same_type(const type_entry *entry, uint32_t hash, uint8_t kind, Type_Id a,
+                      const Type_Id *params, uint32_t count)
+{
+    return entry->hash == hash && entry->kind == kind && entry->a == a && entry->count == count
+        && (count == 0 || memcmp(table.params.data + entry->start, params, count * sizeof(Type_Id)) == 0);
+}
+
+static bool grow_slots(void)
+{
+    size_t new_count = (table.slot_count != 0)
+                     ? (table.slot_count * VEC_GROWTH_FACTOR)
+                     : INIT_TYPE_CAPACITY * 2;
+    Type_Id *new_slots = calloc(new_count, sizeof(Type_Id));
+    if (!new_slots) return false;
+
+    /* only built types are hashed, the primitives are never looked up */
+    for (size_t id = TYPE_BOOL + 1; id < table.entries.count; id++)
+    {
+        size_t slot = table.entries.data[id].hash & (new_count - 1);
+        while (new_slots[slot] != TYPE_NONE)
+            slot = (slot + 1) & (new_count - 1);
+        new_slots[slot] = (Type_Id)id;
+    }
+
+    free(table.slots);
+    table.slots = new_slots;
+    table.slot_count = new_count;
+    return true;
+}
+
+/// @brief Finds a built type, adding it the first time it is asked for.
+static Type_Id intern_type(uint8_t kind, Type_Id a, const Type_Id *params, uint32_t count)
+{
+    if (!ensure_table()) return TYPE_NONE;
+    if ((table.entries.count + 1) * 2 > table.slot_count && !grow_slots())
+        return TYPE_NONE;
+
+    uint32_t hash = hash_type(kind, a, params, count);
+    size_t mask = table.slot_count - 1;
+    size_t slot = hash & mask;
+    for (;;)
+    {
+        Type_Id id = table.slots[slot];
+        if (id == TYPE_NONE) break;
+        if (same_type(&table.entries.data[id], hash, kind, a, params, count))
+            return id;
+        slot = (slot + 1) & mask;
+    }
+
+    type_entry entry = (type_entry) {
+        .kind = kind,
+        .a = a,
+        .start = (uint32_t)table.params.count,
+        .count = count,
+        .hash = hash,
+    };
+    if (!Vec_Type_Id_Extend(&table.params, params, count)) return TYPE_NONE;
+    if (!Vec_Type_Entry_Push(&table.entries, entry))
+    {
+        Vec_Type_Id_Truncate(&table.params, entry.start);
+        return TYPE_NONE;
+    }
+
+    Type_Id id = (Type_Id)(table.entries.count - 1);
+    table.slots[slot] = id;
+    return id;
+}
+
+static const type_entry *get_entry(Type_Id id)
+{
+    ensure_table();
+    return Vec_Type_Entry_Get(&table.entries, id);
+}
+
+//-------------------------------------------------------------------------------//
+// types
+//-------------------------------------------------------------------------------//
+
+Type_Id Type_Function(Type_Id ret, const Type_Id *params, uint32_t count)
+{
+    return intern_type(TYPE_KIND_FUNCTION, ret, params, count);
+}
+
+Type_Id Type_Array(Type_Id element)
+{
+    return intern_type(TYPE_KIND_ARRAY, element, NULL, 0);
+}
+
+Type_Kind Type_Get_Kind(Type_Id id)
+{
+    const type_entry *entry = get_entry(id);
+    return entry ? (Type_Kind)entry->kind : TYPE_KIND_NONE;
+}
+
+Type_Id Type_Element(Type_Id id)
+{
+    const type_entry *entry = get_entry(id);
+    return (entry && entry->kind == TYPE_KIND_ARRAY) ? entry->a : TYPE_NONE;
+}
+
+Type_Id Type_Return(Type_Id id)
+{
+    const type_entry *entry = get_entry(id);
+    return (entry && entry->kind == TYPE_KIND_FUNCTION) ? entry->a : TYPE_NONE;
+}
+
+const Type_Id *Type_Params(Type_Id id, uint32_t *count)
+{
+    const type_entry *entry = get_entry(id);
+    if (!entry || entry->kind != TYPE_KIND_FUNCTION)
+    {
+        *count = 0;
+        return NULL;
+    }
+    *count = entry->count;
+    return table.params.data + entry->start;
+}
+
+bool Type_Is_Numeric(Type_Id id)
+{
+    return id == TYPE_INT || id == TYPE_FLOAT;
+}
+
+/// @brief Appends a type's name to a buffer that grows in the arena.
+static bool append(Arena *arena, char **buf, size_t *len, size_t *cap, const char *str)
+{
+    size_t n = strlen(str);
+    if (*len + n + 1 > *cap)
+    {
+        size_t new_cap = (*cap + n + 1) * VEC_GROWTH_FACTOR;
+        char *grown = Arena_Grow(arena, *buf, *cap, new_cap);
+        if (!grown) return false;
+        *buf = grown;
+        *cap = new_cap;
+    }
+    memcpy(*buf + *len, str, n + 1);
+    *len += n;
+    return true;
+}
+
+static bool append_type(Arena *arena, char **buf, size_t *len, size_t *cap, Type_Id id)
+{
+    const type_entry *entry = get_entry(id);
+    if (!entry) return append(arena, buf, len, cap, "<unknown>");
+
+    switch ((Type_Kind)entry->kind)
+    {
+    case TYPE_KIND_ARRAY:
+        return append(arena, buf, len, cap, "[")
+            && append_type(arena, buf, len, cap, entry->a)
+            && append(arena, buf, len, cap, "]");
+    case TYPE_KIND_FUNCTION:
+    {
+        /* the entry may move as the nested names are built, so copy what is needed */
+        Type_Id ret = entry->a;
+        uint32_t start = entry->start, count = entry->count;
+        bool ok = append(arena, buf, len, cap, "fn(");
+        for (uint32_t i = 0; ok && i < count; i++)
+        {
+            ok = (i == 0 || append(arena, buf, len, cap, ", "))
+              && append_type(arena, buf, len, cap, table.params.data[start + i]);
+        }
+        return ok && append(arena, buf, len, cap, ") -> ")
+                  && append_type(arena, buf, len, cap, ret);
+    }
+    default:
+        return append(arena, buf, len, cap, PRIMITIVE_NAMES[entry->kind]);
+    }
+}
+
+const char *Type_Name(Arena *arena, Type_Id id)
+{
+    char *buf = NULL;
+    size_t len = 0, cap = 0;
+    if (!append_type(arena, &buf, &len, &cap, id)) return "?";
+    return buf;
+}
+
+size_t Type_Count(void)
+{
+    ensure_table();
+    return table.entries.count;
+}
+
+void Types_Free(void)
+{
+    Vec_Type_Entry_Free(&table.entries);
+    Vec_Type_Id_Free(&table.params);
+    free(table.slots);
+    table = (type_table) {0};
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Types(Test_Info *info)
+{
+    Arena arena = Arena_New(0);
+
+    /* the same structure always gives the same id */
+    Type_Id params[] = {TYPE_INT, TYPE_FLOAT};
+    Type_Id fn = Type_Function(TYPE_VOID, params, 2);
+    Type_Id matrix = Type_Array(Type_Array(TYPE_FLOAT));
+    bool ok = fn != TYPE_NONE && matrix != TYPE_NONE
+           && fn == Type_Function(TYPE_VOID, params, 2)
+           && matrix == Type_Array(Type_Array(TYPE_FLOAT))
+           && fn != Type_Function(TYPE_VOID, params, 1)
+           && Type_Array(TYPE_INT) != Type_Array(TYPE_FLOAT);
+
+    /* enough distinct types to make the table grow */
+    Type_Id nested = TYPE_INT;
+    for (int i = 0; ok && i < 200; i++)
+        ok = (nested = Type_Array(nested)) != TYPE_NONE;
+    size_t count = Type_Count();
+    Type_Id again = TYPE_INT;
+    for (int i = 0; ok && i < 200; i++)
+        again = Type_Array(again);
+    ok = ok && again == nested && Type_Count() == count;
+
+    uint32_t param_count;
+    const Type_Id *got = Type_Params(fn, &param_count);
+    ok = ok && Type_Get_Kind(fn) == TYPE_KIND_FUNCTION && Type_Return(fn) == TYPE_VOID
+            && param_count == 2 && got[0] == TYPE_INT && got[1] == TYPE_FLOAT
+            && Type_Element(matrix) == Type_Array(TYPE_FLOAT)
+            && Type_Is_Numeric(TYPE_INT) && !Type_Is_Numeric(TYPE_BOOL);
+
+    Type_Id higher_params[] = {fn, matrix};
+    const char *name = Type_Name(&arena, Type_Function(TYPE_INT, higher_params, 2));
+    printf("> %s\n", name);
+    ok = ok && strcmp(name, "fn(fn(int, float) -> void, [[float]]) -> int") == 0;
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "types were not interned as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -1,8 +1,27 @@
+#include "backend/bytecode.h"
+#include "backend/emit.h"
+#include "backend/image.h"
+#include "backend/peephole.h"
+#include "backend/regalloc.h"
+#include "frontend/ast.h"
+#include "frontend/ast_cache.h"
+#include "frontend/check.h"
+#include "frontend/fold.h"
 #include "frontend/lexer.h"
+#include "frontend/parser.h"
+#include "frontend/resolve.h"
+#include "frontend/scan.h"
+#include "frontend/types.h"
+#include "util/arena.h"
 #include "util/errors.h"
 #include "util/common.h"
+#include "util/source.h"
+#include "util/intern.h"
+#include "util/sections.h"
 #include "util/tests.h"
+#include "vm/vm.h"
 #include <stdio.h>
+#include <string.h>
 
 void tests()
 {
@@ -30,13 +49,412 @@ void tests()
             TEST_TYPE_MANUAL
         )
     );
+    Load_Test(env,
+        Create_Test(
+            Test_Scan,
+            "Scanners",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Lexer_Scan_Levels,
+            "Lexer Scan Levels",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Lexer_Operators,
+            "Lexer Operators",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Lexer_Keywords,
+            "Lexer Keywords",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Lexer_Stream,
+            "Lexer Stream",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Lexer_Lines,
+            "Lexer Lines",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Line_Index,
+            "Line Index",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Token_Store,
+            "Token Store",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Lexer_Numbers,
+            "Lexer Numbers",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Error_Collection,
+            "Error Collection",
+            TEST_TYPE_MANUAL
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Append_Data_Errors,
+            "Error Data",
+            TEST_TYPE_MANUAL
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Source_Manager,
+            "Source Manager",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Intern,
+            "String Interning",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Vec,
+            "Vec",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Arena,
+            "Arena",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Sections,
+            "Sections",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_AST,
+            "AST",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_AST_Walk,
+            "AST Walk",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Parser,
+            "Parser",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Parser_Recovery,
+            "Parser Recovery",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_AST_Cache,
+            "AST Cache",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Scope_Chain,
+            "Scope Chain",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Resolver,
+            "Resolver",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Types,
+            "Types",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Checker,
+            "Type Checker",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Fold,
+            "Constant Folding",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Bytecode,
+            "Bytecode",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Register_Allocator,
+            "Register Allocator",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Peephole,
+            "Peephole",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Emitter,
+            "Emitter",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_VM,
+            "VM",
+            TEST_TYPE_ASSERTION
+        )
+    );
+    Load_Test(env,
+        Create_Test(
+            Test_Image,
+            "Image",
+            TEST_TYPE_ASSERTION
+        )
+    );
 
     Run_Battery(env);
     Free_Test_Environment(env);
+    Types_Free();
+    Intern_Free();
+}
+
+/// @brief Gets the AST of a source, from its cache file when the source has not
+/// changed since the cache was written, otherwise by parsing it and refreshing the
+/// cache. A cache that cannot be written is not an error.
+/// @return `false` if the source did not parse.
+static bool load_ast(const Source_File *source, File_Id file, Arena *arena, Vec_Error *errors, AST *out)
+{
+    uint64_t hash = Hash_Source(source->src, source->len);
+    const char *cache = AST_Cache_Path(arena, source->path);
+    if (cache && AST_Cache_Read(cache, hash, arena, file, out))
+        return true;
+
+    Parsed parsed = Parse(source->src, source->len, file, arena, errors);
+    if (!parsed.valid) return false;
+
+    if (cache) AST_Cache_Write(&parsed.ast, cache, hash);
+    *out = parsed.ast;
+    return true;
+}
+
+/// @brief What to do with the files once they compile.
+typedef enum _Compile_Mode
+{
+    COMPILE_CHECK,
+    COMPILE_RUN,
+    COMPILE_DISASSEMBLE,
+    COMPILE_BUILD,
+} Compile_Mode;
+
+/// @brief One file named on the command line, ready to run. A source file is
+/// compiled and an image is loaded, either way `path` and `lines` are what runtime
+/// errors are reported against.
+typedef struct _Unit
+{
+    Function fn;
+    const char *path;
+    const Line_Index *lines;
+    Image image;
+    bool from_image;
+} Unit;
+
+/// @brief Takes one loaded source from its AST down to bytecode.
+/// @return `false` if anything was reported.
+static bool compile_file(Source_Manager *sources, File_Id file, Arena *arena, Vec_Error *errors, Function *out)
+{
+    AST ast;
+    if (!load_ast(Source_Get(sources, file), file, arena, errors, &ast))
+        return false;
+
+    Resolved resolved = Resolve(&ast, arena, errors);
+    if (!resolved.valid) return false;
+    Checked checked = Check_Types(&ast, &resolved, arena, errors);
+    if (!checked.valid) return false;
+
+    /* folding keeps the type of every node it rewrites, so the types still hold */
+    if (!Fold_Constants(&ast, arena, errors).valid)
+        return false;
+
+    Emitted emitted = Emit_Function(&ast, &resolved, &checked, arena, errors);
+    *out = emitted.fn;
+    return emitted.valid;
+}
+
+/// @brief Runs a compiled file, reporting where it stopped if it did not finish.
+/// @return `false` if the run failed.
+static bool run_unit(VM *vm, const Unit *unit)
+{
+    Run_Status status = VM_Run(vm, &unit->fn);
+    if (status == RUN_OK) return true;
+
+    size_t x = 0, y = 0;
+    if (vm->error_pc < unit->fn.positions.count)
+        Line_Index_Locate(unit->lines, unit->fn.positions.data[vm->error_pc], &x, &y);
+    fprintf(stderr, "sudu: runtime error at %s:%zu:%zu: %s\n",
+        unit->path, y, x, Run_Status_Message(status));
+    return false;
 }
 
-int main()
+/// @brief Gets one file named on the command line ready to run. An image is only
+/// mapped, a source file goes through the whole compiler.
+/// @return `false` if the file could not be read or did not compile.
+static bool load_unit(Source_Manager *sources, const char *path, Arena *arena, Vec_Error *errors, Unit *out)
 {
-    tests();
-    return 0;
-}
\ No newline at end of file
+    *out = (Unit) {.path = path};
+    if (Is_Image_Path(path))
+    {
+        if (!Image_Load(path, &out->image))
+        {
+            fprintf(stderr, "sudu: '%s' is not a valid image\n", path);
+            return false;
+        }
+        out->from_image = true;
+        out->fn = out->image.functions[0];
+        out->path = out->image.source_path;
+        out->lines = &out->image.lines;
+        return true;
+    }
+
+    File_Id file;
+    if (!Source_Load(sources, path, &file))
+    {
+        fprintf(stderr, "sudu: could not read '%s'\n", path);
+        return false;
+    }
+
+    out->lines = Source_Lines(sources, file);
+    return compile_file(sources, file, arena, errors, &out->fn);
+}
+
+/// @brief Saves a compiled source file as an image next to it.
+/// @return `false` if the image could not be written.
+static bool build_unit(const Unit *unit, Arena *arena)
+{
+    if (unit->from_image) return true;
+
+    const char *image = Image_Path(arena, unit->path);
+    if (image && Image_Write(image, &unit->fn, 1, unit->path, unit->lines))
+        return true;
+
+    fprintf(stderr, "sudu: could not write '%s'\n", image ? image : unit->path);
+    return false;
+}
+
+/// @brief Loads every file named on the command line, compiling the sources among
+/// them, then runs, disassembles or saves them in order if they all loaded.
+/// @return the process exit code.
+int compile(int count, char **paths, Compile_Mode mode)
+{
+    Source_Manager sources = Source_Manager_New();
+    Arena arena = Arena_New(0);
+    Vec_Error errors = Vec_Error_New_In(&arena, INIT_ERROR_CAPACITY);
+    Unit *units = Arena_Alloc(&arena, (size_t)count * sizeof(Unit) + 1);
+    int status = units ? 0 : 1;
+
+    for (int i = 0; units && i < count; i++)
+        if (!load_unit(&sources, paths[i], &arena, &errors, &units[i]))
+            status = 1;
+
+    if (errors.count > 0)
+    {
+        Report_Errors(&errors, &sources);
+        status = 1;
+    }
+
+    VM vm = VM_New(stdout);
+    for (int i = 0; status == 0 && mode != COMPILE_CHECK && i < count; i++)
+    {
+        if (mode == COMPILE_DISASSEMBLE)
+            Disassemble(&units[i].fn, units[i].lines, stdout);
+        else if (mode == COMPILE_BUILD && !build_unit(&units[i], &arena))
+            status = 1;
+        else if (mode == COMPILE_RUN && !run_unit(&vm, &units[i]))
+            status = 1;
+    }
+
+    for (int i = 0; units && i < count; i++)
+        if (units[i].from_image) Image_Free(&units[i].image);
+    VM_Free(&vm);
+    Arena_Free(&arena);
+    Source_Manager_Free(&sources);
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        tests();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "run") == 0)
+        return compile(argc - 2, argv + 2, COMPILE_RUN);
+    if (strcmp(argv[1], "dis") == 0)
+        return compile(argc - 2, argv + 2, COMPILE_DISASSEMBLE);
+    if (strcmp(argv[1], "build") == 0)
+        return compile(argc - 2, argv + 2, COMPILE_BUILD);
+    return compile(argc - 1, argv + 1, COMPILE_CHECK);
+}
@@ -0,0 +1,218 @@
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN (_Alignof(max_align_t))
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+//-------------------------------------------------------------------------------//
+// pages
+//-------------------------------------------------------------------------------//
+
+static Arena_Page *new_page(size_t size)
+{
+    Arena_Page *page = malloc(sizeof(Arena_Page) + size);
+    if (!page) return NULL;
+
+    page->next = NULL;
+    page->used = 0;
+    page->size = size;
+    return page;
+}
+
+/// @brief Moves the arena onto a page with room for `size` bytes, reusing the pages
+/// left over from a reset when they are big enough.
+static bool next_page(Arena *self, size_t size)
+{
+    Arena_Page *next = self->current ? self->current->next : self->first;
+    if (next && next->size >= size)
+    {
+        next->used = 0;
+        self->current = next;
+        return true;
+    }
+
+    size_t page_size = (size > self->page_size) ? size : self->page_size;
+    Arena_Page *page = new_page(page_size);
+    if (!page) return false;
+
+    /* too small to reuse, the new page goes in front of it */
+    page->next = next;
+    if (self->current) self->current->next = page;
+    else               self->first = page;
+    self->current = page;
+    return true;
+}
+
+//-------------------------------------------------------------------------------//
+// allocation
+//-------------------------------------------------------------------------------//
+
+Arena Arena_New(size_t page_size)
+{
+    return (Arena) {
+        .first = NULL,
+        .current = NULL,
+        .page_size = (page_size != 0) ? ALIGN_UP(page_size) : ARENA_DEFAULT_PAGE_SIZE,
+    };
+}
+
+/// @brief Bumps `size` bytes out of the current page, `align` must be a power of two.
+static void *bump(Arena *self, size_t size, size_t align)
+{
+    Arena_Page *page = self->current;
+    size_t start = page ? ((page->used + align - 1) & ~(align - 1)) : 0;
+    if (!page || start > page->size || page->size - start < size)
+    {
+        if (!next_page(self, size)) return NULL;
+        page = self->current;
+        start = 0;
+    }
+
+    page->used = start + size;
+    return page->data + start;
+}
+
+void *Arena_Alloc(Arena *self, size_t size)
+{
+    if (!self) return NULL;
+    return bump(self, ALIGN_UP(size != 0 ? size : 1), ARENA_ALIGN);
+}
+
+void *Arena_Grow(Arena *self, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!self) return NULL;
+    if (!ptr) return Arena_Alloc(self, new_size);
+    if (new_size <= old_size) return ptr;
+
+    /* the most recent allocation can just be extended */
+    Arena_Page *page = self->current;
+    size_t old_aligned = ALIGN_UP(old_size != 0 ? old_size : 1);
+    size_t new_aligned = ALIGN_UP(new_size);
+    if (page && (unsigned char *)ptr + old_aligned == page->data + page->used
+             && page->size - page->used >= new_aligned - old_aligned)
+    {
+        page->used += new_aligned - old_aligned;
+        return ptr;
+    }
+
+    /* anything else is copied, the old block is only reclaimed by a reset */
+    void *grown = Arena_Alloc(self, new_size);
+    if (!grown) return NULL;
+    memcpy(grown, ptr, old_size);
+    return grown;
+}
+
+char *Arena_String(Arena *self, const char *str, size_t len)
+{
+    if (!self) return NULL;
+
+    /* strings are not padded out, short names pack together */
+    char *copy = bump(self, len + 1, 1);
+    if (!copy) return NULL;
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+//-------------------------------------------------------------------------------//
+// marks
+//-------------------------------------------------------------------------------//
+
+Arena_Mark Arena_Get_Mark(const Arena *self)
+{
+    if (!self || !self->current) return (Arena_Mark) {0};
+    return (Arena_Mark) {.page = self->current, .used = self->current->used};
+}
+
+void Arena_Reset(Arena *self, Arena_Mark mark)
+{
+    if (!self) return;
+
+    if (!mark.page)
+    {
+        self->current = self->first;
+        if (self->current) self->current->used = 0;
+        return;
+    }
+
+    self->current = mark.page;
+    self->current->used = mark.used;
+}
+
+void Arena_Free(Arena *self)
+{
+    if (!self) return;
+
+    Arena_Page *page = self->first;
+    while (page)
+    {
+        Arena_Page *next = page->next;
+        free(page);
+        page = next;
+    }
+
+    self->first = NULL;
+    self->current = NULL;
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Arena(Test_Info *info)
+{
+    Arena arena = Arena_New(1024);
+
+    /* every allocation is aligned and writable */
+    bool ok = true;
+    unsigned char *first = NULL;
+    for (size_t i = 1; ok && i < 200; i++)
+    {
+        unsigned char *block = Arena_Alloc(&arena, i);
+        if (!first) first = block;
+        ok = block && ((uintptr_t)block % ARENA_ALIGN) == 0;
+        if (ok) memset(block, (int)i, i);
+    }
+    if (!Assert(ok, info, "arena returned a misaligned or NULL block"))
+    {
+        Arena_Free(&arena);
+        return;
+    }
+
+    /* an allocation bigger than a page gets a page of its own */
+    char *big = Arena_Alloc(&arena, 10000);
+    ok = big != NULL;
+
+    /* rolling back to a mark hands the same memory out again */
+    Arena_Mark mark = Arena_Get_Mark(&arena);
+    void *before = Arena_Alloc(&arena, 64);
+    Arena_Reset(&arena, mark);
+    void *after = Arena_Alloc(&arena, 64);
+    ok = ok && before == after;
+
+    /* the newest allocation grows in place */
+    char *grown = Arena_Grow(&arena, after, 64, 128);
+    ok = ok && grown == after;
+
+    char *lexeme = Get_Lexeme_In(&arena, "let x = 10", 4, 1);
+    ok = ok && strcmp(lexeme, "x") == 0;
+
+    /* a reset to the start reuses the first page */
+    Arena_Reset(&arena, (Arena_Mark) {0});
+    ok = ok && Arena_Alloc(&arena, 1) == first;
+
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "arena marks or growth misbehaved"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
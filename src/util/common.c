@@ -10,6 +10,12 @@
 // TOKEN IMPLEMENTATION
 //===============================================================================//
 
+const char *const TOKEN_SPELLINGS[TOKEN_KIND_COUNT] = {
+    #define X(name, str, spelling) [name] = spelling,
+    TOKEN_LIST
+    #undef X
+};
+
 void Print_Token(const char *src, Token const *self)
 {
     size_t pos = self->span.pos;
@@ -29,60 +35,6 @@ void Print_Token(const char *src, Token const *self)
         free((void *)lex);
 }
 
-//===============================================================================//
-// LIST IMPLEMENTATION
-//===============================================================================//
-
-List List_New(size_t size, size_t init_capacity)
-{
-    void *data = malloc(init_capacity * size);
-    if (!data) return (List) {0};
-
-    return (List) {
-        .data = data,
-        .size = size,
-        .capacity = init_capacity,
-        .count = 0
-    };
-}
-
-void *List_Get(List *self, size_t n)
-{
-    if (!self || n >= self->count)
-        return NULL;
-
-    void *item = (char *)self->data + n * self->size;
-    return item;
-}
-
-void List_Add(List *self, void* element)
-{
-    if (!self || !element) return;
-
-    /* grow array if neccesary */
-    if (self->count >= self->capacity)
-    {
-        size_t new_capacity = (self->capacity != 0)
-                            ? (self->capacity * LIST_GROWTH_FACTOR)
-                            : 4;
-        void *new_data = realloc(self->data, new_capacity * self->size);
-        if (!new_data) return;
-
-        self->data = new_data;
-        self->capacity = new_capacity;
-    }
-
-    void *dest = (char *)self->data + self->count * self->size;
-    memcpy(dest, element, self->size);
-    self->count++;
-}
-
-void List_Free(List *self)
-{
-    if (!self) return;
-    free(self->data);
-}
-
 //===============================================================================//
 // LEXEME FUNCTIONS
 //===============================================================================//
@@ -101,6 +53,12 @@ char *Get_Lexeme(const char *src, size_t pos, size_t len)
     return string;
 }
 
+char *Get_Lexeme_In(Arena *arena, const char *src, size_t pos, size_t len)
+{
+    if (!src) return NULL;
+    return Arena_String(arena, src + pos, len);
+}
+
 bool Cmp_Lexeme(const char *src, const Span *span, const char *lit)
 {
     return strncmp(src + span->pos, lit, span->len) == 0
@@ -122,12 +80,82 @@ void Remove_Underbars(char *str)
     *dst = '\0';
 }
 
+//===============================================================================//
+// LINE INDEX
+//===============================================================================//
+
+Line_Index Line_Index_Build(const char *src, size_t len)
+{
+    Line_Index self = {0};
+    size_t capacity = 64;
+    uint32_t *starts = malloc(capacity * sizeof(uint32_t));
+    if (!starts) return self;
+
+    size_t count = 0;
+    starts[count++] = 0;
+
+    const char *at = src;
+    const char *end = src + len;
+    while (at < end && (at = memchr(at, '\n', (size_t)(end - at))) != NULL)
+    {
+        at++;
+        if (count >= capacity)
+        {
+            size_t new_capacity = capacity * VEC_GROWTH_FACTOR;
+            uint32_t *new_starts = realloc(starts, new_capacity * sizeof(uint32_t));
+            if (!new_starts)
+            {
+                free(starts);
+                return self;
+            }
+            starts = new_starts;
+            capacity = new_capacity;
+        }
+        starts[count++] = (uint32_t)(at - src);
+    }
+
+    self.starts = starts;
+    self.count = count;
+    self.capacity = capacity;
+    self.source_len = len;
+    return self;
+}
+
+void Line_Index_Locate(const Line_Index *self, size_t pos, size_t *x, size_t *y)
+{
+    if (!self || self->count == 0)
+    {
+        *x = pos + 1;
+        *y = 1;
+        return;
+    }
+
+    /* find the last line that starts at or before pos */
+    size_t lo = 0, hi = self->count;
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (self->starts[mid] <= pos) lo = mid;
+        else                          hi = mid;
+    }
+
+    *y = lo + 1;
+    *x = pos - self->starts[lo] + 1;
+}
+
+void Line_Index_Free(Line_Index *self)
+{
+    if (!self) return;
+    free(self->starts);
+    *self = (Line_Index) {0};
+}
+
 //===============================================================================//
 // OPERATOR HELPER FUNCTIONS
 //===============================================================================//
 
 static const int OPERATOR_FLAGS[] = {
-    #define X(name, token, str, flag) [name] = flag,
+    #define X(name, token, str, flag, power, assoc) [name] = flag,
     OPERATOR_LIST
     #undef X
 };
@@ -135,7 +163,7 @@ static const int OPERATOR_FLAGS[] = {
 static inline int get_op_by_token(Token_Kind kind)
 {
     switch (kind) {
-        #define X(name, token, str, flag) case token: return name;
+        #define X(name, token, str, flag, power, assoc) case token: return name;
         OPERATOR_LIST
         #undef X
         default: return -1;
@@ -143,21 +171,21 @@ static inline int get_op_by_token(Token_Kind kind)
 }
 
 /// @brief Returns the `Operator` pertaining to this token kind that is a binary operator.
-inline int Get_Binary_Operator(Token_Kind kind)
+int Get_Binary_Operator(Token_Kind kind)
 {
     int op = get_op_by_token(kind);
     return (op != -1 && (OPERATOR_FLAGS[op] & OP_FLAG_BINARY) ? op : -1);
 }
 
 /// @brief Returns the `Operator` pertaining to this token kind that is a unary operator.
-inline int Get_Unary_Operator(Token_Kind kind)
+int Get_Unary_Operator(Token_Kind kind)
 {
     int op = get_op_by_token(kind);
     return (op != -1 && (OPERATOR_FLAGS[op] & OP_FLAG_UNARY) ? op : -1);
 }
 
 /// @brief Returns the `Operator` pertaining to this token kind that is an assignment operator.
-inline int Get_Assign_Operator(Token_Kind kind)
+int Get_Assign_Operator(Token_Kind kind)
 {
     int op = get_op_by_token(kind);
     return (op != -1 && (OPERATOR_FLAGS[op] & OP_FLAG_ASSIGN) ? op : -1);
@@ -167,42 +195,96 @@ inline int Get_Assign_Operator(Token_Kind kind)
 // tests
 //-------------------------------------------------------------------------------//
 
-void Test_List(Test_Info *info)
+VEC_DEFINE(Vec_Int, int)
+
+void Test_Vec(Test_Info *info)
 {
-    printf("> Testing List<int>\n");
+    printf("> Testing Vec_Int\n");
 
-    List int_list = List_New(sizeof(int), 4);
-   
-    int head = 0;
-    List_Add(&int_list, &head);
+    Vec_Int ints = {0};
+    bool ok = true;
 
-    /* add to the list */
-    for (int i = 1; i < 50; i++)
+    /* push one at a time, growing from nothing */
+    for (int i = 0; ok && i < 50; i++)
     {
-        int val = i;
-        List_Add(&int_list, &val);
-        
-        int *last = (int *)List_Get(&int_list, i - 1);
-        if (!last)
-        {
-            info->success = false;
-            info->status = false;
-            info->message = "Got NULL from List_Get() in int loop!";
-            return;
-        }
+        ok = Vec_Int_Push(&ints, i);
+        int *last = Vec_Int_Get(&ints, (size_t)i);
+        ok = ok && last && *last == i;
+    }
+    if (!Assert(ok, info, "Vec value did not match expected"))
+    {
+        Vec_Int_Free(&ints);
+        return;
+    }
+
+    /* bulk extend, then pop and truncate back down */
+    int more[100];
+    for (int i = 0; i < 100; i++) more[i] = 50 + i;
+    ok = Vec_Int_Reserve(&ints, 100) && ints.capacity >= 150
+      && Vec_Int_Extend(&ints, more, 100) && ints.count == 150;
+    for (size_t i = 0; ok && i < ints.count; i++)
+        ok = ints.data[i] == (int)i;
+
+    int popped = -1;
+    ok = ok && Vec_Int_Pop(&ints, &popped) && popped == 149 && ints.count == 149;
+    Vec_Int_Truncate(&ints, 10);
+    ok = ok && ints.count == 10 && Vec_Int_Get(&ints, 10) == NULL;
+    Vec_Int_Truncate(&ints, 0);
+    ok = ok && !Vec_Int_Pop(&ints, NULL);
+    Vec_Int_Free(&ints);
+
+    /* the same vec out of an arena */
+    Arena arena = Arena_New(0);
+    Vec_Int in_arena = Vec_Int_New_In(&arena, 2);
+    for (int i = 0; ok && i < 1000; i++)
+        ok = Vec_Int_Push(&in_arena, i);
+    for (int i = 0; ok && i < 1000; i++)
+        ok = *Vec_Int_Get(&in_arena, (size_t)i) == i;
+    Vec_Int_Free(&in_arena);
+    Arena_Free(&arena);
+
+    if (!Assert(ok, info, "Vec reserve, extend, pop or truncate misbehaved"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
 
-        if (*last != i - 1) {
-            info->success = false;
-            info->status = false;
-            info->message = "List value did not match expected";
+void Test_Line_Index(Test_Info *info)
+{
+    const char *src = "let x = 0\n"
+                      "\n"
+                      "##\n"
+                      " multi-line comment\n"
+                      "###\n"
+                      "x = 1";
+    size_t len = strlen(src);
+
+    Line_Index lines = Line_Index_Build(src, len);
+    if (!Assert(lines.count == 6, info, "expected six lines"))
+    {
+        Line_Index_Free(&lines);
+        return;
+    }
+
+    /* check every offset against a plain rescan of the source */
+    size_t x = 1, y = 1;
+    for (size_t pos = 0; pos <= len; pos++)
+    {
+        size_t got_x, got_y;
+        Line_Index_Locate(&lines, pos, &got_x, &got_y);
+        if (!Assert(got_x == x && got_y == y, info, "line index disagreed with a rescan"))
+        {
+            printf("> offset %zu: expected %zu:%zu, got %zu:%zu\n", pos, y, x, got_y, got_x);
+            Line_Index_Free(&lines);
             return;
         }
 
-        printf("> '%i'\n", *last + i);
+        if (pos < len && src[pos] == '\n') { y++; x = 1; }
+        else x++;
     }
 
-    List_Free(&int_list);
-
+    Line_Index_Free(&lines);
     info->success = true;
     info->status = true;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "util/errors.h"
 #include "util/common.h"
 #include "util/tests.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -9,123 +10,56 @@
 #include <stdbool.h>
 
 //-------------------------------------------------------------------------------//
-// reporting methods
+// line lookup
 //-------------------------------------------------------------------------------//
 
-void Report_Errors(List *errrors, const char *src, const char *path)
+/// @brief The line of source an offset falls on, `end` is the offset of the line's
+/// '\n' or the length of the source for the last line.
+struct line_fetch_result { size_t start; size_t end; bool valid; };
+struct line_fetch_result fetch_line(const Line_Index *lines, size_t i)
 {
-    if (!errrors || errrors->count == 0) return;
-    
-    for (size_t i = errrors->count - 1 ;; i--)
-    {
-        Error *error = (Error *)List_Get(errrors, i);
-        if (error) Print_Error(src, path, error);
-        if (i == 0) break;
-    }
-}
-
-void hide_newlines(char *str)
-{
-    if (str == NULL) return;
-
-    size_t len = strlen(str);
-    for (size_t i = 0; i <= len; i++)
-    {
-        if (str[i] == '\n' || 
-           (str[i] == '\0' && i != len))
-        {
-            str[i] = ' ';
-        }
-    }
-}
-
-struct line_fetch_result { Span span; bool valid; };
-struct line_fetch_result fetch_line(const char *src, size_t i)
-{
-    size_t src_len = strlen(src);
-    size_t start = i, end = i;
-    
-    if (i > src_len)
-        return (struct line_fetch_result) {(Span) {0}, false};
-
-    // find the beginning of the line
-
-    if (i > 0)
-    {
-        for (size_t j = i - 1; /*N/A*/; j--)
-        {
-            if (j == 0)
-            {
-                start = 0;
-                break;
-            }
-            if (src[j] == '\n' && j != i)
-            {
-                start = j + 1;
-                break;
-            }
-        }
-    }
-
-    if (i == src_len)
-    {
-        return (struct line_fetch_result) {(Span) {start, src_len - start}, true};
-    }
-
-    // find the end of the line
-    for (size_t j = i; j <= src_len; j++)
-    {
-        if ((src[j] == '\n' || src[j] == '\0'))
-        {
-            end = j;
-            break;
-        }
-    }
+    size_t src_len = lines ? lines->source_len : 0;
+    if (!lines || lines->count == 0 || i > src_len)
+        return (struct line_fetch_result) {0, 0, false};
 
-    assert(end <= src_len); /* returning the \0 of the source is irrelevant */
-                            /* because that position will just be overwritte with */
-                            /* a \0 when we get the lexeme. */
-    assert(start < src_len);
-    assert(end >= i);
-    assert(start <= i);
+    size_t x, y;
+    Line_Index_Locate(lines, i, &x, &y);
 
-    // size_t len = (end - start > 0) ? end - start : 1;
-    size_t len = end - start + 1;
-    return (struct line_fetch_result) {(Span) {start, len}, true};
+    size_t start = lines->starts[y - 1];
+    size_t end = (y < lines->count) ? lines->starts[y] - 1 : src_len;
+    return (struct line_fetch_result) {start, end, true};
 }
 
 //-------------------------------------------------------------------------------//
 // print methods
 //-------------------------------------------------------------------------------//
 
-void print_invalid_return(Error const *self)
+/// @brief Prints the line the span starts on with carets under the span.
+static void print_snippet(const char *src, const Line_Index *lines, Span span)
 {
-    const char *src = self->data_invalid_return.def_src;
-    const char *path = self->data_invalid_return.def_path;
-    Span span = self->data_invalid_return.def_span;
-    size_t y = self->data_invalid_return.def_y;
-    size_t x = self->data_invalid_return.def_x;
-
-    printf("%s%sdefinition:%s %s:%zu:%zu\n",
-        TERM_ESC, TERM_MAGENTAB, TERM_RESET, path, y, x);
+    if (!lines)
+    {
+        printf("<Error fetching line content>\n");
+        return;
+    }
 
-    struct line_fetch_result line = fetch_line(src, span.pos);
+    struct line_fetch_result line = fetch_line(lines, span.pos);
     if (!line.valid)
     {
-        printf("<Error fetching line content>");
+        printf("<Error fetching line content>\n");
         return;
     }
-    
-    char *raw = Get_Lexeme(src, line.span.pos, line.span.len); 
-    hide_newlines(raw);
-    printf("  |\n  | %s\n  | %s%s", raw, TERM_ESC, TERM_RED);
-    
-    /* Line Start   */ size_t l_start = line.span.pos; 
-    /* Line End     */ size_t l_end = line.span.pos + line.span.len - 1; 
+
+    /* the line's newline is shown as a blank column so spans on it still point somewhere */
+    printf("  |\n  | %.*s%s\n  | %s%s",
+        (int)(line.end - line.start), src + line.start,
+        (line.end < lines->source_len) ? " " : "",
+        TERM_ESC, TERM_RED);
+
     /* Carets Start */ size_t c_start = span.pos; 
     /* Carets End   */ size_t c_end = span.pos + span.len - 1; 
     
-    for (size_t i = l_start; i <= l_end; i++)
+    for (size_t i = line.start; i <= line.end; i++)
     {
         if (i >= c_start && i <= c_end)
             putchar('^');
@@ -133,50 +67,57 @@ void print_invalid_return(Error const *self)
             putchar(' ');
     }
     printf("%s\n", TERM_RESET);
+}
+
+void print_invalid_return(Source_Manager *sources, Error const *self)
+{
+    Span span = self->data_invalid_return.def_span;
+    size_t y = self->data_invalid_return.def_y;
+    size_t x = self->data_invalid_return.def_x;
+
+    /* the definition may live in another file than the error itself */
+    const Source_File *source = Source_Get(sources, span.file);
+    const char *path = source ? source->path : "<unknown>";
+
+    printf("%s%sdefinition:%s %s:%zu:%zu\n",
+        TERM_ESC, TERM_MAGENTAB, TERM_RESET, path, y, x);
+
+    if (source)
+        print_snippet(source->src, Source_Lines(sources, span.file), span);
+    else
+        printf("<Error fetching line content>\n");
+
     printf("function defined to return type '%s'. Either change the return expression or use a runtime cast.\n",
         self->data_invalid_return.def_type
     );
 }
 
-void Print_Error(const char *src, const char *path, Error const *self)
+void Print_Error(Source_Manager *sources, Error const *self)
 {
+    const Source_File *source = Source_Get(sources, self->span.file);
+    const char *path = source ? source->path : "<unknown>";
+
+    size_t x = self->x, y = self->y;
+    if (y == 0 && source)
+        Line_Index_Locate(Source_Lines(sources, self->span.file), self->span.pos, &x, &y);
+
     printf("%s%serror:%s %s:%zu:%zu",
-        TERM_ESC, TERM_REDB, TERM_RESET, path, self->y, self->x);
+        TERM_ESC, TERM_REDB, TERM_RESET, path, y, x);
 
     const char *type = ERROR_TYPE_NAMES[self->type];
     printf("%s%s %s %s\n", TERM_ESC, TERM_YELLOWB, type, TERM_RESET);
 
-    struct line_fetch_result line = fetch_line(src, self->span.pos);
-    if (!line.valid)
-    {
+    if (source)
+        print_snippet(source->src, Source_Lines(sources, self->span.file), self->span);
+    else
         printf("<Error fetching line content>\n");
-        return;
-    }
-
-    char *raw = Get_Lexeme(src, line.span.pos, line.span.len); 
-    hide_newlines(raw);
-    printf("  |\n  | %s\n  | %s%s", raw, TERM_ESC, TERM_RED);
-    
-    /* Line Start   */ size_t l_start = line.span.pos; 
-    /* Line End     */ size_t l_end = line.span.pos + line.span.len - 1; 
-    /* Carets Start */ size_t c_start = self->span.pos; 
-    /* Carets End   */ size_t c_end = self->span.pos + self->span.len - 1; 
-    
-    for (size_t i = l_start; i <= l_end; i++)
-    {
-        if (i >= c_start && i <= c_end)
-            putchar('^');
-        else
-            putchar(' ');
-    }
-
-    printf("%s\n%s\n", TERM_RESET, self->message);
+    printf("%s\n", self->message);
     
     switch (self->type)
     {
         case ERR_INVALID_RETURN:
         {
-            print_invalid_return(self);
+            print_invalid_return(sources, self);
             break;
         }
 
@@ -185,6 +126,22 @@ void Print_Error(const char *src, const char *path, Error const *self)
     printf("\n");
 }
 
+//-------------------------------------------------------------------------------//
+// reporting methods
+//-------------------------------------------------------------------------------//
+
+void Report_Errors(Vec_Error *errors, Source_Manager *sources)
+{
+    if (!errors || errors->count == 0) return;
+    
+    for (size_t i = errors->count - 1 ;; i--)
+    {
+        Error *error = Vec_Error_Get(errors, i);
+        if (error) Print_Error(sources, error);
+        if (i == 0) break;
+    }
+}
+
 //-------------------------------------------------------------------------------//
 // error methods
 //-------------------------------------------------------------------------------//
@@ -206,6 +163,38 @@ Error Make_Error(Error_Type type, size_t x, size_t y, Span span, const char *msg
     };
 }
 
+const char *Error_Format(Arena *arena, size_t *len, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const char *message = Error_VFormat(arena, len, fmt, args);
+    va_end(args);
+    return message;
+}
+
+const char *Error_VFormat(Arena *arena, size_t *len, const char *fmt, va_list args)
+{
+    va_list copy;
+    va_copy(copy, args);
+
+    /* measure first, then write straight into the arena */
+    int needed = vsnprintf(NULL, 0, fmt, args);
+
+    char *message = (needed >= 0) ? Arena_Alloc(arena, (size_t)needed + 1) : NULL;
+    if (!message)
+    {
+        va_end(copy);
+        const char *fallback = "<could not format error message>";
+        if (len) *len = strlen(fallback);
+        return fallback;
+    }
+
+    vsnprintf(message, (size_t)needed + 1, fmt, copy);
+    va_end(copy);
+    if (len) *len = (size_t)needed;
+    return message;
+}
+
 void Free_Error(Error *self)
 {
 }
@@ -227,21 +216,29 @@ void Test_Error_Collection(Test_Info *info)
     assert(src[24] == '2');
     assert(src[35] == 'r');
 
-    List ec = List_New(sizeof(Error), INIT_ERROR_CAPACITY);
+    Source_Manager sources = Source_Manager_New();
+    File_Id file;
+    Source_Add_Buffer(&sources, path, src, strlen(src), &file);
+
+    Arena arena = Arena_New(0);
+    Vec_Error ec = Vec_Error_New_In(&arena, INIT_ERROR_CAPACITY);
     
     {
-        Span span = (Span) {24, 1};
+        Span span = (Span) {24, 1, file};
         Error err = Make_Error(ERR_SYNTAX, 33, 2, span, "expected identifier, got '2'");
-        List_Add(&ec, &err);
+        Vec_Error_Push(&ec, err);
     }
     {
-        Span span = (Span) {35, 9};
-        Error err = Make_Error(ERR_SYNTAX, 5, 3, span, "function 'main' is annoted to return nothing, but returns 'int' here");
-        List_Add(&ec, &err);
+        Span span = (Span) {35, 9, file};
+        Error err = Make_Error(ERR_SYNTAX, 5, 3, span, "");
+        err.message = Error_Format(&arena, &err.msg_len,
+            "function '%s' is annoted to return nothing, but returns '%s' here", "main", "int");
+        Vec_Error_Push(&ec, err);
     }
 
-    Report_Errors(&ec, src, path);
-    List_Free(&ec);
+    Report_Errors(&ec, &sources);
+    Arena_Free(&arena);
+    Source_Manager_Free(&sources);
     
     info->status = true;
     info->success = true;
@@ -256,25 +253,28 @@ void Test_Append_Data_Errors(Test_Info *info)
     assert(src[31] == 'r');
     assert(src[19] == 'i');
 
-    List ec = List_New(sizeof(Error), INIT_ERROR_CAPACITY);
+    Source_Manager sources = Source_Manager_New();
+    File_Id file;
+    Source_Add_Buffer(&sources, path, src, strlen(src), &file);
+
+    Vec_Error ec = Vec_Error_New(INIT_ERROR_CAPACITY);
 
     {
-        Span span = (Span) {31, 10};
+        Span span = (Span) {31, 10, file};
         Error err = Make_Error(ERR_INVALID_RETURN, 33, 2, span, "cannot return type 'float' from function defined to return type 'integer'");
         Error_Invalid_Return data = (Error_Invalid_Return){
             .def_x = 0,
             .def_y = 0,
-            .def_path = "test.sudu",
-            .def_span = (Span) {19, 7},
+            .def_span = (Span) {19, 7, file},
             .def_type = "integer",
-            .def_src = src
         };
         Append_Invalid_Return(&err, data);
-        List_Add(&ec, &err);
+        Vec_Error_Push(&ec, err);
     }
 
-    Report_Errors(&ec, src, path);
-    List_Free(&ec);
+    Report_Errors(&ec, &sources);
+    Vec_Error_Free(&ec);
+    Source_Manager_Free(&sources);
 
     info->status = true;
     info->success = true;
@@ -0,0 +1,196 @@
+#include "util/intern.h"
+#include "util/arena.h"
+#include "util/common.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------------//
+// table
+//-------------------------------------------------------------------------------//
+
+typedef struct _intern_entry
+{
+    const char *str;
+    uint32_t len;
+    uint32_t hash;
+} intern_entry;
+
+/// @brief `entries` is indexed by id (slot 0 is `INTERN_NONE`), `slots` is the
+/// open-addressed hash table of ids, 0 marking an empty slot. The strings are
+/// bump-allocated out of `strings`, whose pages never move, which is what keeps
+/// the pointers from `Intern_Lookup` stable.
+typedef struct _intern_table
+{
+    Arena strings;
+    intern_entry *entries;
+    size_t count;
+    size_t capacity;
+    Intern_Id *slots;
+    size_t slot_count;
+} intern_table;
+
+static intern_table table = {0};
+
+static uint32_t hash_string(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool grow_slots(void)
+{
+    size_t new_count = (table.slot_count != 0)
+                     ? (table.slot_count * VEC_GROWTH_FACTOR)
+                     : INIT_INTERN_CAPACITY * 2;
+    Intern_Id *new_slots = calloc(new_count, sizeof(Intern_Id));
+    if (!new_slots) return false;
+
+    /* rehash every id, the hash is cached in its entry */
+    for (size_t id = 1; id < table.count; id++)
+    {
+        size_t slot = table.entries[id].hash & (new_count - 1);
+        while (new_slots[slot] != INTERN_NONE)
+            slot = (slot + 1) & (new_count - 1);
+        new_slots[slot] = (Intern_Id)id;
+    }
+
+    free(table.slots);
+    table.slots = new_slots;
+    table.slot_count = new_count;
+    return true;
+}
+
+static bool grow_entries(void)
+{
+    size_t new_capacity = (table.capacity != 0)
+                        ? (table.capacity * VEC_GROWTH_FACTOR)
+                        : INIT_INTERN_CAPACITY;
+    intern_entry *new_entries = realloc(table.entries, new_capacity * sizeof(intern_entry));
+    if (!new_entries) return false;
+
+    if (table.capacity == 0)
+    {
+        new_entries[0] = (intern_entry) {0}; /* reserve INTERN_NONE */
+        table.count = 1;
+    }
+
+    table.entries = new_entries;
+    table.capacity = new_capacity;
+    return true;
+}
+
+//-------------------------------------------------------------------------------//
+// interning
+//-------------------------------------------------------------------------------//
+
+Intern_Id Intern(const char *str, size_t len)
+{
+    if (!str || len > UINT32_MAX) return INTERN_NONE;
+
+    /* keep the load factor at or below one half */
+    if ((table.count + 1) * 2 > table.slot_count && !grow_slots())
+        return INTERN_NONE;
+
+    uint32_t hash = hash_string(str, len);
+    size_t mask = table.slot_count - 1;
+    size_t slot = hash & mask;
+
+    for (;;)
+    {
+        Intern_Id id = table.slots[slot];
+        if (id == INTERN_NONE) break;
+
+        intern_entry *entry = &table.entries[id];
+        if (entry->hash == hash && entry->len == len && memcmp(entry->str, str, len) == 0)
+            return id;
+        slot = (slot + 1) & mask;
+    }
+
+    if (table.count >= table.capacity && !grow_entries())
+        return INTERN_NONE;
+
+    if (table.strings.page_size == 0)
+        table.strings = Arena_New(INTERN_PAGE_SIZE);
+    const char *copy = Arena_String(&table.strings, str, len);
+    if (!copy) return INTERN_NONE;
+
+    Intern_Id id = (Intern_Id)table.count++;
+    table.entries[id] = (intern_entry) {.str = copy, .len = (uint32_t)len, .hash = hash};
+    table.slots[slot] = id;
+    return id;
+}
+
+const char *Intern_Lookup(Intern_Id id, size_t *len)
+{
+    if (id == INTERN_NONE || id >= table.count)
+    {
+        if (len) *len = 0;
+        return NULL;
+    }
+
+    if (len) *len = table.entries[id].len;
+    return table.entries[id].str;
+}
+
+size_t Intern_Count(void)
+{
+    return (table.count != 0) ? table.count - 1 : 0;
+}
+
+void Intern_Free(void)
+{
+    Arena_Free(&table.strings);
+    free(table.entries);
+    free(table.slots);
+    table = (intern_table) {0};
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Intern(Test_Info *info)
+{
+    size_t before = Intern_Count();
+
+    Intern_Id x = Intern("x", 1);
+    Intern_Id print = Intern("print(i)", 5); /* only the first 5 bytes */
+    Intern_Id x_again = Intern("xyz", 1);
+    const char *x_str = Intern_Lookup(x, NULL);
+
+    bool ok = x != INTERN_NONE && x == x_again && x != print
+           && strcmp(Intern_Lookup(print, NULL), "print") == 0;
+
+    /* enough names to grow the table and fill several pages */
+    char name[32];
+    for (int i = 0; ok && i < 20000; i++)
+    {
+        int len = snprintf(name, sizeof(name), "symbol_%d", i);
+        Intern_Id id = Intern(name, (size_t)len);
+        size_t got_len;
+        const char *got = Intern_Lookup(id, &got_len);
+        ok = got && got_len == (size_t)len && memcmp(got, name, (size_t)len) == 0;
+    }
+
+    ok = ok && Intern_Count() >= before + 20002
+            && Intern("x", 1) == x
+            && Intern_Lookup(x, NULL) == x_str /* the pointer never moved */
+            && Intern_Lookup(INTERN_NONE, NULL) == NULL;
+    printf("> %zu strings interned\n", Intern_Count());
+
+    if (!Assert(ok, info, "interned strings did not round trip"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
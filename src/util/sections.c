@@ -0,0 +1,173 @@
+#include "util/sections.h"
+#include "util/common.h"
+#include "util/source.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//-------------------------------------------------------------------------------//
+// layout
+//-------------------------------------------------------------------------------//
+
+static size_t align_section(size_t n)
+{
+    return (n + SECTION_ALIGN - 1) & ~(size_t)(SECTION_ALIGN - 1);
+}
+
+size_t Layout_Sections(size_t header_size, const size_t *sizes, size_t count, size_t *offsets)
+{
+    size_t at = align_section(header_size);
+    for (size_t i = 0; i < count; i++)
+    {
+        offsets[i] = at;
+        at = align_section(at + sizes[i]);
+    }
+    return at;
+}
+
+//-------------------------------------------------------------------------------//
+// replacing files
+//-------------------------------------------------------------------------------//
+
+#ifdef _WIN32
+
+#define TEMP_SUFFIX_MAX sizeof(".tmp")
+
+static FILE *open_temp(const char *path, char *temp)
+{
+    sprintf(temp, "%s.tmp", path);
+    return fopen(temp, "wb");
+}
+
+/* `rename` will not replace a file here, the old one has to go first */
+static bool replace(const char *temp, const char *path)
+{
+    remove(path);
+    return rename(temp, path) == 0;
+}
+
+#else
+
+#define TEMP_SUFFIX_MAX sizeof(".4294967295.tmp")
+
+/// @brief Opens a temporary file named after the process, so two processes
+/// replacing the same file do not write into each other's. A file left under
+/// that name can only be from a process that died, it is removed first.
+static FILE *open_temp(const char *path, char *temp)
+{
+    sprintf(temp, "%s.%lu.tmp", path, (unsigned long)getpid() & 0xFFFFFFFFul);
+    unlink(temp);
+
+    int fd = open(temp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0) return NULL;
+
+    FILE *file = fdopen(fd, "wb");
+    if (!file)
+    {
+        close(fd);
+        unlink(temp);
+    }
+    return file;
+}
+
+/* `rename` swaps the name over in one step, a mapping of the old file keeps it */
+static bool replace(const char *temp, const char *path)
+{
+    return rename(temp, path) == 0;
+}
+
+#endif // _WIN32
+
+bool Replacement_Open(const char *path, File_Replacement *out)
+{
+    *out = (File_Replacement) {.path = path};
+    out->temp = malloc(strlen(path) + TEMP_SUFFIX_MAX);
+    if (!out->temp) return false;
+
+    out->file = open_temp(path, out->temp);
+    if (out->file) return true;
+
+    free(out->temp);
+    *out = (File_Replacement) {0};
+    return false;
+}
+
+bool Replacement_Write(File_Replacement *self, size_t offset, const void *data, size_t len)
+{
+    if (fseek(self->file, (long)offset, SEEK_SET) != 0) return false;
+    return len == 0 || fwrite(data, 1, len, self->file) == len;
+}
+
+bool Replacement_Close(File_Replacement *self, size_t size, bool ok)
+{
+    if (!self->file) return false;
+
+    /* pad the last section out, unless what was written already reaches the end */
+    long end = (ok && fseek(self->file, 0, SEEK_END) == 0) ? ftell(self->file) : -1;
+    ok = ok && end >= 0 && ((size_t)end >= size || Replacement_Write(self, size - 1, "", 1));
+    if (fclose(self->file) != 0) ok = false;
+    ok = ok && replace(self->temp, self->path);
+    if (!ok) remove(self->temp);
+
+    free(self->temp);
+    *self = (File_Replacement) {0};
+    return ok;
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+static bool replace_with(const char *path, const char *text, bool ok)
+{
+    File_Replacement r;
+    if (!Replacement_Open(path, &r)) return false;
+    ok = Replacement_Write(&r, 0, text, strlen(text)) && ok;
+    return Replacement_Close(&r, strlen(text), ok);
+}
+
+static bool holds(const char *path, const char *text)
+{
+    Mapped_File file;
+    if (!Map_File(path, &file)) return false;
+    bool same = file.len == strlen(text) && memcmp(file.data, text, file.len) == 0;
+    Unmap_File(&file);
+    return same;
+}
+
+void Test_Sections(Test_Info *info)
+{
+    /* every section starts aligned, an empty one where the next one does */
+    size_t sizes[] = {3, 0, 16, 1};
+    size_t offsets[4];
+    size_t size = Layout_Sections(12, sizes, 4, offsets);
+    bool ok = offsets[0] == 16 && offsets[1] == 24 && offsets[2] == 24 && offsets[3] == 40
+           && size == 48;
+
+    /* a mapping taken before the file is replaced still reads the old contents */
+    const char *path = "sudu_sections_test.bin";
+    Mapped_File old = {0};
+    ok = ok && replace_with(path, "old contents", true) && Map_File(path, &old)
+            && replace_with(path, "new", true)
+            && old.len == 12 && memcmp(old.data, "old contents", 12) == 0
+            && holds(path, "new");
+    Unmap_File(&old);
+
+    /* a replacement that failed leaves the file as it was */
+    ok = ok && !replace_with(path, "lost", false) && holds(path, "new");
+
+    remove(path);
+    if (!Assert(ok, info, "sectioned file was not laid out or replaced as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,234 @@
+#include "util/source.h"
+#include "util/common.h"
+#include "util/tests.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//-------------------------------------------------------------------------------//
+// mapped files
+//-------------------------------------------------------------------------------//
+
+#ifdef _WIN32
+
+/* no mmap here, fall back on reading the whole file into the heap */
+bool Map_File(const char *path, Mapped_File *out)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+
+    if (fseek(file, 0, SEEK_END) != 0) { fclose(file); return false; }
+    long size = ftell(file);
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) { fclose(file); return false; }
+
+    char *data = malloc((size_t)size + 1);
+    if (!data) { fclose(file); return false; }
+
+    size_t read = fread(data, 1, (size_t)size, file);
+    fclose(file);
+    if (read != (size_t)size) { free(data); return false; }
+
+    data[size] = '\0';
+    *out = (Mapped_File) {.data = data, .len = (size_t)size, .mapped = false};
+    return true;
+}
+
+void Unmap_File(Mapped_File *self)
+{
+    if (!self) return;
+    free((void *)self->data);
+    *self = (Mapped_File) {0};
+}
+
+#else
+
+bool Map_File(const char *path, Mapped_File *out)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+
+    /* an empty file cannot be mapped, but there is nothing to map anyway */
+    if (info.st_size == 0)
+    {
+        close(fd);
+        *out = (Mapped_File) {.data = "", .len = 0, .mapped = false};
+        return true;
+    }
+
+    size_t len = (size_t)info.st_size;
+    void *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping keeps the file alive */
+    if (data == MAP_FAILED) return false;
+
+    madvise(data, len, MADV_SEQUENTIAL);
+    *out = (Mapped_File) {.data = data, .len = len, .mapped = true};
+    return true;
+}
+
+void Unmap_File(Mapped_File *self)
+{
+    if (!self) return;
+    if (self->mapped)
+        munmap((void *)self->data, self->len);
+    *self = (Mapped_File) {0};
+}
+
+#endif // _WIN32
+
+//-------------------------------------------------------------------------------//
+// source manager
+//-------------------------------------------------------------------------------//
+
+Source_Manager Source_Manager_New(void)
+{
+    Source_File *files = malloc(INIT_SOURCE_CAPACITY * sizeof(Source_File));
+    if (!files) return (Source_Manager) {0};
+
+    return (Source_Manager) {
+        .files = files,
+        .count = 0,
+        .capacity = INIT_SOURCE_CAPACITY,
+    };
+}
+
+static bool add_source(Source_Manager *self, Source_File source, File_Id *id)
+{
+    if (self->count >= self->capacity)
+    {
+        size_t new_capacity = (self->capacity != 0)
+                            ? (self->capacity * VEC_GROWTH_FACTOR)
+                            : INIT_SOURCE_CAPACITY;
+        Source_File *new_files = realloc(self->files, new_capacity * sizeof(Source_File));
+        if (!new_files) return false;
+
+        self->files = new_files;
+        self->capacity = new_capacity;
+    }
+
+    *id = (File_Id)self->count;
+    self->files[self->count++] = source;
+    return true;
+}
+
+bool Source_Load(Source_Manager *self, const char *path, File_Id *id)
+{
+    if (!self || !path || !id) return false;
+
+    Mapped_File file;
+    if (!Map_File(path, &file)) return false;
+
+    Source_File source = (Source_File) {
+        .path = path,
+        .src = file.data,
+        .len = file.len,
+        .file = file,
+    };
+
+    if (!add_source(self, source, id))
+    {
+        Unmap_File(&file);
+        return false;
+    }
+    return true;
+}
+
+bool Source_Add_Buffer(Source_Manager *self, const char *path, const char *src, size_t len, File_Id *id)
+{
+    if (!self || !src || !id) return false;
+
+    Source_File source = (Source_File) {
+        .path = path,
+        .src = src,
+        .len = len,
+    };
+    return add_source(self, source, id);
+}
+
+const Source_File *Source_Get(const Source_Manager *self, File_Id id)
+{
+    if (!self || id >= self->count) return NULL;
+    return &self->files[id];
+}
+
+const Line_Index *Source_Lines(Source_Manager *self, File_Id id)
+{
+    if (!self || id >= self->count) return NULL;
+
+    Source_File *source = &self->files[id];
+    if (source->lines.count == 0)
+        source->lines = Line_Index_Build(source->src, source->len);
+    return &source->lines;
+}
+
+void Source_Manager_Free(Source_Manager *self)
+{
+    if (!self) return;
+
+    for (size_t i = 0; i < self->count; i++)
+    {
+        Unmap_File(&self->files[i].file);
+        Line_Index_Free(&self->files[i].lines);
+    }
+    free(self->files);
+    *self = (Source_Manager) {0};
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+void Test_Source_Manager(Test_Info *info)
+{
+    const char *path = "sudu_source_test.sudu";
+    const char *text = "var i = 0\ni = i + 1\n";
+
+    FILE *file = fopen(path, "wb");
+    if (!Assert(file != NULL, info, "could not write the test source"))
+        return;
+    fputs(text, file);
+    fclose(file);
+
+    Source_Manager sources = Source_Manager_New();
+    File_Id buffer_id, file_id;
+    bool ok = Source_Add_Buffer(&sources, "<buffer>", "print(i)", 8, &buffer_id)
+           && Source_Load(&sources, path, &file_id);
+
+    const Source_File *loaded = Source_Get(&sources, file_id);
+    ok = ok && buffer_id == 0 && file_id == 1 && loaded
+            && loaded->len == strlen(text)
+            && memcmp(loaded->src, text, loaded->len) == 0;
+    printf("> loaded '%s' as file %u (%zu bytes, mapped = %i)\n",
+        path, (unsigned)file_id, loaded ? loaded->len : 0, loaded ? loaded->file.mapped : 0);
+
+    const Line_Index *lines = Source_Lines(&sources, file_id);
+    ok = ok && lines && lines->count == 3;
+
+    File_Id missing;
+    ok = ok && !Source_Load(&sources, "sudu_source_test_missing.sudu", &missing)
+            && Source_Get(&sources, 2) == NULL;
+
+    Source_Manager_Free(&sources);
+    remove(path);
+
+    if (!Assert(ok, info, "source manager did not load the sources it was given"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}
@@ -0,0 +1,345 @@
+#include "vm/vm.h"
+#include "backend/bytecode.h"
+#include "backend/emit.h"
+#include "frontend/check.h"
+#include "frontend/parser.h"
+#include "frontend/resolve.h"
+#include "util/arena.h"
+#include "util/errors.h"
+#include "util/tests.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *RUN_STATUS_MESSAGES[] = {
+    [RUN_OK] = "ok",
+    [RUN_INVALID_CODE] = "the bytecode is malformed",
+    [RUN_OUT_OF_MEMORY] = "out of memory",
+    [RUN_DIVISION_BY_ZERO] = "division by zero",
+};
+
+//-------------------------------------------------------------------------------//
+// virtual machine
+//-------------------------------------------------------------------------------//
+
+VM VM_New(FILE *out)
+{
+    return (VM) {.out = out};
+}
+
+void VM_Free(VM *self)
+{
+    free(self->registers);
+    *self = (VM) {0};
+}
+
+const char *Run_Status_Message(Run_Status status)
+{
+    return (status <= RUN_DIVISION_BY_ZERO) ? RUN_STATUS_MESSAGES[status] : "unknown error";
+}
+
+static bool reserve_registers(VM *self, size_t count)
+{
+    if (count <= self->capacity) return true;
+    Slot *grown = realloc(self->registers, count * sizeof(Slot));
+    if (!grown) return false;
+
+    self->registers = grown;
+    self->capacity = count;
+    return true;
+}
+
+/// @brief Calls a native on a window of registers.
+static void call_native(VM *self, uint8_t native, const Slot *args, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i > 0) fputc(' ', self->out);
+        if (native == NATIVE_PRINT_I64)
+            fprintf(self->out, "%" PRId64, args[i].i);
+        else
+            fprintf(self->out, "%.14g", args[i].f);
+    }
+    fputc('\n', self->out);
+}
+
+//-------------------------------------------------------------------------------//
+// dispatch
+//-------------------------------------------------------------------------------//
+
+/* integer arithmetic wraps around like two's complement, the unsigned casts keep
+   it defined. `INT64_MIN / -1` wraps to `INT64_MIN` and `INT64_MIN % -1` is 0 */
+
+#define WRAP(a, op, b) ((int64_t)((uint64_t)(a) op (uint64_t)(b)))
+
+/* the operands of a binary instruction as integers and as floats */
+
+#define I64_B R[INS_B(ins)].i
+#define I64_C R[INS_C(ins)].i
+#define F64_B R[INS_B(ins)].f
+#define F64_C R[INS_C(ins)].f
+
+#if VM_THREADED_DISPATCH
+#define VM_CASE(name) label_##name:
+#define VM_NEXT() do { ins = *ip++; goto *DISPATCH_TABLE[INS_OP(ins)]; } while (0)
+#define VM_START() VM_NEXT();
+#define VM_END()
+#else
+#define VM_CASE(name) case name:
+#define VM_NEXT() break
+#define VM_START() for (;;) { ins = *ip++; switch (INS_OP(ins)) {
+#define VM_END() default: goto invalid; } }
+#endif
+
+#if VM_THREADED_DISPATCH
+/* labels as values are a GNU extension */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+/// @brief The dispatch loop. The instruction pointer and the register base live in
+/// locals so the compiler can keep them in machine registers.
+static Run_Status execute(VM *self, const Function *fn)
+{
+#if VM_THREADED_DISPATCH
+    static const void *const DISPATCH_TABLE[] = {
+        #define X(name, str, format, regs) [name] = &&label_##name,
+        OPCODE_LIST
+        #undef X
+    };
+#endif
+
+    const Instruction *ip = fn->code.data;
+    const Value *K = fn->constants.data;
+    Slot *R = self->registers;
+    Instruction ins;
+
+    VM_START()
+
+    VM_CASE(BC_MOVE)
+    {
+        R[INS_A(ins)] = R[INS_B(ins)];
+        VM_NEXT();
+    }
+    VM_CASE(BC_LOADI)
+    {
+        R[INS_A(ins)].i = INS_SBX(ins);
+        VM_NEXT();
+    }
+    VM_CASE(BC_LOADK)
+    {
+        R[INS_A(ins)] = K[INS_BX(ins)].as;
+        VM_NEXT();
+    }
+    VM_CASE(BC_ADD_I64)
+    {
+        R[INS_A(ins)].i = WRAP(I64_B, +, I64_C);
+        VM_NEXT();
+    }
+    VM_CASE(BC_SUB_I64)
+    {
+        R[INS_A(ins)].i = WRAP(I64_B, -, I64_C);
+        VM_NEXT();
+    }
+    VM_CASE(BC_MUL_I64)
+    {
+        R[INS_A(ins)].i = WRAP(I64_B, *, I64_C);
+        VM_NEXT();
+    }
+    VM_CASE(BC_DIV_I64)
+    {
+        int64_t y = I64_C;
+        if (y == 0) goto division_by_zero;
+        R[INS_A(ins)].i = (y == -1) ? WRAP(0, -, I64_B) : I64_B / y;
+        VM_NEXT();
+    }
+    VM_CASE(BC_MOD_I64)
+    {
+        int64_t y = I64_C;
+        if (y == 0) goto division_by_zero;
+        R[INS_A(ins)].i = (y == -1) ? 0 : I64_B % y;
+        VM_NEXT();
+    }
+    VM_CASE(BC_NEG_I64)
+    {
+        R[INS_A(ins)].i = WRAP(0, -, I64_B);
+        VM_NEXT();
+    }
+    VM_CASE(BC_ADDI)
+    {
+        R[INS_A(ins)].i = WRAP(I64_B, +, INS_SC(ins));
+        VM_NEXT();
+    }
+    VM_CASE(BC_INCR)
+    {
+        R[INS_A(ins)].i = WRAP(R[INS_A(ins)].i, +, 1);
+        VM_NEXT();
+    }
+    VM_CASE(BC_ADD_F64)
+    {
+        R[INS_A(ins)].f = F64_B + F64_C;
+        VM_NEXT();
+    }
+    VM_CASE(BC_SUB_F64)
+    {
+        R[INS_A(ins)].f = F64_B - F64_C;
+        VM_NEXT();
+    }
+    VM_CASE(BC_MUL_F64)
+    {
+        R[INS_A(ins)].f = F64_B * F64_C;
+        VM_NEXT();
+    }
+    VM_CASE(BC_DIV_F64)
+    {
+        R[INS_A(ins)].f = F64_B / F64_C;
+        VM_NEXT();
+    }
+    VM_CASE(BC_MOD_F64)
+    {
+        R[INS_A(ins)].f = fmod(F64_B, F64_C);
+        VM_NEXT();
+    }
+    VM_CASE(BC_NEG_F64)
+    {
+        R[INS_A(ins)].f = -F64_B;
+        VM_NEXT();
+    }
+    VM_CASE(BC_CALLB)
+    {
+        call_native(self, INS_B(ins), R + INS_A(ins), INS_C(ins));
+        VM_NEXT();
+    }
+    VM_CASE(BC_HALT)
+    {
+        return RUN_OK;
+    }
+
+    VM_END()
+
+#if !VM_THREADED_DISPATCH
+invalid:
+    self->error_pc = (uint32_t)(ip - fn->code.data - 1);
+    return RUN_INVALID_CODE;
+#endif
+division_by_zero:
+    self->error_pc = (uint32_t)(ip - fn->code.data - 1);
+    return RUN_DIVISION_BY_ZERO;
+}
+
+#if VM_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+Run_Status VM_Run(VM *self, const Function *fn)
+{
+    self->error_pc = 0;
+    if (!Function_Verify(fn)) return RUN_INVALID_CODE;
+    if (!reserve_registers(self, fn->register_count ? fn->register_count : 1))
+        return RUN_OUT_OF_MEMORY;
+
+    /* registers start out as zeroes rather than whatever was left in them */
+    memset(self->registers, 0, fn->register_count * sizeof(Slot));
+    Run_Status status = execute(self, fn);
+    fflush(self->out);
+    return status;
+}
+
+//-------------------------------------------------------------------------------//
+// tests
+//-------------------------------------------------------------------------------//
+
+/// @brief Compiles a source and runs it, writing what it prints into `out`.
+static Run_Status run_source(const char *src, Arena *arena, FILE *out, VM *vm)
+{
+    Vec_Error errors = Vec_Error_New_In(arena, 4);
+    Parsed parsed = Parse(src, strlen(src), 0, arena, &errors);
+    Resolved resolved = Resolve(&parsed.ast, arena, &errors);
+    Checked checked = Check_Types(&parsed.ast, &resolved, arena, &errors);
+    Emitted emitted = Emit_Function(&parsed.ast, &resolved, &checked, arena, &errors);
+    if (!parsed.valid || !resolved.valid || !checked.valid || !emitted.valid)
+        return RUN_INVALID_CODE;
+
+    vm->out = out;
+    return VM_Run(vm, &emitted.fn);
+}
+
+void Test_VM(Test_Info *info)
+{
+    const char *src = "var i = 0\n"
+                      "i = i + 1\n"
+                      "print(i)\n"
+                      "var x = 1.5\n"
+                      "x *= -2.0\n"
+                      "print(x)\n"
+                      "let big = 9223372036854775807\n"
+                      "print(big + 1)\n"
+                      "print(-7 / 2)\n"
+                      "print(-7 % 2)\n"
+                      "print(7.5 % 2.0)\n";
+    const char *expected = "1\n-3\n-9223372036854775808\n-3\n-1\n1.5\n";
+
+    Arena arena = Arena_New(0);
+    VM vm = VM_New(stdout);
+    FILE *out = tmpfile();
+    char buffer[256] = {0};
+
+    bool ok = out && run_source(src, &arena, out, &vm) == RUN_OK;
+    if (ok)
+    {
+        rewind(out);
+        size_t read = fread(buffer, 1, sizeof(buffer) - 1, out);
+        buffer[read] = '\0';
+        printf("%s", buffer);
+        ok = strcmp(buffer, expected) == 0;
+    }
+    if (out) fclose(out);
+
+    /* operands are read left to right, an assignment further right does not
+       change what an earlier operand already read */
+    const char *order = "var y = 1\n"
+                        "var x = y + (y = 3)\n"
+                        "print(x)\n"
+                        "var i = 5\n"
+                        "print(i * (i += 1))\n"
+                        "var j = 5\n"
+                        "j += (j = 2)\n"
+                        "print(j)\n";
+    out = ok ? tmpfile() : NULL;
+    ok = ok && out && run_source(order, &arena, out, &vm) == RUN_OK;
+    if (ok)
+    {
+        rewind(out);
+        size_t read = fread(buffer, 1, sizeof(buffer) - 1, out);
+        buffer[read] = '\0';
+        printf("%s", buffer);
+        ok = strcmp(buffer, "4\n30\n7\n") == 0;
+    }
+    if (out) fclose(out);
+
+    /* a division by zero the folder could not see stops the run where it happens */
+    Run_Status status = run_source("var z = 0\nlet q = 1 / z\n", &arena, stdout, &vm);
+    ok = ok && status == RUN_DIVISION_BY_ZERO && vm.error_pc == 2;
+
+    /* code that would run off the end or outside its registers is refused */
+    Function bad = Function_New(&arena, 0, 0);
+    Function_Emit(&bad, MAKE_ABC(BC_MOVE, 3, 0, 0), 0);
+    bad.register_count = 1;
+    ok = ok && VM_Run(&vm, &bad) == RUN_INVALID_CODE;
+    Function_Emit(&bad, MAKE_ABC(BC_HALT, 0, 0, 0), 0);
+    ok = ok && VM_Run(&vm, &bad) == RUN_INVALID_CODE;
+
+    printf("> dispatch: %s\n", VM_THREADED_DISPATCH ? "threaded" : "switch");
+    VM_Free(&vm);
+    Arena_Free(&arena);
+    if (!Assert(ok, info, "the interpreter did not run as expected"))
+        return;
+
+    info->success = true;
+    info->status = true;
+}